@@ -615,9 +615,11 @@ void FrameTimeManager::GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eyeId,
     double timewarpStartEnd[2] = { 0.0, 0.0 };    
     GetTimewarpPredictions(eyeId, timewarpStartEnd);
 
-    //HMDState* p = (HMDState*)hmd;
-    ovrTrackingState startState = ovrHmd_GetTrackingState(hmd, timewarpStartEnd[0]);
-    ovrTrackingState endState   = ovrHmd_GetTrackingState(hmd, timewarpStartEnd[1]);
+    // Both from the same sensor reading, so the warp interpolates between consistent poses
+    ovrTrackingState startEndStates[2];
+    ovrHmd_GetTrackingStates(hmd, timewarpStartEnd, 2, startEndStates);
+    const ovrTrackingState& startState = startEndStates[0];
+    const ovrTrackingState& endState   = startEndStates[1];
 
     if (TimewarpIMUTimeSeconds == 0.0)
     {
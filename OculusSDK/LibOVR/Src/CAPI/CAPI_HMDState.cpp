@@ -218,18 +218,21 @@ void HMDState::UpdateRenderProfile(Profile* profile)
 
     if (pClient)
     {
-        // Center pupil depth
-        float centerPupilDepth = GetCenterPupilDepthFromRenderInfo(&RenderState.RenderInfo);
-        pClient->SetNumberValue(GetNetId(), "CenterPupilDepth", centerPupilDepth);
+        // Center pupil depth and neck model, sent together
+        const char*   keys[2] = { "CenterPupilDepth", "NeckModelVector3f" };
+        PropertyValue values[2];
+
+        values[0].Type        = PropertyValue::Type_Number;
+        values[0].NumberValue = GetCenterPupilDepthFromRenderInfo(&RenderState.RenderInfo);
 
-        // Neck model
         Vector3f neckModel = GetNeckModelFromProfile(profile);
-        double neckModelArray[3] = {
-            neckModel.x,
-            neckModel.y,
-            neckModel.z
-        };
-        pClient->SetNumberValues(GetNetId(), "NeckModelVector3f", neckModelArray, 3);
+        values[1].Type = PropertyValue::Type_Numbers;
+        values[1].NumberValues.Resize(3);
+        values[1].NumberValues[0] = neckModel.x;
+        values[1].NumberValues[1] = neckModel.y;
+        values[1].NumberValues[2] = neckModel.z;
+
+        pClient->SetValues(GetNetId(), keys, values, 2);
 
         double camerastate[7];
         if (profile->GetDoubleValues(OVR_KEY_CAMERA_POSITION, camerastate, 7) == 0)
@@ -318,16 +321,34 @@ void HMDState::RecenterPose()
 // Returns prediction for time.
 ovrTrackingState HMDState::PredictedTrackingState(double absTime)
 {    
-	Tracking::TrackingState ss;
-    TheSensorStateReader.GetSensorStateAtTime(absTime, ss);
+    ovrTrackingState state;
+    PredictedTrackingStates(&absTime, 1, &state);
+    return state;
+}
 
-    // Zero out the status flags
-    if (!pClient || !pClient->IsConnected(false, false))
+// Returns predictions for several times, all made from the same sensor sample.
+void HMDState::PredictedTrackingStates(const double* absTimes, int count, ovrTrackingState* states)
+{
+    Tracking::LocklessSensorState sample;
+    const bool haveSample = TheSensorStateReader.GetSensorSample(sample);
+    const bool connected  = pClient && pClient->IsConnected(false, false);
+
+    for (int i = 0; i < count; ++i)
     {
-        ss.StatusFlags = 0;
-    }
+        Tracking::TrackingState ss;
+        if (haveSample)
+        {
+            TheSensorStateReader.GetSensorStateAtTime(sample, absTimes[i], ss);
+        }
+
+        // Zero out the status flags
+        if (!connected)
+        {
+            ss.StatusFlags = 0;
+        }
 
-    return ss;
+        states[i] = ss;
+    }
 }
 
 void HMDState::SetEnabledHmdCaps(unsigned hmdCaps)
@@ -149,6 +149,7 @@ public:
     void            ResetTracking();
 	void			RecenterPose();
     ovrTrackingState PredictedTrackingState(double absTime);
+    void            PredictedTrackingStates(const double* absTimes, int count, ovrTrackingState* states);
 
     // Changes HMD Caps.
     // Capability bits that are not directly or logically tied to one system (such as sensor)
@@ -24,7 +24,8 @@ limitations under the License.
 
 ************************************************************************************/
 
-#include "OVR_Types.h"
+#include "OVR_Alg.h"
+#include "OVR_Threads.h"
 
 namespace OVR { namespace Alg {
 
@@ -54,4 +55,103 @@ extern const uint8_t LowerBitTable[256] =
 };
 
 
+//------------------------------------------------------------------------
+#ifdef OVR_ENABLE_THREADS
+
+struct ParallelTaskContext
+{
+    ParallelTaskFn  Task;
+    void*           Context;
+    int             TaskIndex;
+};
+
+static int ParallelTaskThreadFn(Thread*, void* h)
+{
+    ParallelTaskContext* ctx = (ParallelTaskContext*)h;
+    ctx->Task(ctx->Context, ctx->TaskIndex);
+    return 0;
+}
+
+void ParallelInvoke(int taskCount, ParallelTaskFn task, void* context)
+{
+    enum { MaxTasks = 64 };
+
+    if (taskCount > MaxTasks)
+    {
+        // Run the tasks in batches rather than starting an unbounded number of threads
+        for (int i = 0; i < taskCount; i += MaxTasks)
+        {
+            struct Batch
+            {
+                ParallelTaskFn Task;
+                void*          Context;
+                int            First;
+
+                static void Run(void* h, int taskIndex)
+                {
+                    Batch* b = (Batch*)h;
+                    b->Task(b->Context, b->First + taskIndex);
+                }
+            } batch = { task, context, i };
+            ParallelInvoke(Min<int>(MaxTasks, taskCount - i), Batch::Run, &batch);
+        }
+        return;
+    }
+
+    ParallelTaskContext contexts[MaxTasks];
+    Ptr<Thread>         threads[MaxTasks];
+
+    for (int i = 1; i < taskCount; ++i)
+    {
+        contexts[i].Task      = task;
+        contexts[i].Context   = context;
+        contexts[i].TaskIndex = i;
+
+        threads[i] = *new Thread(ParallelTaskThreadFn, &contexts[i]);
+        if (!threads[i]->Start())
+        {
+            // Could not start a thread, so do the work here instead
+            threads[i].Clear();
+            task(context, i);
+        }
+    }
+
+    if (taskCount > 0)
+    {
+        task(context, 0);
+    }
+
+    for (int i = 1; i < taskCount; ++i)
+    {
+        if (threads[i])
+        {
+            threads[i]->Join();
+        }
+    }
+}
+
+int GetParallelTaskCount()
+{
+    int cpuCount = Thread::GetCPUCount();
+    return (cpuCount > 0) ? cpuCount : 1;
+}
+
+#else // OVR_ENABLE_THREADS
+
+void ParallelInvoke(int taskCount, ParallelTaskFn task, void* context)
+{
+    for (int i = 0; i < taskCount; ++i)
+    {
+        task(context, i);
+    }
+}
+
+int GetParallelTaskCount()
+{
+    return 1;
+}
+
+#endif // OVR_ENABLE_THREADS
+
+
 }} // OVE::Alg
@@ -433,11 +433,95 @@ void InsertionSort(Array& arr)
     InsertionSortSliced(arr, 0, arr.GetSize(), OperatorLess<ValueType>::Compare);
 }
 
+//-----------------------------------------------------------------------------------
+// ***** NthElementSliced
+//
+// Partially sort any part of any array so that arr[nth] holds the element that
+// would be there if the range were fully sorted, everything before it is not
+// greater and everything after it is not less.  Average time is linear.
+// The range is specified with start, end, where "end" is exclusive!
+// The comparison predicate must be specified.
+template<class Array, class Less> 
+void NthElementSliced(Array& arr, size_t start, size_t end, size_t nth, Less less)
+{
+    enum 
+    {
+        Threshold = 9
+    };
+
+    OVR_ASSERT(nth >= start && nth < end);
+
+    while(end - start > Threshold)
+    {
+        // Median of three pivot, left at arr[start]
+        size_t mid = start + (end - start) / 2;
+        if(less(arr[mid],     arr[start])) Swap(arr[mid],     arr[start]);
+        if(less(arr[end - 1], arr[mid]))   Swap(arr[end - 1], arr[mid]);
+        if(less(arr[mid],     arr[start])) Swap(arr[mid],     arr[start]);
+        Swap(arr[start], arr[mid]);
+
+        // Hoare partition; the sentinels above keep i and j in range
+        size_t i = start;
+        size_t j = end;
+        for(;;)
+        {
+            do i++; while(i < end && less(arr[i], arr[start]));
+            do j--; while(less(arr[start], arr[j]));
+            if(i >= j) break;
+            Swap(arr[i], arr[j]);
+        }
+        Swap(arr[start], arr[j]);
+
+        if(nth == j)
+        {
+            return;
+        }
+        if(nth < j)
+        {
+            end = j;
+        }
+        else
+        {
+            start = j + 1;
+        }
+    }
+    InsertionSortSliced(arr, start, end, less);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** NthElementSliced
+//
+// The data type must have a defined "<" operator.
+template<class Array> 
+void NthElementSliced(Array& arr, size_t start, size_t end, size_t nth)
+{
+    typedef typename Array::ValueType ValueType;
+    NthElementSliced(arr, start, end, nth, OperatorLess<ValueType>::Compare);
+}
+
+//-----------------------------------------------------------------------------------
+// ***** NthElement
+//
+// Select the nth element of an Array, ArrayPaged, ArrayUnsafe.
+// Useful for percentiles: NthElement(arr, arr.GetSize() * 99 / 100).
+template<class Array, class Less> 
+void NthElement(Array& arr, size_t nth, Less less)
+{
+    NthElementSliced(arr, 0, arr.GetSize(), nth, less);
+}
+
+template<class Array> 
+void NthElement(Array& arr, size_t nth)
+{
+    typedef typename Array::ValueType ValueType;
+    NthElementSliced(arr, 0, arr.GetSize(), nth, OperatorLess<ValueType>::Compare);
+}
+
 //-----------------------------------------------------------------------------------
 // ***** Median
 // Returns a median value of the input array.
 // Caveats: partially sorts the array, returns a reference to the array element
-// TBD: This needs to be optimized and generalized
 //
 template<class Array> 
 typename Array::ValueType& Median(Array& arr)
@@ -446,15 +530,336 @@ typename Array::ValueType& Median(Array& arr)
     size_t mid = (count - 1) / 2;
     OVR_ASSERT(count > 0);
 
-	for (size_t j = 0; j <= mid; j++)
+    NthElement(arr, mid);
+    return arr[mid];
+}
+
+//-----------------------------------------------------------------------------------
+// ***** MergeSlices
+//
+// Stable merge of the sorted ranges src[start, mid) and src[mid, end) into
+// dst[start, end).  src and dst must be different arrays.
+template<class Array, class Less> 
+void MergeSlices(const Array& src, Array& dst, size_t start, size_t mid, size_t end, Less less)
+{
+    size_t i = start;
+    size_t j = mid;
+    size_t k = start;
+
+    while(i < mid && j < end)
     {
-		size_t min = j;
-		for (size_t k = j + 1; k < count; k++)
-            if (arr[k] < arr[min]) 
-                min = k;
-        Swap(arr[j], arr[min]);
+        if(less(src[j], src[i]))
+            dst[k++] = src[j++];
+        else
+            dst[k++] = src[i++];
     }
-    return arr[mid];
+    while(i < mid) dst[k++] = src[i++];
+    while(j < end) dst[k++] = src[j++];
+}
+
+//-----------------------------------------------------------------------------------
+// ***** MergeSortSliced
+//
+// Stable sort of any part of an Array or ArrayPOD.
+// The range is specified with start, end, where "end" is exclusive!
+// "scratch" is used as the merge buffer over the same index range, so its
+// size must be at least "end".  The comparison predicate must be specified.
+template<class Array, class Less> 
+void MergeSortSliced(Array& arr, Array& scratch, size_t start, size_t end, Less less)
+{
+    enum 
+    {
+        RunSize = 16
+    };
+
+    OVR_ASSERT(scratch.GetSize() >= end);
+
+    size_t i;
+    for(i = start; i < end; i += RunSize)
+    {
+        InsertionSortSliced(arr, i, Min<size_t>(i + RunSize, end), less);
+    }
+
+    Array* src = &arr;
+    Array* dst = &scratch;
+    for(size_t width = RunSize; width < end - start; width *= 2)
+    {
+        for(i = start; i < end; i += 2 * width)
+        {
+            size_t mid = Min<size_t>(i + width, end);
+            MergeSlices(*src, *dst, i, mid, Min<size_t>(i + 2 * width, end), less);
+        }
+        Swap(src, dst);
+    }
+
+    if(src != &arr)
+    {
+        for(i = start; i < end; i++)
+            arr[i] = scratch[i];
+    }
+}
+
+//-----------------------------------------------------------------------------------
+// ***** MergeSort
+//
+// Stable sort of an Array or ArrayPOD, using "scratch" as the merge buffer.
+// The comparison predicate must be specified.
+template<class Array, class Less> 
+void MergeSort(Array& arr, Array& scratch, Less less)
+{
+    scratch.Resize(arr.GetSize());
+    MergeSortSliced(arr, scratch, 0, arr.GetSize(), less);
+}
+
+template<class Array> 
+void MergeSort(Array& arr, Array& scratch)
+{
+    typedef typename Array::ValueType ValueType;
+    MergeSort(arr, scratch, OperatorLess<ValueType>::Compare);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** ParallelInvoke
+//
+// Runs task(context, i) for i in [0, taskCount), using worker threads for all
+// but the first task, and returns when every task has finished.
+// Falls back to running the tasks in order when threads are not available.
+typedef void (*ParallelTaskFn)(void* context, int taskIndex);
+
+void ParallelInvoke(int taskCount, ParallelTaskFn task, void* context);
+
+// Returns the number of tasks worth splitting parallel work into.
+int  GetParallelTaskCount();
+
+//-----------------------------------------------------------------------------------
+// ***** ParallelMergeSort
+//
+// Stable sort of an Array or ArrayPOD that sorts slices on worker threads and
+// then merges them pairwise, also in parallel.  Small arrays are sorted on the
+// calling thread since starting threads would cost more than it saves.
+// "maxTasks" limits the number of slices; 0 means one per CPU.
+template<class Array, class Less> 
+class ParallelMergeSorter
+{
+public:
+    Array&  Arr;
+    Array&  Scratch;
+    Less    LessFn;
+    size_t  SliceSize;
+    size_t  Width;
+    Array*  Src;
+    Array*  Dst;
+
+    ParallelMergeSorter(Array& arr, Array& scratch, Less less, size_t sliceSize) :
+        Arr(arr), Scratch(scratch), LessFn(less), SliceSize(sliceSize),
+        Width(0), Src(&arr), Dst(&scratch)
+    {
+    }
+
+    static void SortSlice(void* context, int taskIndex)
+    {
+        ParallelMergeSorter* self = (ParallelMergeSorter*)context;
+        size_t count = self->Arr.GetSize();
+        size_t start = Min<size_t>(taskIndex * self->SliceSize, count);
+        size_t end   = Min<size_t>(start + self->SliceSize, count);
+        MergeSortSliced(self->Arr, self->Scratch, start, end, self->LessFn);
+    }
+
+    static void MergePair(void* context, int taskIndex)
+    {
+        ParallelMergeSorter* self = (ParallelMergeSorter*)context;
+        size_t count = self->Arr.GetSize();
+        size_t start = Min<size_t>(taskIndex * 2 * self->Width, count);
+        size_t mid   = Min<size_t>(start + self->Width, count);
+        size_t end   = Min<size_t>(mid + self->Width, count);
+        MergeSlices(*self->Src, *self->Dst, start, mid, end, self->LessFn);
+    }
+
+private:
+    ParallelMergeSorter& operator=(const ParallelMergeSorter&);
+};
+
+template<class Array, class Less> 
+void ParallelMergeSort(Array& arr, Array& scratch, Less less, int maxTasks = 0)
+{
+    enum 
+    {
+        MinSliceSize = 8192
+    };
+
+    size_t count = arr.GetSize();
+    scratch.Resize(count);
+
+    int tasks = (maxTasks > 0) ? maxTasks : GetParallelTaskCount();
+    tasks = (int)Min<size_t>((size_t)tasks, count / MinSliceSize);
+    if(tasks < 2)
+    {
+        MergeSortSliced(arr, scratch, 0, count, less);
+        return;
+    }
+
+    ParallelMergeSorter<Array, Less> sorter(arr, scratch, less, (count + tasks - 1) / tasks);
+    ParallelInvoke(tasks, ParallelMergeSorter<Array, Less>::SortSlice, &sorter);
+
+    for(sorter.Width = sorter.SliceSize; sorter.Width < count; sorter.Width *= 2)
+    {
+        int pairs = (int)((count + 2 * sorter.Width - 1) / (2 * sorter.Width));
+        ParallelInvoke(pairs, ParallelMergeSorter<Array, Less>::MergePair, &sorter);
+        Swap(sorter.Src, sorter.Dst);
+    }
+
+    if(sorter.Src != &arr)
+    {
+        for(size_t i = 0; i < count; i++)
+            arr[i] = scratch[i];
+    }
+}
+
+template<class Array> 
+void ParallelMergeSort(Array& arr, Array& scratch)
+{
+    typedef typename Array::ValueType ValueType;
+    ParallelMergeSort(arr, scratch, OperatorLess<ValueType>::Compare);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** RadixKeyOf
+//
+// Key extractors for RadixSort.  An extractor defines KeyType (an unsigned
+// integer) and maps a value to a key whose unsigned order matches the value
+// order.  Custom extractors for structures can reuse these, for example:
+//
+//     struct DrawKeyOf
+//     {
+//         typedef uint64_t KeyType;
+//         KeyType operator()(const DrawItem& item) const { return item.SortKey; }
+//     };
+template<class T> struct RadixKeyOf;
+
+template<> struct RadixKeyOf<uint32_t>
+{
+    typedef uint32_t KeyType;
+    KeyType operator()(uint32_t v) const { return v; }
+};
+
+template<> struct RadixKeyOf<int32_t>
+{
+    typedef uint32_t KeyType;
+    KeyType operator()(int32_t v) const { return (uint32_t)v ^ 0x80000000u; }
+};
+
+template<> struct RadixKeyOf<uint64_t>
+{
+    typedef uint64_t KeyType;
+    KeyType operator()(uint64_t v) const { return v; }
+};
+
+template<> struct RadixKeyOf<int64_t>
+{
+    typedef uint64_t KeyType;
+    KeyType operator()(int64_t v) const { return (uint64_t)v ^ uint64_t(0x8000000000000000ULL); }
+};
+
+// Flips negative floats entirely and positive ones by the sign bit only,
+// so that -0.0 sorts before +0.0 and NaNs sort to the ends.
+template<> struct RadixKeyOf<float>
+{
+    typedef uint32_t KeyType;
+    KeyType operator()(float v) const
+    {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+};
+
+template<> struct RadixKeyOf<double>
+{
+    typedef uint64_t KeyType;
+    KeyType operator()(double v) const
+    {
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return (bits & uint64_t(0x8000000000000000ULL)) ? ~bits : (bits | uint64_t(0x8000000000000000ULL));
+    }
+};
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSort
+//
+// Stable LSD radix sort of an Array or ArrayPOD, one byte of the key per pass.
+// Passes where every key has the same byte are skipped, so sorting 64-bit keys
+// that only use their low bits costs no more than sorting narrow keys.
+// "scratch" receives the intermediate passes and is resized to match "arr".
+template<class Array, class KeyOf> 
+void RadixSort(Array& arr, Array& scratch, KeyOf keyOf)
+{
+    typedef typename KeyOf::KeyType KeyType;
+    enum 
+    {
+        Passes = sizeof(KeyType)
+    };
+
+    const size_t count = arr.GetSize();
+    if(count < 2) return;
+    scratch.Resize(count);
+
+    size_t histograms[Passes][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    size_t i;
+    int    pass;
+    for(i = 0; i < count; i++)
+    {
+        KeyType key = keyOf(arr[i]);
+        for(pass = 0; pass < Passes; pass++)
+            histograms[pass][(key >> (pass * 8)) & 0xff]++;
+    }
+
+    Array* src = &arr;
+    Array* dst = &scratch;
+    for(pass = 0; pass < Passes; pass++)
+    {
+        const int shift   = pass * 8;
+        size_t*   offsets = histograms[pass];
+
+        if(offsets[(keyOf((*src)[0]) >> shift) & 0xff] == count)
+            continue;
+
+        size_t sum = 0;
+        for(i = 0; i < 256; i++)
+        {
+            size_t c   = offsets[i];
+            offsets[i] = sum;
+            sum       += c;
+        }
+
+        for(i = 0; i < count; i++)
+        {
+            const typename Array::ValueType& v = (*src)[i];
+            (*dst)[offsets[(keyOf(v) >> shift) & 0xff]++] = v;
+        }
+        Swap(src, dst);
+    }
+
+    if(src != &arr)
+    {
+        for(i = 0; i < count; i++)
+            arr[i] = scratch[i];
+    }
+}
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSort
+//
+// Sort an Array or ArrayPOD of integers or floats by value.
+template<class Array> 
+void RadixSort(Array& arr, Array& scratch)
+{
+    typedef typename Array::ValueType ValueType;
+    RadixSort(arr, scratch, RadixKeyOf<ValueType>());
 }
 
 //-----------------------------------------------------------------------------------
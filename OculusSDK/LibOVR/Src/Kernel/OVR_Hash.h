@@ -204,7 +204,7 @@ public:
 
     HashSetBase() : pTable(NULL)                       {   }
     HashSetBase(int sizeHint) : pTable(NULL)           { SetCapacity(this, sizeHint);  }
-    HashSetBase(const SelfType& src) : pTable(NULL)    { Assign(this, src); }
+    HashSetBase(const SelfType& src) : pTable(NULL)    { Assign(src); }
 
     ~HashSetBase()                                     
     { 
@@ -29,6 +29,7 @@ limitations under the License.
 #define OVR_Lockless_h
 
 #include "OVR_Atomic.h"
+#include "OVR_Allocator.h"
 
 // Define this to compile-in Lockless test logic
 //#define OVR_LOCKLESS_TEST
@@ -106,6 +107,236 @@ public:
 };
 
 
+// ***** LocklessSnapshot
+
+// Read-copy-update holder for data that is read much more often than it is
+// changed, such as observer subscriber lists and RPC slot tables.
+//
+// Readers pin the current immutable snapshot with a Reader and walk it without
+// taking a lock.  Writers must be serialized by the owner (typically with its
+// own Lock): they copy the current value, modify the copy and Publish() it.
+// Replaced snapshots are retired and freed once no reader is active, either by
+// the next writer or by the last reader to leave.
+
+template<class T>
+class LocklessSnapshot
+{
+    struct Node : public NewOverrideBase
+    {
+        T     Value;
+        Node* NextRetired;
+
+        Node(const T& value) : Value(value), NextRetired(NULL) { }
+    };
+
+public:
+    LocklessSnapshot() : ActiveReaders(0) { }
+    ~LocklessSnapshot()
+    {
+        OVR_ASSERT(ActiveReaders.Load_Acquire() == 0);
+        delete Current.Exchange_Sync(NULL);
+        freeList(Retired.Exchange_Sync(NULL));
+    }
+
+    // Pins the snapshot that was current when it was constructed.
+    class Reader
+    {
+    public:
+        Reader(LocklessSnapshot& owner) : Owner(owner)
+        {
+            // The full barrier orders the reader count before the pointer load,
+            // which is what makes the writer's quiescence check safe.
+            Owner.ActiveReaders.ExchangeAdd_Sync(1);
+            Pinned = Owner.Current.Load_Acquire();
+        }
+        ~Reader()
+        {
+            Owner.endRead();
+        }
+
+        // Returns NULL if nothing has been published yet
+        const T* GetPtr() const { return Pinned ? &Pinned->Value : NULL; }
+
+    private:
+        LocklessSnapshot& Owner;
+        const Node*       Pinned;
+
+        OVR_NON_COPYABLE(Reader);
+    };
+
+    // Writer-only: returns the current value, or NULL if empty.
+    // Valid only while the caller holds the lock that serializes writers.
+    const T* GetForWrite() const
+    {
+        const Node* node = Current.Load_Acquire();
+        return node ? &node->Value : NULL;
+    }
+
+    // Writer-only: replaces the current snapshot with a copy of value.
+    void Publish(const T& value)
+    {
+        swapCurrent(new Node(value));
+    }
+
+    // Writer-only: drops the current snapshot.
+    void Clear()
+    {
+        swapCurrent(NULL);
+    }
+
+private:
+    AtomicPtr<Node> Current;
+    AtomicPtr<Node> Retired;
+    AtomicInt<int>  ActiveReaders;
+
+    void swapCurrent(Node* node)
+    {
+        Node* old = Current.Exchange_Sync(node);
+        if (old)
+        {
+            pushRetired(old, old);
+        }
+        reclaim();
+    }
+
+    void endRead()
+    {
+        if (ActiveReaders.ExchangeAdd_Sync(-1) == 1 && Retired.Load_Acquire())
+        {
+            reclaim();
+        }
+    }
+
+    // Frees retired snapshots if no reader could still be holding one.
+    void reclaim()
+    {
+        // Take the list before checking the count: every node in it was
+        // swapped out before the take, so a reader that pinned one of them
+        // incremented ActiveReaders before the check below.
+        Node* list = Retired.Exchange_Sync(NULL);
+        if (!list)
+        {
+            return;
+        }
+
+        if (ActiveReaders.Load_Acquire() == 0)
+        {
+            freeList(list);
+            return;
+        }
+
+        // Still in use; put the list back for the last reader to free.
+        Node* tail = list;
+        while (tail->NextRetired)
+        {
+            tail = tail->NextRetired;
+        }
+        pushRetired(list, tail);
+    }
+
+    void pushRetired(Node* head, Node* tail)
+    {
+        Node* top;
+        do
+        {
+            top = Retired.Load_Acquire();
+            tail->NextRetired = top;
+        } while (!Retired.CompareAndSet_Sync(top, head));
+    }
+
+    static void freeList(Node* list)
+    {
+        while (list)
+        {
+            Node* next = list->NextRetired;
+            delete list;
+            list = next;
+        }
+    }
+
+    OVR_NON_COPYABLE(LocklessSnapshot);
+};
+
+
+// ***** LocklessQueue
+
+// Unbounded multiple-producer, single-consumer FIFO queue.
+//
+// Push() may be called from any number of threads at once and never blocks.
+// Pop() must only be called by one thread at a time; callers with several
+// consumer threads must serialize them with their own lock.
+// A Pop() racing with a Push() that has not finished linking its node may
+// report the queue empty; the value is returned by a later Pop().
+
+template<class T>
+class LocklessQueue
+{
+    struct Node : public NewOverrideBase
+    {
+        T               Value;
+        AtomicPtr<Node> Next;
+
+        Node() { }
+        Node(const T& value) : Value(value) { }
+    };
+
+public:
+    LocklessQueue()
+    {
+        Node* stub = new Node;
+        Head.Store_Release(stub);
+        Tail = stub;
+    }
+    ~LocklessQueue()
+    {
+        while (Tail)
+        {
+            Node* next = Tail->Next.Load_Acquire();
+            delete Tail;
+            Tail = next;
+        }
+    }
+
+    // Any thread
+    void Push(const T& value)
+    {
+        Node* node = new Node(value);
+        Node* prev = Head.Exchange_Sync(node);
+        prev->Next.Store_Release(node);
+    }
+
+    // Consumer only: returns false if the queue is empty
+    bool Pop(T& valueOut)
+    {
+        Node* next = Tail->Next.Load_Acquire();
+        if (!next)
+        {
+            return false;
+        }
+
+        // The popped node becomes the new stub
+        valueOut = next->Value;
+        next->Value = T();
+
+        delete Tail;
+        Tail = next;
+        return true;
+    }
+
+    // Consumer only
+    bool IsEmpty() const
+    {
+        return Tail->Next.Load_Acquire() == NULL;
+    }
+
+private:
+    AtomicPtr<Node> Head; // Last pushed node, updated by producers
+    Node*           Tail; // Stub node preceding the next value, owned by the consumer
+
+    OVR_NON_COPYABLE(LocklessQueue);
+};
+
+
 #ifdef OVR_LOCKLESS_TEST
 void StartLocklessTest();
 #endif
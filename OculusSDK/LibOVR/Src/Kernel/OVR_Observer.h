@@ -30,6 +30,7 @@ limitations under the License.
 
 #include "OVR_Types.h"
 #include "OVR_Atomic.h"
+#include "OVR_Lockless.h"
 #include "OVR_RefCount.h"
 #include "OVR_Delegates.h"
 #include "OVR_Array.h"
@@ -59,6 +60,10 @@ template<class DelegateT> class ObserverHash;
 // To avoid misuse, assertions are added if a subject tries to observe, or if
 // an observer tries to be watched.
 
+// Subjects keep their observers in an immutable snapshot, so Call() does not
+// take a lock and handlers may run concurrently from several threads.
+// Adding an observer or pruning shut down ones publishes a new snapshot.
+
 /*
     Usage example:
 
@@ -157,9 +162,13 @@ public:
     typedef DelegateT Handler;
 
 protected:
-	bool                     IsShutdown; // Flag to indicate that the object went out of scope
-	mutable Lock             TheLock;    // Lock to synchronize calls and shutdown
-	Array< Ptr< ThisType > > References; // List of observed or observing objects
+    typedef Array< Ptr< ThisType > >     ObserverArray;
+    typedef LocklessSnapshot<ObserverArray> ObserverSnapshot;
+
+	volatile bool            IsShutdown; // Flag to indicate that the object went out of scope
+	mutable Lock             TheLock;    // Lock to synchronize changes and shutdown
+	ObserverArray            References; // Observer-only: List of observed subjects
+	ObserverSnapshot         Observers;  // Subject-only: Snapshot of observing objects
 	Handler                  TheHandler; // Observer-only: Handler for callbacks
 
 	Observer() :
@@ -174,7 +183,7 @@ protected:
 	}
 	~Observer()
 	{
-		OVR_ASSERT(References.GetSizeI() == 0);
+		OVR_ASSERT(References.GetSizeI() == 0 && !Observers.GetForWrite());
 	}
 
 public:
@@ -190,13 +199,15 @@ public:
 		Lock::Locker locker(&TheLock);
 		IsShutdown = true;
 		References.ClearAndRelease();
+		Observers.Clear();
 	}
 
 	// Get count of references held
 	int GetSizeI() const
 	{
 		Lock::Locker locker(&TheLock);
-		return References.GetSizeI();
+		const ObserverArray* observers = Observers.GetForWrite();
+		return References.GetSizeI() + (observers ? observers->GetSizeI() : 0);
 	}
 
 	// Observe a subject
@@ -244,41 +255,82 @@ protected:
 			return false;
 		}
 
-		const int count = References.GetSizeI();
-		for (int i = 0; i < count; ++i)
+		ObserverArray observers;
+		if (const ObserverArray* current = Observers.GetForWrite())
 		{
-			if (References[i] == observer)
+			const int count = current->GetSizeI();
+			for (int i = 0; i < count; ++i)
 			{
-				// Already watched
-				return true;
+				if ((*current)[i] == observer)
+				{
+					// Already watched
+					return true;
+				}
 			}
+			observers = *current;
 		}
 
-		References.PushBack(observer);
+		observers.PushBack(observer);
+		Observers.Publish(observers);
 
 		return true;
 	}
 
+	// Subject function: Drop observers that have shut down since the last call
+	void SubjectRemoveShutdownObservers()
+	{
+		Lock::Locker locker(&TheLock);
+
+		const ObserverArray* current = Observers.GetForWrite();
+		if (IsShutdown || !current)
+		{
+			return;
+		}
+
+		ObserverArray observers;
+		const int count = current->GetSizeI();
+		for (int i = 0; i < count; ++i)
+		{
+			if (!(*current)[i]->IsShutdown)
+			{
+				observers.PushBack((*current)[i]);
+			}
+		}
+
+		if (observers.GetSizeI() != count)
+		{
+			Observers.Publish(observers);
+		}
+	}
+
 public:
     // Subject function: Call()
 #define OVR_OBSERVER_CALL_BODY(params) \
     bool callSuccess = false; \
-	Lock::Locker locker(&TheLock); \
-	int count = References.GetSizeI(); \
-	for (int i = 0; i < count; ++i) \
+    bool sawShutdown = false; \
 	{ \
-		if (!References[i]->IsShutdown) \
-		{ \
-			OVR_ASSERT(References[i]->TheHandler.IsValid()); \
-			References[i]->TheHandler params; \
-            callSuccess = true; \
-		} \
-		if (References[i]->IsShutdown) \
+		typename ObserverSnapshot::Reader reader(Observers); \
+		const ObserverArray* observers = reader.GetPtr(); \
+		const int count = observers ? observers->GetSizeI() : 0; \
+		for (int i = 0; i < count; ++i) \
 		{ \
-			References.RemoveAt(i); \
-			--i; --count; \
+			ThisType* observer = (*observers)[i].GetPtr(); \
+			if (!observer->IsShutdown) \
+			{ \
+				OVR_ASSERT(observer->TheHandler.IsValid()); \
+				observer->TheHandler params; \
+				callSuccess = true; \
+			} \
+			if (observer->IsShutdown) \
+			{ \
+				sawShutdown = true; \
+			} \
 		} \
 	} \
+	if (sawShutdown) \
+	{ \
+		SubjectRemoveShutdownObservers(); \
+	} \
     return callSuccess;
 
 	// Call: Various parameter counts
@@ -391,29 +443,41 @@ public:
 // ObserverHash
 
 // A hash containing Observers
+// Lookups read an immutable snapshot of the table without locking; adding or
+// removing a subject publishes a new table.
 template<class DelegateT>
 class ObserverHash : public NewOverrideBase
 {
+	typedef OVR::Hash< OVR::String, Ptr<Observer<DelegateT> >, OVR::String::HashFunctor > SubjectHash;
+
 public:
 	ObserverHash() {}
 	~ObserverHash() {Clear();}
 	void Clear()
 	{
 		Lock::Locker locker(&TheLock);
-		typename OVR::Hash< String, Ptr<Observer<DelegateT> >, OVR::String::HashFunctor >::Iterator it = _Hash.Begin();
-		for( it = _Hash.Begin(); it != _Hash.End(); ++it )
+		const SubjectHash* subjects = _Hash.GetForWrite();
+		if (subjects)
 		{
-			Ptr<Observer<DelegateT> > o = it->Second;
-			o->Shutdown();
+			typename SubjectHash::ConstIterator it;
+			for( it = subjects->Begin(); it != subjects->End(); ++it )
+			{
+				Ptr<Observer<DelegateT> > o = it->Second;
+				o->Shutdown();
+			}
 		}
 	}
 
 	Ptr<Observer<DelegateT> > GetSubject(OVR::String key)
 	{
-		Lock::Locker locker(&TheLock);
-		Ptr<Observer<DelegateT> > *o = _Hash.Get(key);
-		if (o)
-			return (*o);
+		typename LocklessSnapshot<SubjectHash>::Reader reader(_Hash);
+		const SubjectHash* subjects = reader.GetPtr();
+		if (subjects)
+		{
+			const Ptr<Observer<DelegateT> > *o = subjects->Get(key);
+			if (o)
+				return (*o);
+		}
 		return NULL;
 	}
 
@@ -421,12 +485,17 @@ public:
 	void AddObserverToSubject(OVR::String key, Observer<DelegateT> *observer)
 	{
 		Lock::Locker locker(&TheLock);
-		Ptr<Observer<DelegateT> > *subjectPtr = _Hash.Get(key);
+		const SubjectHash* subjects = _Hash.GetForWrite();
+		const Ptr<Observer<DelegateT> > *subjectPtr = subjects ? subjects->Get(key) : NULL;
 
 		if (subjectPtr==NULL)
 		{
 			Ptr<Observer<DelegateT> > subject = *new Observer<DelegateT>();
-			_Hash.Add(key, subject);
+			SubjectHash newSubjects;
+			if (subjects)
+				newSubjects = *subjects;
+			newSubjects.Add(key, subject);
+			_Hash.Publish(newSubjects);
 			observer->Observe(subject);
 		}
 		else
@@ -438,17 +507,20 @@ public:
 	void RemoveSubject(OVR::String key)
 	{
 		Lock::Locker locker(&TheLock);
-		Ptr<Observer<DelegateT> > *subjectPtr = _Hash.Get(key);
+		const SubjectHash* subjects = _Hash.GetForWrite();
+		const Ptr<Observer<DelegateT> > *subjectPtr = subjects ? subjects->Get(key) : NULL;
 		if (subjectPtr!=NULL)
 		{
 			(*subjectPtr)->Shutdown();
-			_Hash.Remove(key);
+			SubjectHash newSubjects(*subjects);
+			newSubjects.Remove(key);
+			_Hash.Publish(newSubjects);
 		}
 	}
 
 protected:
-	OVR::Hash< OVR::String, Ptr<Observer<DelegateT> >, OVR::String::HashFunctor > _Hash;
-	Lock                     TheLock;      // Lock to synchronize calls and shutdown
+	LocklessSnapshot<SubjectHash> _Hash;   // Snapshot of subjects by key
+	Lock                     TheLock;      // Lock to serialize changes and shutdown
 };
 
 
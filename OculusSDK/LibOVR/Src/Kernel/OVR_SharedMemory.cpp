@@ -402,8 +402,8 @@ SharedMemoryInternal* SharedMemoryInternal::CreateSharedMemory(const SharedMemor
 		// If creating the shared memory is also acceptable,
 		if (params.openMode != SharedMemory::OpenMode_OpenOnly)
 		{
-			// Interpret create mode
-			const bool allowRemoteWrite = (params.remoteMode == SharedMemory::RemoteMode_ReadWrite);
+			// Interpret create mode; Private regions get the ReadWrite DACL, which has no owner-only form
+			const bool allowRemoteWrite = (params.remoteMode != SharedMemory::RemoteMode_ReadOnly);
 
 			// Attempt to create a shared memory map
 			retval = AttemptCreateSharedMemory(fileName, params.minSizeBytes, openReadOnly, allowRemoteWrite);
@@ -460,7 +460,7 @@ public:
 
 	static SharedMemoryInternal* DoFileMap(int hFileMapping, const char* fileName, bool openReadOnly, int minSize);
 	static SharedMemoryInternal* AttemptOpenSharedMemory(const char* fileName, int minSize, bool openReadOnly);
-	static SharedMemoryInternal* AttemptCreateSharedMemory(const char* fileName, int minSize, bool openReadOnly, bool allowRemoteWrite);
+	static SharedMemoryInternal* AttemptCreateSharedMemory(const char* fileName, int minSize, bool openReadOnly, SharedMemory::RemoteMode remoteMode);
 	static SharedMemoryInternal* CreateSharedMemory(const SharedMemory::OpenParameters& params);
 };
 
@@ -517,7 +517,7 @@ SharedMemoryInternal* SharedMemoryInternal::AttemptOpenSharedMemory(const char*
 	return DoFileMap(hFileMapping, fileName, openReadOnly, minSize);
 }
 
-SharedMemoryInternal* SharedMemoryInternal::AttemptCreateSharedMemory(const char* fileName, int minSize, bool openReadOnly, bool allowRemoteWrite)
+SharedMemoryInternal* SharedMemoryInternal::AttemptCreateSharedMemory(const char* fileName, int minSize, bool openReadOnly, SharedMemory::RemoteMode remoteMode)
 {
     // Create mode
     // Note: Cannot create the shared memory file read-only because then ftruncate() will fail.
@@ -535,8 +535,15 @@ SharedMemoryInternal* SharedMemoryInternal::AttemptCreateSharedMemory(const char
     // Set own read/write permissions
     int perms = openReadOnly ? S_IRUSR : (S_IRUSR|S_IWUSR);
 
-    // Allow other users to read/write the shared memory file
-    perms |= allowRemoteWrite ? (S_IWGRP|S_IWOTH|S_IRGRP|S_IROTH) : (S_IRGRP|S_IROTH);
+    // Allow other users to read/write the shared memory file, unless it is private to this user
+    if (remoteMode == SharedMemory::RemoteMode_ReadWrite)
+    {
+        perms |= S_IWGRP|S_IWOTH|S_IRGRP|S_IROTH;
+    }
+    else if (remoteMode == SharedMemory::RemoteMode_ReadOnly)
+    {
+        perms |= S_IRGRP|S_IROTH;
+    }
 
     // Attempt to open the shared memory file
     int hFileMapping = shm_open(fileName, flags, perms);
@@ -595,11 +602,8 @@ SharedMemoryInternal* SharedMemoryInternal::CreateSharedMemory(const SharedMemor
 		// If creating the shared memory is also acceptable,
 		if (params.openMode != SharedMemory::OpenMode_OpenOnly)
 		{
-            // Interpret create mode
-            const bool allowRemoteWrite = (params.remoteMode == SharedMemory::RemoteMode_ReadWrite);
-
             // Attempt to create a shared memory map
-            retval = AttemptCreateSharedMemory(fileName, params.minSizeBytes, openReadOnly, allowRemoteWrite);
+            retval = AttemptCreateSharedMemory(fileName, params.minSizeBytes, openReadOnly, params.remoteMode);
 
             // If successful,
             if (retval)
@@ -688,4 +692,340 @@ void SharedMemoryFactory::OnSystemDestroy()
 }
 
 
+//// SharedRingBuffer
+
+// Layout of the start of the shared region; the slots follow it.
+// Only fixed-size types are used so that 32-bit and 64-bit processes agree on it.
+struct SharedRingBufferHeader
+{
+	enum
+	{
+		CacheLineSize  = 64,
+		MagicValue     = 0x4F52494E, // 'ORIN'
+		CurrentVersion = 1,
+		SlotHeaderSize = 8           // Slot sequence number, padded to keep record data 8-byte aligned.
+	};
+
+	// Written once by Create(). Magic is written last so Open() never sees a half-initialized header.
+	AtomicInt<uint32_t> Magic;
+	uint32_t            Version;
+	uint32_t            RecordSize;
+	uint32_t            Capacity;       // Power of two
+	uint32_t            SlotStride;
+	uint32_t            Policy;
+	uint8_t             Pad0[CacheLineSize - 6 * sizeof(uint32_t)];
+
+	// Producer cache line
+	AtomicInt<uint32_t> Head;           // Next sequence number to be claimed by a producer.
+	AtomicInt<uint32_t> OverflowCount;
+	uint8_t             Pad1[CacheLineSize - 2 * sizeof(uint32_t)];
+
+	// Consumer cache line
+	AtomicInt<uint32_t> Tail;           // Next sequence number the consumer will read.
+	uint8_t             Pad2[CacheLineSize - sizeof(uint32_t)];
+};
+
+OVR_COMPILER_ASSERT(sizeof(SharedRingBufferHeader) == 3 * SharedRingBufferHeader::CacheLineSize);
+
+// Each slot starts with a sequence word: 2*seq+1 while record seq is being written,
+// and 2*seq+2 once it is committed. The parity tells the two states apart even when
+// the counters wrap around.
+static inline uint32_t RingSlotWriting(uint32_t sequence)   { return (sequence << 1) + 1; }
+static inline uint32_t RingSlotCommitted(uint32_t sequence) { return (sequence << 1) + 2; }
+
+// Orders the loads around the record copy in Read(): nothing after the fence is read before
+// anything ahead of it. Load_Acquire only fences the compiler ahead of the load, so the copy
+// could otherwise be moved across the slot sequence checks that bracket it.
+static inline void RingLoadFence()
+{
+#if defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)
+	// Loads are not reordered with other loads on x86; only the compiler has to be held back.
+	#if defined(OVR_CC_MSVC)
+		_ReadBarrier();
+	#else
+		asm volatile ("" : : : "memory");
+	#endif
+#elif defined(OVR_CC_MSVC)
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+
+SharedRingBuffer::SharedRingBuffer() :
+	pSharedMemory(),
+	pHeader(NULL),
+	pSlots(NULL),
+	RecordSize(0),
+	Mode(SingleProducer),
+	ReadSequence(0)
+{
+}
+
+SharedRingBuffer::~SharedRingBuffer()
+{
+	Close();
+}
+
+bool SharedRingBuffer::Create(const char* name, int recordSize, int capacity,
+                              ProducerMode mode, OverflowPolicy policy,
+                              SharedMemory::RemoteMode remoteMode)
+{
+	Close();
+
+	if (recordSize <= 0 || capacity <= 0 || capacity > (1 << 30))
+	{
+		OVR_ASSERT(false);
+		return false;
+	}
+
+	uint32_t roundedCapacity = 1;
+	while (roundedCapacity < (uint32_t)capacity)
+		roundedCapacity <<= 1;
+
+	const uint32_t stride = ((uint32_t)recordSize + SharedRingBufferHeader::SlotHeaderSize + 7) & ~7u;
+	const uint64_t regionSize = sizeof(SharedRingBufferHeader) + (uint64_t)stride * roundedCapacity;
+
+	if (regionSize > 0x7FFFFFFF)
+	{
+		OVR_DEBUG_LOG(("[SharedRingBuffer] FAILURE: %s is too large (%d x %d bytes)", name, capacity, recordSize));
+		return false;
+	}
+
+	SharedMemory::OpenParameters params;
+	params.globalName   = name;
+	params.minSizeBytes = (int)regionSize;
+	params.openMode     = (remoteMode == SharedMemory::RemoteMode_Private) ? SharedMemory::OpenMode_CreateOnly
+	                                                                        : SharedMemory::OpenMode_CreateOrOpen;
+	params.remoteMode   = remoteMode; // Not ReadOnly: the remote consumer writes Tail.
+	params.accessMode   = SharedMemory::AccessMode_ReadWrite;
+
+	pSharedMemory = SharedMemoryFactory::GetInstance()->Open(params);
+	if (!pSharedMemory || !pSharedMemory->GetData() || pSharedMemory->GetSizeI() < (int)regionSize)
+	{
+		pSharedMemory.Clear();
+		return false;
+	}
+
+	SharedRingBufferHeader* header = (SharedRingBufferHeader*)pSharedMemory->GetData();
+
+	// Invalidate any previous contents before re-initializing, e.g. after a service restart.
+	header->Magic.Store_Release(0);
+	header->Version    = SharedRingBufferHeader::CurrentVersion;
+	header->RecordSize = (uint32_t)recordSize;
+	header->Capacity   = roundedCapacity;
+	header->SlotStride = stride;
+	header->Policy     = (uint32_t)policy;
+	header->Head.Store_Release(0);
+	header->OverflowCount.Store_Release(0);
+	header->Tail.Store_Release(0);
+	memset((uint8_t*)header + sizeof(SharedRingBufferHeader), 0, (size_t)stride * roundedCapacity);
+	header->Magic.Store_Release(SharedRingBufferHeader::MagicValue);
+
+	pHeader      = header;
+	pSlots       = (uint8_t*)header + sizeof(SharedRingBufferHeader);
+	RecordSize   = recordSize;
+	Mode         = mode;
+	ReadSequence = 0;
+	return true;
+}
+
+bool SharedRingBuffer::Open(const char* name, int recordSize, ProducerMode mode)
+{
+	Close();
+
+	// Map the header first to learn the full size.
+	SharedMemory::OpenParameters params;
+	params.globalName   = name;
+	params.minSizeBytes = (int)sizeof(SharedRingBufferHeader);
+	params.openMode     = SharedMemory::OpenMode_OpenOnly;
+	params.accessMode   = SharedMemory::AccessMode_ReadWrite;
+
+	Ptr<SharedMemory> headerMemory = SharedMemoryFactory::GetInstance()->Open(params);
+	if (!headerMemory || !headerMemory->GetData())
+		return false;
+
+	const SharedRingBufferHeader* header = (const SharedRingBufferHeader*)headerMemory->GetData();
+
+	if (header->Magic.Load_Acquire() != SharedRingBufferHeader::MagicValue ||
+		header->Version != SharedRingBufferHeader::CurrentVersion ||
+		header->RecordSize != (uint32_t)recordSize)
+	{
+		OVR_DEBUG_LOG(("[SharedRingBuffer] FAILURE: %s has an incompatible header", name));
+		return false;
+	}
+
+	params.minSizeBytes = (int)(sizeof(SharedRingBufferHeader) + (uint64_t)header->SlotStride * header->Capacity);
+	headerMemory.Clear();
+
+	pSharedMemory = SharedMemoryFactory::GetInstance()->Open(params);
+	if (!pSharedMemory || !pSharedMemory->GetData())
+	{
+		pSharedMemory.Clear();
+		return false;
+	}
+
+	pHeader      = (SharedRingBufferHeader*)pSharedMemory->GetData();
+	pSlots       = (uint8_t*)pHeader + sizeof(SharedRingBufferHeader);
+	RecordSize   = recordSize;
+	Mode         = mode;
+	ReadSequence = pHeader->Tail.Load_Acquire(); // Resume where the previous consumer left off.
+	return true;
+}
+
+void SharedRingBuffer::Close()
+{
+	pHeader = NULL;
+	pSlots  = NULL;
+	pSharedMemory.Clear();
+}
+
+uint8_t* SharedRingBuffer::getSlot(uint32_t sequence) const
+{
+	return pSlots + (size_t)(sequence & (pHeader->Capacity - 1)) * pHeader->SlotStride;
+}
+
+bool SharedRingBuffer::Write(const void* record)
+{
+	if (!pHeader)
+		return false;
+
+	const uint32_t capacity = pHeader->Capacity;
+	uint32_t       sequence;
+
+	// Claim a sequence number.
+	if (pHeader->Policy == Overflow_Reject)
+	{
+		for (;;)
+		{
+			sequence = pHeader->Head.Load_Acquire();
+			if ((uint32_t)(sequence - pHeader->Tail.Load_Acquire()) >= capacity)
+			{
+				pHeader->OverflowCount.ExchangeAdd_NoSync(1);
+				return false;
+			}
+			if (Mode == SingleProducer)
+			{
+				pHeader->Head.Store_Release(sequence + 1);
+				break;
+			}
+			if (pHeader->Head.CompareAndSet_Sync(sequence, sequence + 1))
+				break;
+		}
+	}
+	else
+	{
+		if (Mode == SingleProducer)
+		{
+			sequence = pHeader->Head.Load_Acquire();
+			pHeader->Head.Store_Release(sequence + 1);
+		}
+		else
+		{
+			sequence = pHeader->Head.ExchangeAdd_Sync(1);
+		}
+
+		if ((uint32_t)(sequence - pHeader->Tail.Load_Acquire()) >= capacity)
+			pHeader->OverflowCount.ExchangeAdd_NoSync(1); // Replacing a record the consumer hasn't read.
+	}
+
+	uint8_t*            slot         = getSlot(sequence);
+	AtomicInt<uint32_t>* slotSequence = (AtomicInt<uint32_t>*)slot;
+
+	// Mark the slot as being written, with a full barrier so that the consumer can't
+	// see any of the new record data before the mark.
+	if (Mode == SingleProducer)
+	{
+		slotSequence->Exchange_Sync(RingSlotWriting(sequence));
+	}
+	else
+	{
+		// A producer that is a lap ahead or behind may be after the same slot. Only one of
+		// them may write it at a time, so the slot is claimed with a CAS on its sequence word.
+		for (;;)
+		{
+			const uint32_t current = slotSequence->Load_Acquire();
+
+			// Drop the record if the slot already holds a later one, or if the producer a lap
+			// behind is still writing it. Both only happen while the ring is being lapped, so
+			// the consumer skips past the missing record within the next few writes.
+			if ((int32_t)(RingSlotCommitted(sequence) - current) <= 0 || (current & 1))
+			{
+				pHeader->OverflowCount.ExchangeAdd_NoSync(1);
+				return true;
+			}
+
+			if (slotSequence->CompareAndSet_Sync(current, RingSlotWriting(sequence)))
+				break;
+		}
+	}
+	memcpy(slot + SharedRingBufferHeader::SlotHeaderSize, record, (size_t)RecordSize);
+	slotSequence->Store_Release(RingSlotCommitted(sequence));
+	return true;
+}
+
+bool SharedRingBuffer::Read(void* record)
+{
+	if (!pHeader)
+		return false;
+
+	const uint32_t capacity = pHeader->Capacity;
+
+	for (;;)
+	{
+		uint32_t head = pHeader->Head.Load_Acquire();
+		if (head == ReadSequence)
+			return false;
+
+		// If the producer lapped us, skip ahead to the oldest record still in the ring.
+		if ((uint32_t)(head - ReadSequence) > capacity)
+			ReadSequence = head - capacity;
+
+		uint8_t*             slot         = getSlot(ReadSequence);
+		AtomicInt<uint32_t>* slotSequence = (AtomicInt<uint32_t>*)slot;
+		const uint32_t       expected     = RingSlotCommitted(ReadSequence);
+
+		if (slotSequence->Load_Acquire() != expected)
+		{
+			// Either claimed but not committed yet, or overwritten since we read head.
+			if ((uint32_t)(pHeader->Head.Load_Acquire() - ReadSequence) > capacity)
+				continue;
+			return false;
+		}
+
+		RingLoadFence();
+		memcpy(record, slot + SharedRingBufferHeader::SlotHeaderSize, (size_t)RecordSize);
+		RingLoadFence();
+
+		// A producer may have lapped us and started overwriting the slot during the copy.
+		if (slotSequence->Load_Acquire() != expected)
+			continue;
+
+		ReadSequence++;
+		pHeader->Tail.Store_Release(ReadSequence);
+		return true;
+	}
+}
+
+int SharedRingBuffer::GetPendingCount() const
+{
+	if (!pHeader)
+		return 0;
+
+	uint32_t pending = pHeader->Head.Load_Acquire() - pHeader->Tail.Load_Acquire();
+	return (int)((pending > pHeader->Capacity) ? pHeader->Capacity : pending);
+}
+
+uint32_t SharedRingBuffer::GetOverflowCount() const
+{
+	return pHeader ? pHeader->OverflowCount.Load_Acquire() : 0;
+}
+
+int SharedRingBuffer::GetCapacity() const
+{
+	return pHeader ? (int)pHeader->Capacity : 0;
+}
+
+
 } // namespace OVR
@@ -76,7 +76,9 @@ public:
 	enum RemoteMode
 	{
 		RemoteMode_ReadOnly,		// Other processes will need to open in read-only mode
-		RemoteMode_ReadWrite		// Other processes can open in read-write mode
+		RemoteMode_ReadWrite,		// Other processes can open in read-write mode
+		RemoteMode_Private			// Only processes of the same user (POSIX); same as ReadWrite on Windows,
+									// whose DACL already limits it to System, Administrators and Interactive Users
 	};
 
 	// Modes for opening a new shared memory region
@@ -235,6 +237,137 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------------
+// ***** SharedRingBuffer
+
+// Cross-process lock-free queue of fixed-size records, for streaming high-rate data
+// (IMU samples, latency records, perf counters) between the service and its clients.
+//
+// There is a single consumer, and either a single producer or multiple producers.
+// Producers never block. When the ring is full, the overflow policy decides what happens:
+//  - Overwrite: the oldest unread record is replaced. The consumer detects that it
+//    has been lapped and resynchronizes to the oldest record still in the ring.
+//    Use this for telemetry where only recent data matters.
+//  - Reject: Write() fails and nothing is lost from the ring.
+// Overwritten records and rejected writes are both counted in GetOverflowCount().
+//
+// Head (next sequence number to claim) and Tail (next sequence number the consumer
+// will read) each sit on their own cache line. Each slot has its own sequence number, so
+// the consumer can tell a committed record from one that is still being written or
+// was overwritten while being copied. Note: Safe when used between 32-bit and 64-bit processes.
+//
+// With MultiProducer, producers claim a slot with a CAS on its sequence number, so two of
+// them never write the same slot at once. When they collide while lapping the ring, the
+// older record is dropped, or the newer one if the older is still being written; either
+// is counted as an overflow.
+
+struct SharedRingBufferHeader;
+
+class SharedRingBuffer : public NewOverrideBase
+{
+	OVR_NON_COPYABLE(SharedRingBuffer);
+
+public:
+	enum ProducerMode
+	{
+		SingleProducer,
+		MultiProducer
+	};
+
+	enum OverflowPolicy
+	{
+		Overflow_Overwrite,
+		Overflow_Reject
+	};
+
+	SharedRingBuffer();
+	~SharedRingBuffer();
+
+	// Creates (or re-initializes) the shared region. Called by the owner of the stream,
+	// normally the service. Capacity is rounded up to a power of two.
+	// With RemoteMode_Private the region is always created afresh, so a region someone
+	// else created under the same name is never used.
+	bool Create(const char* name, int recordSize, int capacity,
+	            ProducerMode mode = SingleProducer, OverflowPolicy policy = Overflow_Overwrite,
+	            SharedMemory::RemoteMode remoteMode = SharedMemory::RemoteMode_ReadWrite);
+
+	// Opens an existing region created by another process. recordSize must match.
+	bool Open(const char* name, int recordSize, ProducerMode mode = SingleProducer);
+
+	void Close();
+
+	bool IsOpen() const { return pHeader != NULL; }
+
+	// Producer side. Returns false if the ring isn't open, or if it is full with Overflow_Reject.
+	bool Write(const void* record);
+
+	// Consumer side. Copies the oldest unread record into record and returns true,
+	// or returns false if there is nothing to read.
+	bool Read(void* record);
+
+	// Number of records the consumer hasn't read yet.
+	int GetPendingCount() const;
+
+	// Records overwritten before being read, or writes rejected, since Create().
+	uint32_t GetOverflowCount() const;
+
+	int GetRecordSize() const { return RecordSize; }
+	int GetCapacity() const;
+
+protected:
+	bool    attach(const char* name, int recordSize, bool create);
+	uint8_t* getSlot(uint32_t sequence) const;
+
+	Ptr<SharedMemory>       pSharedMemory;
+	SharedRingBufferHeader* pHeader;
+	uint8_t*                pSlots;
+	int                     RecordSize;
+	ProducerMode            Mode;
+	uint32_t                ReadSequence; // Consumer's cursor; published to the header as Tail.
+};
+
+
+// Typed wrappers; T must be a POD type with the same layout in every process.
+template<class T>
+class SharedRingWriter : public SharedRingBuffer
+{
+public:
+	bool Create(const char* name, int capacity,
+	            ProducerMode mode = SingleProducer, OverflowPolicy policy = Overflow_Overwrite)
+	{
+		return SharedRingBuffer::Create(name, (int)sizeof(T), capacity, mode, policy);
+	}
+	bool Open(const char* name, ProducerMode mode = SingleProducer)
+	{
+		return SharedRingBuffer::Open(name, (int)sizeof(T), mode);
+	}
+	OVR_FORCE_INLINE bool Write(const T& record)
+	{
+		return SharedRingBuffer::Write(&record);
+	}
+
+private:
+	bool Read(void*);
+};
+
+template<class T>
+class SharedRingReader : public SharedRingBuffer
+{
+public:
+	bool Open(const char* name)
+	{
+		return SharedRingBuffer::Open(name, (int)sizeof(T));
+	}
+	OVR_FORCE_INLINE bool Read(T& record)
+	{
+		return SharedRingBuffer::Read(&record);
+	}
+
+private:
+	bool Write(const void*);
+};
+
+
 } // namespace OVR
 
 #endif // OVR_SharedMemory_h
@@ -195,6 +195,24 @@ int OVR_CDECL OVR_wcsicmp(const wchar_t* a, const wchar_t* b)
 // This function is not inline because of dependency on <locale.h>
 double OVR_CDECL OVR_strtod(const char* str, char** tailptr)
 {
+    // Decimal input goes through the locale-independent parser. Only C library extensions
+    // such as hexadecimal floats take the localeconv() path below.
+    const char* p = str;
+    while (isspace((unsigned char)*p))
+        p++;
+    const char* number = p;
+    if ((*p == '-') || (*p == '+'))
+        p++;
+
+    if (!((p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X'))))
+    {
+        const char* tail;
+        double      retval = OVR_ParseDouble(number, &tail);
+        if (tailptr)
+            *tailptr = (tail == number) ? (char*)str : (char*)tail;
+        return retval;
+    }
+
 #if !defined(OVR_OS_ANDROID) // The Android C library doesn't have localeconv.
     const char s = *localeconv()->decimal_point;
 
@@ -234,6 +252,954 @@ double OVR_CDECL OVR_strtod(const char* str, char** tailptr)
 }
 
 
+//-----------------------------------------------------------------------------------
+// ***** Locale-independent number parsing
+//
+// OVR_ParseDouble/OVR_ParseFloat first try the exact fast path (Clinger): if the decimal
+// mantissa fits in the float significand and the power of ten is itself exactly representable,
+// a single IEEE multiply or divide gives the correctly rounded result. This covers nearly all
+// numbers found in profiles, JSON and scene files. Everything else goes through the exact
+// arbitrary precision decimal conversion below, which never needs the C library.
+
+namespace NumberParse {
+
+// Format description for the IEEE binary types we can produce.
+struct FloatInfo
+{
+    unsigned MantBits;
+    unsigned ExpBits;
+    int      Bias;
+};
+
+static const FloatInfo Float64Info = { 52, 11, -1023 };
+static const FloatInfo Float32Info = { 23,  8,  -127 };
+
+static const double Pow10Double[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float Pow10Float[] =
+{
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+// Scanned form of a number: Mantissa * 10^Exp10, where Mantissa holds the first
+// (at most 19) significant digits.
+struct ScanResult
+{
+    const char* DigitsBegin;   // First character of the digit sequence (after the sign).
+    const char* End;           // First character after the number.
+    uint64_t    Mantissa;
+    int         Exp10;
+    bool        Negative;
+    bool        Truncated;     // True if significant digits didn't fit in Mantissa.
+};
+
+static const int MaxExponent = 100000; // Anything larger over/underflows any type we support.
+
+// Returns false if str doesn't start with a decimal number.
+static bool Scan(const char* str, ScanResult& r)
+{
+    const char* p  = str;
+    r.Negative     = false;
+    r.Truncated    = false;
+    r.Mantissa     = 0;
+    r.Exp10        = 0;
+
+    if ((*p == '-') || (*p == '+'))
+        r.Negative = (*p++ == '-');
+
+    r.DigitsBegin  = p;
+    int  digits    = 0;     // Significant digits stored in Mantissa.
+    int  dropped   = 0;     // Integer digits that didn't fit in Mantissa.
+    bool sawDigits = false;
+
+    for (; (*p >= '0') && (*p <= '9'); ++p)
+    {
+        sawDigits = true;
+        if (digits < 19)
+        {
+            r.Mantissa = (r.Mantissa * 10) + (unsigned)(*p - '0');
+            if (r.Mantissa)
+                digits++;
+        }
+        else
+        {
+            dropped++;
+            if (*p != '0')
+                r.Truncated = true;
+        }
+    }
+
+    if (*p == '.')
+    {
+        const char* fraction = p + 1;
+        for (p = fraction; (*p >= '0') && (*p <= '9'); ++p)
+        {
+            if (digits < 19)
+            {
+                r.Mantissa = (r.Mantissa * 10) + (unsigned)(*p - '0');
+                if (r.Mantissa)
+                    digits++;
+                r.Exp10--;
+            }
+            else if (*p != '0')
+            {
+                r.Truncated = true;
+            }
+        }
+
+        if (p == fraction && !sawDigits) // A lone '.' is not a number.
+            return false;
+        sawDigits = true;
+    }
+
+    if (!sawDigits)
+        return false;
+
+    r.Exp10 += dropped;
+
+    if ((*p == 'e') || (*p == 'E'))
+    {
+        const char* e  = p + 1;
+        bool        negExp = false;
+
+        if ((*e == '-') || (*e == '+'))
+            negExp = (*e++ == '-');
+
+        if ((*e >= '0') && (*e <= '9'))
+        {
+            int exp = 0;
+            for (; (*e >= '0') && (*e <= '9'); ++e)
+            {
+                if (exp < MaxExponent)
+                    exp = (exp * 10) + (*e - '0');
+            }
+            r.Exp10 += negExp ? -exp : exp;
+            p = e;
+        }
+    }
+
+    r.End = p;
+    return true;
+}
+
+// Recognizes "inf", "infinity" and "nan". Returns the end of the match, or NULL.
+static const char* ScanSpecial(const char* str, bool& negative, bool& isNan)
+{
+    const char* p = str;
+    negative = false;
+
+    if ((*p == '-') || (*p == '+'))
+        negative = (*p++ == '-');
+
+    if (OVR_strnicmp(p, "nan", 3) == 0)
+    {
+        isNan = true;
+        return p + 3;
+    }
+    if (OVR_strnicmp(p, "inf", 3) == 0)
+    {
+        isNan = false;
+        return (OVR_strnicmp(p + 3, "inity", 5) == 0) ? (p + 8) : (p + 3);
+    }
+    return NULL;
+}
+
+
+// Arbitrary precision decimal number: 0.Digits[0..DigitCount) * 10^DecimalPoint.
+// Supports binary shifts, which is all that's needed to extract correctly rounded
+// binary mantissa bits.
+class Decimal
+{
+public:
+    enum { MaxDigits = 800, MaxShift = 60 };
+
+    char Digits[MaxDigits];
+    int  DigitCount;
+    int  DecimalPoint;
+    bool Truncated;     // Discarded nonzero digits beyond Digits[DigitCount].
+
+    Decimal() : DigitCount(0), DecimalPoint(0), Truncated(false) { }
+
+    // Digits are read from a string already validated by Scan.
+    void Set(const ScanResult& r)
+    {
+        const char* p = r.DigitsBegin;
+        bool sawDot   = false;
+
+        for (; p < r.End; ++p)
+        {
+            if (*p == '.')
+            {
+                sawDot       = true;
+                DecimalPoint = DigitCount;
+                continue;
+            }
+            if ((*p < '0') || (*p > '9'))
+                break;
+
+            if ((*p == '0') && (DigitCount == 0)) // Ignore leading zeros.
+            {
+                DecimalPoint--;
+                continue;
+            }
+            if (DigitCount < MaxDigits)
+                Digits[DigitCount++] = *p;
+            else if (*p != '0')
+                Truncated = true;
+        }
+
+        if (!sawDot)
+            DecimalPoint = DigitCount;
+
+        // Apply the exponent; the digits scanned above cover everything but it.
+        if ((p < r.End) && ((*p == 'e') || (*p == 'E')))
+        {
+            const char* e  = p + 1;
+            bool        negExp = false;
+            if ((*e == '-') || (*e == '+'))
+                negExp = (*e++ == '-');
+            int exp = 0;
+            for (; (e < r.End) && (*e >= '0') && (*e <= '9'); ++e)
+            {
+                if (exp < MaxExponent)
+                    exp = (exp * 10) + (*e - '0');
+            }
+            DecimalPoint += negExp ? -exp : exp;
+        }
+    }
+
+    void Shift(int k)
+    {
+        if (DigitCount == 0)
+            return;
+        for (; k > MaxShift; k -= MaxShift)
+            leftShift(MaxShift);
+        for (; k < -MaxShift; k += MaxShift)
+            rightShift(MaxShift);
+        if (k > 0)
+            leftShift((unsigned)k);
+        else if (k < 0)
+            rightShift((unsigned)-k);
+    }
+
+    // Returns the integer part, rounded half to even.
+    uint64_t RoundedInteger() const
+    {
+        if (DecimalPoint > 20)
+            return uint64_t(0xFFFFFFFFFFFFFFFFULL);
+
+        uint64_t n = 0;
+        int      i = 0;
+        for (; (i < DecimalPoint) && (i < DigitCount); i++)
+            n = (n * 10) + (unsigned)(Digits[i] - '0');
+        for (; i < DecimalPoint; i++)
+            n *= 10;
+        if (shouldRoundUp(DecimalPoint))
+            n++;
+        return n;
+    }
+
+private:
+    void trim()
+    {
+        while ((DigitCount > 0) && (Digits[DigitCount - 1] == '0'))
+            DigitCount--;
+        if (DigitCount == 0)
+            DecimalPoint = 0;
+    }
+
+    bool shouldRoundUp(int nd) const
+    {
+        if ((nd < 0) || (nd >= DigitCount))
+            return false;
+        if ((Digits[nd] == '5') && (nd + 1 == DigitCount)) // Exactly halfway: round to even.
+        {
+            if (Truncated)
+                return true;
+            return (nd > 0) && (((Digits[nd - 1] - '0') % 2) == 1);
+        }
+        return Digits[nd] >= '5';
+    }
+
+    // Divides by 2^k, k <= MaxShift.
+    void rightShift(unsigned k)
+    {
+        int      r = 0; // Read index
+        int      w = 0; // Write index
+        uint64_t n = 0;
+
+        // Pick up enough leading digits to cover the first shift.
+        for (; (n >> k) == 0; r++)
+        {
+            if (r >= DigitCount)
+            {
+                if (n == 0)
+                {
+                    DigitCount = 0;
+                    return;
+                }
+                while ((n >> k) == 0)
+                {
+                    n *= 10;
+                    r++;
+                }
+                break;
+            }
+            n = (n * 10) + (unsigned)(Digits[r] - '0');
+        }
+        DecimalPoint -= r - 1;
+
+        const uint64_t mask = (uint64_t(1) << k) - 1;
+
+        for (; r < DigitCount; r++)
+        {
+            uint64_t digit = n >> k;
+            n &= mask;
+            Digits[w++] = (char)('0' + digit);
+            n = (n * 10) + (unsigned)(Digits[r] - '0');
+        }
+
+        while (n > 0)
+        {
+            uint64_t digit = n >> k;
+            n &= mask;
+            if (w < MaxDigits)
+                Digits[w++] = (char)('0' + digit);
+            else if (digit > 0)
+                Truncated = true;
+            n *= 10;
+        }
+
+        DigitCount = w;
+        trim();
+    }
+
+    // Multiplies by 2^k, k <= MaxShift. Digits are produced from the end backwards
+    // into a scratch buffer, since the number of new leading digits isn't known up front.
+    void leftShift(unsigned k)
+    {
+        char     buffer[MaxDigits + 20];
+        int      w = (int)sizeof(buffer);
+        uint64_t n = 0;
+
+        for (int r = DigitCount - 1; r >= 0; r--)
+        {
+            n += uint64_t(Digits[r] - '0') << k;
+            uint64_t quo = n / 10;
+            buffer[--w] = (char)('0' + (n - (quo * 10)));
+            n = quo;
+        }
+        while (n > 0)
+        {
+            uint64_t quo = n / 10;
+            buffer[--w] = (char)('0' + (n - (quo * 10)));
+            n = quo;
+        }
+
+        int count = (int)sizeof(buffer) - w;
+        DecimalPoint += count - DigitCount;
+
+        if (count > MaxDigits)
+        {
+            for (int i = MaxDigits; i < count; i++)
+            {
+                if (buffer[w + i] != '0')
+                    Truncated = true;
+            }
+            count = MaxDigits;
+        }
+        memcpy(Digits, buffer + w, count);
+        DigitCount = count;
+        trim();
+    }
+};
+
+
+// Converts the decimal to the closest binary float of the given format, returning its bits.
+static uint64_t DecimalToFloatBits(Decimal& d, bool negative, const FloatInfo& info)
+{
+    static const int PowTab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+    static const int PowTabSize = (int)(sizeof(PowTab) / sizeof(PowTab[0]));
+
+    const int maxBiasedExp = (1 << info.ExpBits) - 1;
+    uint64_t  mant = 0;
+    int       exp  = info.Bias;
+
+    if (d.DigitCount == 0 || d.DecimalPoint < -330)
+        goto done; // Zero or obvious underflow.
+
+    if (d.DecimalPoint > 310)
+        goto overflow;
+
+    // Scale by powers of two until in range [0.5, 1.0).
+    exp = 0;
+    while (d.DecimalPoint > 0)
+    {
+        int n = (d.DecimalPoint >= PowTabSize) ? 27 : PowTab[d.DecimalPoint];
+        d.Shift(-n);
+        exp += n;
+    }
+    while ((d.DecimalPoint < 0) || ((d.DecimalPoint == 0) && (d.Digits[0] < '5')))
+    {
+        int n = (-d.DecimalPoint >= PowTabSize) ? 27 : PowTab[-d.DecimalPoint];
+        d.Shift(n);
+        exp -= n;
+    }
+
+    // Our range is [0.5, 1) but the floating point range is [1, 2).
+    exp--;
+
+    // Denormals: move the exponent up to the minimum and shift the digits to match.
+    if (exp < info.Bias + 1)
+    {
+        int n = info.Bias + 1 - exp;
+        d.Shift(-n);
+        exp += n;
+    }
+
+    if (exp - info.Bias >= maxBiasedExp)
+        goto overflow;
+
+    // Extract 1 + MantBits bits.
+    d.Shift((int)(1 + info.MantBits));
+    mant = d.RoundedInteger();
+
+    // Rounding might have added a bit; shift down.
+    if (mant == (uint64_t(2) << info.MantBits))
+    {
+        mant >>= 1;
+        exp++;
+        if (exp - info.Bias >= maxBiasedExp)
+            goto overflow;
+    }
+
+    if ((mant & (uint64_t(1) << info.MantBits)) == 0)
+        exp = info.Bias; // Denormal
+    goto done;
+
+overflow:
+    mant = 0;
+    exp  = maxBiasedExp + info.Bias;
+
+done:
+    uint64_t bits = mant & ((uint64_t(1) << info.MantBits) - 1);
+    bits |= uint64_t((exp - info.Bias) & maxBiasedExp) << info.MantBits;
+    if (negative)
+        bits |= uint64_t(1) << (info.MantBits + info.ExpBits);
+    return bits;
+}
+
+static double SlowParseDouble(const ScanResult& r)
+{
+    Decimal d;
+    d.Set(r);
+    uint64_t bits = DecimalToFloatBits(d, r.Negative, Float64Info);
+    double   result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float SlowParseFloat(const ScanResult& r)
+{
+    Decimal d;
+    d.Set(r);
+    uint32_t bits = (uint32_t)DecimalToFloatBits(d, r.Negative, Float32Info);
+    float    result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static double SpecialValue(bool isNan, bool negative)
+{
+    // Built from bits rather than HUGE_VAL/NAN, which not all of our compilers provide as constants.
+    uint64_t bits = isNan ? uint64_t(0x7FF8000000000000ULL) : uint64_t(0x7FF0000000000000ULL);
+    if (negative)
+        bits |= uint64_t(0x8000000000000000ULL);
+    double result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+} // namespace NumberParse
+
+
+double OVR_CDECL OVR_ParseDouble(const char* str, const char** tailptr)
+{
+    using namespace NumberParse;
+    ScanResult r;
+
+    if (!Scan(str, r))
+    {
+        bool        negative, isNan;
+        const char* end = ScanSpecial(str, negative, isNan);
+        if (tailptr)
+            *tailptr = end ? end : str;
+        return end ? SpecialValue(isNan, negative) : 0.0;
+    }
+
+    if (tailptr)
+        *tailptr = r.End;
+
+    if (r.Mantissa == 0 && !r.Truncated)
+        return r.Negative ? -0.0 : 0.0;
+
+    if (!r.Truncated && (r.Mantissa <= (uint64_t(1) << 53)))
+    {
+        double m = (double)r.Mantissa;
+
+        if ((r.Exp10 >= -22) && (r.Exp10 <= 22))
+        {
+            m = (r.Exp10 < 0) ? (m / Pow10Double[-r.Exp10]) : (m * Pow10Double[r.Exp10]);
+            return r.Negative ? -m : m;
+        }
+
+        // Numbers like 12e30: move the excess power of ten into the mantissa if it stays exact.
+        if ((r.Exp10 > 22) && (r.Exp10 <= 22 + 15))
+        {
+            uint64_t mantissa = r.Mantissa;
+            int      exp10    = r.Exp10;
+            while ((exp10 > 22) && (mantissa <= (uint64_t(1) << 53) / 10))
+            {
+                mantissa *= 10;
+                exp10--;
+            }
+            if (exp10 == 22)
+            {
+                m = (double)mantissa * Pow10Double[22];
+                return r.Negative ? -m : m;
+            }
+        }
+    }
+
+    return SlowParseDouble(r);
+}
+
+float OVR_CDECL OVR_ParseFloat(const char* str, const char** tailptr)
+{
+    using namespace NumberParse;
+    ScanResult r;
+
+    if (!Scan(str, r))
+    {
+        bool        negative, isNan;
+        const char* end = ScanSpecial(str, negative, isNan);
+        if (tailptr)
+            *tailptr = end ? end : str;
+        return end ? (float)SpecialValue(isNan, negative) : 0.0f;
+    }
+
+    if (tailptr)
+        *tailptr = r.End;
+
+    if (r.Mantissa == 0 && !r.Truncated)
+        return r.Negative ? -0.0f : 0.0f;
+
+    // Going through double would round twice, so floats get their own fast path.
+    if (!r.Truncated && (r.Mantissa <= (1u << 24)) && (r.Exp10 >= -10) && (r.Exp10 <= 10))
+    {
+        float m = (float)r.Mantissa;
+        m = (r.Exp10 < 0) ? (m / Pow10Float[-r.Exp10]) : (m * Pow10Float[r.Exp10]);
+        return r.Negative ? -m : m;
+    }
+
+    return SlowParseFloat(r);
+}
+
+int64_t OVR_CDECL OVR_ParseInt(const char* str, const char** tailptr)
+{
+    const char* p        = str;
+    bool        negative = false;
+
+    if ((*p == '-') || (*p == '+'))
+        negative = (*p++ == '-');
+
+    if ((*p < '0') || (*p > '9'))
+    {
+        if (tailptr)
+            *tailptr = str;
+        return 0;
+    }
+
+    // Accumulate as unsigned magnitude; the limit is one larger for negative values.
+    const uint64_t limit    = negative ? (uint64_t(1) << 63) : ((uint64_t(1) << 63) - 1);
+    uint64_t       value    = 0;
+    bool           overflow = false;
+
+    for (; (*p >= '0') && (*p <= '9'); ++p)
+    {
+        unsigned digit = (unsigned)(*p - '0');
+        if (overflow || (value > (limit - digit) / 10))
+            overflow = true;
+        else
+            value = (value * 10) + digit;
+    }
+
+    if (tailptr)
+        *tailptr = p;
+
+    if (overflow)
+        value = limit;
+    return negative ? (int64_t)(0 - value) : (int64_t)value;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Shortest round-trip number formatting
+//
+// Implements Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers", PLDI 2010). The output always round-trips, and is the shortest possible
+// representation for the vast majority of values; otherwise it's one digit longer.
+
+namespace NumberFormat {
+
+// Floating point value with a 64 bit significand and no implicit bit: F * 2^E.
+struct DiyFp
+{
+    uint64_t F;
+    int      E;
+
+    DiyFp() : F(0), E(0) { }
+    DiyFp(uint64_t f, int e) : F(f), E(e) { }
+
+    explicit DiyFp(double d)
+    {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+
+        int      biasedExp   = (int)((bits & uint64_t(0x7FF0000000000000ULL)) >> 52);
+        uint64_t significand = bits & uint64_t(0x000FFFFFFFFFFFFFULL);
+
+        if (biasedExp != 0)
+        {
+            F = significand + uint64_t(0x0010000000000000ULL);
+            E = biasedExp - 1075;
+        }
+        else
+        {
+            F = significand;
+            E = -1074;
+        }
+    }
+
+    DiyFp operator-(const DiyFp& rhs) const
+    {
+        return DiyFp(F - rhs.F, E);
+    }
+
+    // Returns the upper 64 bits of the 128 bit product, rounded.
+    DiyFp operator*(const DiyFp& rhs) const
+    {
+        const uint64_t M32 = 0xFFFFFFFFu;
+        const uint64_t a = F >> 32;
+        const uint64_t b = F & M32;
+        const uint64_t c = rhs.F >> 32;
+        const uint64_t d = rhs.F & M32;
+        const uint64_t ac = a * c;
+        const uint64_t bc = b * c;
+        const uint64_t ad = a * d;
+        const uint64_t bd = b * d;
+        uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+        tmp += uint64_t(1) << 31;
+        return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), E + rhs.E + 64);
+    }
+
+    DiyFp Normalize() const
+    {
+        DiyFp res = *this;
+        while (!(res.F & (uint64_t(1) << 63)))
+        {
+            res.F <<= 1;
+            res.E--;
+        }
+        return res;
+    }
+
+    // Computes the normalized boundaries m- and m+ halfway to the neighboring doubles.
+    void NormalizedBoundaries(DiyFp* minus, DiyFp* plus) const
+    {
+        DiyFp pl = DiyFp((F << 1) + 1, E - 1).Normalize();
+        DiyFp mi = (F == uint64_t(0x0010000000000000ULL)) ? DiyFp((F << 2) - 1, E - 2) : DiyFp((F << 1) - 1, E - 1);
+        mi.F <<= mi.E - pl.E;
+        mi.E = pl.E;
+        *plus  = pl;
+        *minus = mi;
+    }
+};
+
+// Normalized powers of ten 10^-348, 10^-340, ..., 10^340.
+static const uint64_t CachedPowersF[] =
+{
+    uint64_t(0xfa8fd5a0081c0288ULL), uint64_t(0xbaaee17fa23ebf76ULL), uint64_t(0x8b16fb203055ac76ULL), uint64_t(0xcf42894a5dce35eaULL),
+    uint64_t(0x9a6bb0aa55653b2dULL), uint64_t(0xe61acf033d1a45dfULL), uint64_t(0xab70fe17c79ac6caULL), uint64_t(0xff77b1fcbebcdc4fULL),
+    uint64_t(0xbe5691ef416bd60cULL), uint64_t(0x8dd01fad907ffc3cULL), uint64_t(0xd3515c2831559a83ULL), uint64_t(0x9d71ac8fada6c9b5ULL),
+    uint64_t(0xea9c227723ee8bcbULL), uint64_t(0xaecc49914078536dULL), uint64_t(0x823c12795db6ce57ULL), uint64_t(0xc21094364dfb5637ULL),
+    uint64_t(0x9096ea6f3848984fULL), uint64_t(0xd77485cb25823ac7ULL), uint64_t(0xa086cfcd97bf97f4ULL), uint64_t(0xef340a98172aace5ULL),
+    uint64_t(0xb23867fb2a35b28eULL), uint64_t(0x84c8d4dfd2c63f3bULL), uint64_t(0xc5dd44271ad3cdbaULL), uint64_t(0x936b9fcebb25c996ULL),
+    uint64_t(0xdbac6c247d62a584ULL), uint64_t(0xa3ab66580d5fdaf6ULL), uint64_t(0xf3e2f893dec3f126ULL), uint64_t(0xb5b5ada8aaff80b8ULL),
+    uint64_t(0x87625f056c7c4a8bULL), uint64_t(0xc9bcff6034c13053ULL), uint64_t(0x964e858c91ba2655ULL), uint64_t(0xdff9772470297ebdULL),
+    uint64_t(0xa6dfbd9fb8e5b88fULL), uint64_t(0xf8a95fcf88747d94ULL), uint64_t(0xb94470938fa89bcfULL), uint64_t(0x8a08f0f8bf0f156bULL),
+    uint64_t(0xcdb02555653131b6ULL), uint64_t(0x993fe2c6d07b7facULL), uint64_t(0xe45c10c42a2b3b06ULL), uint64_t(0xaa242499697392d3ULL),
+    uint64_t(0xfd87b5f28300ca0eULL), uint64_t(0xbce5086492111aebULL), uint64_t(0x8cbccc096f5088ccULL), uint64_t(0xd1b71758e219652cULL),
+    uint64_t(0x9c40000000000000ULL), uint64_t(0xe8d4a51000000000ULL), uint64_t(0xad78ebc5ac620000ULL), uint64_t(0x813f3978f8940984ULL),
+    uint64_t(0xc097ce7bc90715b3ULL), uint64_t(0x8f7e32ce7bea5c70ULL), uint64_t(0xd5d238a4abe98068ULL), uint64_t(0x9f4f2726179a2245ULL),
+    uint64_t(0xed63a231d4c4fb27ULL), uint64_t(0xb0de65388cc8ada8ULL), uint64_t(0x83c7088e1aab65dbULL), uint64_t(0xc45d1df942711d9aULL),
+    uint64_t(0x924d692ca61be758ULL), uint64_t(0xda01ee641a708deaULL), uint64_t(0xa26da3999aef774aULL), uint64_t(0xf209787bb47d6b85ULL),
+    uint64_t(0xb454e4a179dd1877ULL), uint64_t(0x865b86925b9bc5c2ULL), uint64_t(0xc83553c5c8965d3dULL), uint64_t(0x952ab45cfa97a0b3ULL),
+    uint64_t(0xde469fbd99a05fe3ULL), uint64_t(0xa59bc234db398c25ULL), uint64_t(0xf6c69a72a3989f5cULL), uint64_t(0xb7dcbf5354e9beceULL),
+    uint64_t(0x88fcf317f22241e2ULL), uint64_t(0xcc20ce9bd35c78a5ULL), uint64_t(0x98165af37b2153dfULL), uint64_t(0xe2a0b5dc971f303aULL),
+    uint64_t(0xa8d9d1535ce3b396ULL), uint64_t(0xfb9b7cd9a4a7443cULL), uint64_t(0xbb764c4ca7a44410ULL), uint64_t(0x8bab8eefb6409c1aULL),
+    uint64_t(0xd01fef10a657842cULL), uint64_t(0x9b10a4e5e9913129ULL), uint64_t(0xe7109bfba19c0c9dULL), uint64_t(0xac2820d9623bf429ULL),
+    uint64_t(0x80444b5e7aa7cf85ULL), uint64_t(0xbf21e44003acdd2dULL), uint64_t(0x8e679c2f5e44ff8fULL), uint64_t(0xd433179d9c8cb841ULL),
+    uint64_t(0x9e19db92b4e31ba9ULL), uint64_t(0xeb96bf6ebadf77d9ULL), uint64_t(0xaf87023b9bf0ee6bULL),
+};
+
+static const int16_t CachedPowersE[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t Pow10U64[] =
+{
+    uint64_t(1ULL),                   uint64_t(10ULL),                   uint64_t(100ULL),
+    uint64_t(1000ULL),                uint64_t(10000ULL),                uint64_t(100000ULL),
+    uint64_t(1000000ULL),             uint64_t(10000000ULL),             uint64_t(100000000ULL),
+    uint64_t(1000000000ULL),          uint64_t(10000000000ULL),          uint64_t(100000000000ULL),
+    uint64_t(1000000000000ULL),       uint64_t(10000000000000ULL),       uint64_t(100000000000000ULL),
+    uint64_t(1000000000000000ULL),    uint64_t(10000000000000000ULL),    uint64_t(100000000000000000ULL),
+    uint64_t(1000000000000000000ULL), uint64_t(10000000000000000000ULL)
+};
+
+// Returns a cached power c_k = 10^-K such that e + c_k.E lands in [-60, -32].
+static DiyFp GetCachedPower(int e, int* K)
+{
+    double   dk    = (-61 - e) * 0.30102999566398114 + 347; // dk must be positive, so ceil is a truncation.
+    int      k     = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    return DiyFp(CachedPowersF[index], CachedPowersE[index]);
+}
+
+static int CountDecimalDigit32(uint32_t n)
+{
+    int count = 1;
+    while ((count < 10) && (n >= (uint32_t)Pow10U64[count]))
+        count++;
+    return count;
+}
+
+static void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+    while ((rest < wpw) && ((delta - rest) >= tenKappa) &&
+           (((rest + tenKappa) < wpw) || ((wpw - rest) > (rest + tenKappa - wpw))))
+    {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static void DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int* len, int* K)
+{
+    const DiyFp    one(uint64_t(1) << -Mp.E, Mp.E);
+    const DiyFp    wpw = Mp - W;
+    uint32_t       p1  = (uint32_t)(Mp.F >> -one.E);
+    uint64_t       p2  = Mp.F & (one.F - 1);
+    int            kappa = CountDecimalDigit32(p1);
+    *len = 0;
+
+    while (kappa > 0)
+    {
+        uint32_t divisor = (uint32_t)Pow10U64[kappa - 1];
+        uint32_t d       = p1 / divisor;
+        p1 %= divisor;
+
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+
+        uint64_t tmp = ((uint64_t)p1 << -one.E) + p2;
+        if (tmp <= delta)
+        {
+            *K += kappa;
+            GrisuRound(buffer, *len, delta, tmp, Pow10U64[kappa] << -one.E, wpw.F);
+            return;
+        }
+    }
+
+    for (;;)
+    {
+        p2    *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.E);
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one.F - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *K += kappa;
+            int index = -kappa;
+            GrisuRound(buffer, *len, delta, p2, one.F, wpw.F * ((index < 20) ? Pow10U64[index] : 0));
+            return;
+        }
+    }
+}
+
+// Produces the digits of a positive, finite, nonzero value: value = buffer * 10^K.
+static void Grisu2(double value, char* buffer, int* length, int* K)
+{
+    const DiyFp v(value);
+    DiyFp       wm, wp;
+    v.NormalizedBoundaries(&wm, &wp);
+
+    const DiyFp cmk = GetCachedPower(wp.E, K);
+    const DiyFp W   = v.Normalize() * cmk;
+    DiyFp       Wp  = wp * cmk;
+    DiyFp       Wm  = wm * cmk;
+    Wm.F++;
+    Wp.F--;
+    DigitGen(W, Wp, Wp.F - Wm.F, buffer, length, K);
+}
+
+static char* WriteExponent(int K, char* buffer)
+{
+    if (K < 0)
+    {
+        *buffer++ = '-';
+        K = -K;
+    }
+    if (K >= 100)
+    {
+        *buffer++ = (char)('0' + K / 100);
+        K %= 100;
+        *buffer++ = (char)('0' + K / 10);
+        *buffer++ = (char)('0' + K % 10);
+    }
+    else if (K >= 10)
+    {
+        *buffer++ = (char)('0' + K / 10);
+        *buffer++ = (char)('0' + K % 10);
+    }
+    else
+    {
+        *buffer++ = (char)('0' + K);
+    }
+    return buffer;
+}
+
+// Lays out digits * 10^k as plain decimal or exponent notation, whichever is more readable.
+// Returns the end of the string.
+static char* Prettify(char* buffer, int length, int k)
+{
+    const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+    if ((k >= 0) && (kk <= 21))
+    {
+        // 1234e7 -> 12340000000
+        for (int i = length; i < kk; i++)
+            buffer[i] = '0';
+        return &buffer[kk];
+    }
+    else if ((kk > 0) && (kk <= 21))
+    {
+        // 1234e-2 -> 12.34
+        memmove(&buffer[kk + 1], &buffer[kk], (size_t)(length - kk));
+        buffer[kk] = '.';
+        return &buffer[length + 1];
+    }
+    else if ((kk > -6) && (kk <= 0))
+    {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - kk;
+        memmove(&buffer[offset], &buffer[0], (size_t)length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for (int i = 2; i < offset; i++)
+            buffer[i] = '0';
+        return &buffer[length + offset];
+    }
+    else if (length == 1)
+    {
+        // 1e30
+        buffer[1] = 'e';
+        return WriteExponent(kk - 1, &buffer[2]);
+    }
+    else
+    {
+        // 1234e30 -> 1.234e33
+        memmove(&buffer[2], &buffer[1], (size_t)(length - 1));
+        buffer[1] = '.';
+        buffer[length + 1] = 'e';
+        return WriteExponent(kk - 1, &buffer[length + 2]);
+    }
+}
+
+} // namespace NumberFormat
+
+
+size_t OVR_CDECL OVR_FormatDouble(char* dest, size_t destsize, double value)
+{
+    using namespace NumberFormat;
+
+    char  buffer[OVR_FormatDoubleBufferSize];
+    char* p = buffer;
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (bits & uint64_t(0x8000000000000000ULL))
+    {
+        *p++  = '-';
+        bits &= uint64_t(0x7FFFFFFFFFFFFFFFULL);
+        memcpy(&value, &bits, sizeof(value));
+    }
+
+    if ((bits & uint64_t(0x7FF0000000000000ULL)) == uint64_t(0x7FF0000000000000ULL))
+    {
+        // Match the printf spelling so existing readers keep working.
+        if (bits & uint64_t(0x000FFFFFFFFFFFFFULL))
+            p = buffer; // No negative NaN.
+        const char* s = (bits & uint64_t(0x000FFFFFFFFFFFFFULL)) ? "nan" : "inf";
+        memcpy(p, s, 3);
+        p += 3;
+    }
+    else if (bits == 0)
+    {
+        *p++ = '0';
+    }
+    else
+    {
+        int length, K;
+        Grisu2(value, p, &length, &K);
+        p = Prettify(p, length, K);
+    }
+
+    size_t length = (size_t)(p - buffer);
+
+    if (destsize > 0)
+    {
+        if (length >= destsize)
+            length = destsize - 1;
+        memcpy(dest, buffer, length);
+        dest[length] = '\0';
+    }
+    return length;
+}
+
+
 #ifndef OVR_NO_WCTYPE
 
 //// Use this class to generate Unicode bitsets. For example:
@@ -232,6 +232,29 @@ inline char* OVR_CDECL OVR_strrchr(char* str, char c)
 
 double OVR_CDECL OVR_strtod(const char* string, char** tailptr);
 
+
+// Locale-independent number parsing. These always use '.' as the decimal point regardless
+// of the C library locale, don't allocate memory, and return the correctly rounded result.
+// Accepted syntax is [+|-] digits [. digits] [e|E [+|-] digits], plus "inf", "infinity"
+// and "nan" (case-insensitive). Leading whitespace is not skipped.
+// If tailptr is non-NULL, it receives the first character after the number, or str itself
+// if no number could be parsed (in which case the return value is 0).
+double  OVR_CDECL OVR_ParseDouble(const char* str, const char** tailptr = NULL);
+float   OVR_CDECL OVR_ParseFloat(const char* str, const char** tailptr = NULL);
+
+// Parses a base 10 integer with optional sign. Out of range values are clamped to
+// INT64_MIN / INT64_MAX.
+int64_t OVR_CDECL OVR_ParseInt(const char* str, const char** tailptr = NULL);
+
+// Writes the shortest string that parses back (with OVR_ParseDouble or strtod) to exactly
+// the same double, e.g. 0.1 -> "0.1", 1e300 -> "1e300", 12.0 -> "12". Always uses '.' as the
+// decimal point. Returns the string length, truncating the output if destsize is too small.
+// A dest buffer of OVR_FormatDoubleBufferSize is always sufficient.
+static const size_t OVR_FormatDoubleBufferSize = 32;
+
+size_t  OVR_CDECL OVR_FormatDouble(char* dest, size_t destsize, double value);
+
+
 inline long OVR_CDECL OVR_strtol(const char* string, char** tailptr, int radix)
 {
     return strtol(string, tailptr, radix);
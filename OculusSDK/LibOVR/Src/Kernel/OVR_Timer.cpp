@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "OVR_Timer.h"
 #include "OVR_Log.h"
+#include "OVR_Lockless.h"
 
 #if defined(OVR_OS_MS) && !defined(OVR_OS_MS_MOBILE)
 #define WIN32_LEAN_AND_MEAN
@@ -42,6 +43,15 @@ limitations under the License.
 #include <errno.h>
 #endif
 
+#if defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)
+    #if defined(OVR_CC_MSVC)
+        #include <intrin.h>   // __rdtsc, __cpuid
+    #else
+        #include <x86intrin.h>
+        #include <cpuid.h>
+    #endif
+#endif
+
 
 #if defined(OVR_BUILD_DEBUG) && defined(OVR_OS_WIN32)
     #ifndef NTSTATUS
@@ -78,6 +88,300 @@ double Timer::FakeSeconds    = 0;
 
 
 
+//------------------------------------------------------------------------
+// *** Invariant TSC Timer
+
+// Reading the CPU time stamp counter costs a few nanoseconds, while QueryPerformanceCounter
+// and clock_gettime cost tens to hundreds. When the CPU reports an invariant TSC (constant rate
+// in all power states, synchronized across cores) we calibrate it against the OS monotonic clock
+// and serve GetSeconds/GetTicksNanos from it.
+//
+// Calibration is kept as a base point plus a rate, and is periodically re-anchored against the
+// OS clock. The rate is measured over the whole run, so it gets more accurate over time, and
+// any accumulated error is slewed out over the next interval rather than stepped, keeping the
+// result continuous. Only falling far behind the OS clock (e.g. after suspend/resume) causes a
+// step, and then only forward; being far ahead is slewed out over as many intervals as needed,
+// so the result never goes backwards.
+
+#if (defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)) && (defined(OVR_OS_WIN32) || (!defined(OVR_OS_ANDROID) && !defined(OVR_OS_MS) && !defined(OVR_OS_MAC)))
+    #define OVR_TIMER_TSC_SUPPORTED
+#endif
+
+struct TSCCalibration
+{
+    uint64_t BaseTicks;         // TSC value at the calibration point.
+    uint64_t BaseNanos;         // Time in nanoseconds at BaseTicks.
+    double   NanosPerTick;      // Rate used from BaseTicks on, including slew correction.
+    double   MeasuredNanosPerTick; // Long term measured rate, used for converting raw tick differences.
+};
+
+class TSCTimer
+{
+public:
+    typedef uint64_t (*ReferenceClockFunc)();
+
+    TSCTimer()
+        : Available(false),
+          ReferenceClock(NULL),
+          FirstTicks(0),
+          FirstNanos(0),
+          RecalibrateIntervalTicks(0),
+          RecalibrateLock(0),
+          Calibration()
+    { }
+
+    enum {
+        InitialCalibrationNanos = 2000000,      // Busy wait at startup; refined later on.
+        RecalibrateIntervalNanos = 100000000,
+        MaxSlewNanos            = 1000000       // Falling further behind causes a step instead of a slew.
+    };
+
+    void        Initialize(ReferenceClockFunc referenceClock);
+    bool        IsAvailable() const { return Available; }
+    uint64_t    GetTimeNanos();
+    double      GetNanosPerTick() const { return Calibration.GetState().MeasuredNanosPerTick; }
+
+    static uint64_t ReadTicks()
+    {
+    #if defined(OVR_TIMER_TSC_SUPPORTED)
+        return __rdtsc();
+    #else
+        return 0;
+    #endif
+    }
+
+private:
+    static bool isInvariantTSCSupported();
+    void        sampleClocks(uint64_t& ticks, uint64_t& nanos) const;
+    void        recalibrate();
+
+    bool               Available;
+    ReferenceClockFunc ReferenceClock;
+    uint64_t           FirstTicks;      // Long term calibration baseline.
+    uint64_t           FirstNanos;
+    uint64_t           RecalibrateIntervalTicks;
+    AtomicInt<int>     RecalibrateLock; // Only one thread re-anchors at a time; others keep the current calibration.
+    LocklessUpdater<TSCCalibration, TSCCalibration> Calibration;
+};
+
+static TSCTimer TSC_Timer;
+
+
+bool TSCTimer::isInvariantTSCSupported()
+{
+#if defined(OVR_TIMER_TSC_SUPPORTED)
+    unsigned regs[4] = { 0, 0, 0, 0 };
+
+    #if defined(OVR_CC_MSVC)
+        __cpuid((int*)regs, 0x80000000);
+        if (regs[0] < 0x80000007)
+            return false;
+        __cpuid((int*)regs, 0x80000007);
+    #else
+        if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+            return false;
+        __get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+    #endif
+
+    if ((regs[3] & (1 << 8)) == 0) // EDX bit 8: Invariant TSC
+        return false;
+
+    #if defined(OVR_OS_LINUX)
+        // Defer to the kernel, which stops trusting the TSC if it finds it unsynchronized
+        // between sockets or unstable under virtualization.
+        FILE* f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+        if (f)
+        {
+            char source[32] = {};
+            bool isTSC = fgets(source, sizeof(source), f) && (strncmp(source, "tsc", 3) == 0);
+            fclose(f);
+            return isTSC;
+        }
+    #endif
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// Reads the TSC and reference clock as close together as possible. The reference clock
+// read is bracketed by two TSC reads, and the tightest of several tries is kept.
+void TSCTimer::sampleClocks(uint64_t& ticks, uint64_t& nanos) const
+{
+    uint64_t bestWidth = ~uint64_t(0);
+
+    for (int i = 0; i < 5; i++)
+    {
+        const uint64_t before   = ReadTicks();
+        const uint64_t refNanos = ReferenceClock();
+        const uint64_t after    = ReadTicks();
+
+        if ((after >= before) && ((after - before) < bestWidth))
+        {
+            bestWidth = after - before;
+            ticks     = before + ((after - before) / 2);
+            nanos     = refNanos;
+        }
+    }
+
+    if (bestWidth == ~uint64_t(0)) // TSC went backwards every time; shouldn't happen with an invariant TSC.
+    {
+        ticks = ReadTicks();
+        nanos = ReferenceClock();
+    }
+}
+
+
+void TSCTimer::Initialize(ReferenceClockFunc referenceClock)
+{
+    ReferenceClock = referenceClock;
+    Available      = false;
+
+    if (!isInvariantTSCSupported())
+    {
+        OVR_DEBUG_LOG(("TSCTimer: Invariant TSC not available, using OS timer."));
+        return;
+    }
+
+    uint64_t endTicks, endNanos;
+    sampleClocks(FirstTicks, FirstNanos);
+    do
+    {
+        sampleClocks(endTicks, endNanos);
+    } while ((endNanos - FirstNanos) < InitialCalibrationNanos);
+
+    if (endTicks <= FirstTicks)
+    {
+        OVR_DEBUG_LOG(("TSCTimer: TSC is not advancing, using OS timer."));
+        return;
+    }
+
+    TSCCalibration c;
+    c.BaseTicks            = endTicks;
+    c.BaseNanos            = endNanos;
+    c.NanosPerTick         = (double)(endNanos - FirstNanos) / (double)(endTicks - FirstTicks);
+    c.MeasuredNanosPerTick = c.NanosPerTick;
+    Calibration.SetState(c);
+
+    RecalibrateIntervalTicks = (uint64_t)(RecalibrateIntervalNanos / c.NanosPerTick);
+    Available = true;
+
+    OVR_DEBUG_LOG(("TSCTimer: Using invariant TSC at %.3f MHz.", 1000.0 / c.NanosPerTick));
+}
+
+
+uint64_t TSCTimer::GetTimeNanos()
+{
+    const uint64_t ticks = ReadTicks();
+    TSCCalibration c     = Calibration.GetState();
+
+    // Another thread may have re-anchored after we read the TSC, so ticks can be slightly behind BaseTicks.
+    const int64_t deltaTicks = (int64_t)(ticks - c.BaseTicks);
+
+    if (deltaTicks >= (int64_t)RecalibrateIntervalTicks)
+    {
+        recalibrate();
+        c = Calibration.GetState();
+        return c.BaseNanos + (int64_t)((int64_t)(ticks - c.BaseTicks) * c.NanosPerTick);
+    }
+
+    return c.BaseNanos + (int64_t)(deltaTicks * c.NanosPerTick);
+}
+
+
+void TSCTimer::recalibrate()
+{
+    if (!RecalibrateLock.CompareAndSet_Sync(0, 1))
+        return;
+
+    uint64_t ticks, nanos;
+    sampleClocks(ticks, nanos);
+
+    const TSCCalibration old = Calibration.GetState();
+    TSCCalibration       c;
+
+    if ((ticks <= FirstTicks) || (nanos <= FirstNanos))
+    {
+        // The TSC was reset (e.g. resume from hibernation); start the long term baseline over.
+        FirstTicks = ticks - 1;
+        FirstNanos = nanos;
+        c.MeasuredNanosPerTick = old.MeasuredNanosPerTick;
+    }
+    else
+    {
+        c.MeasuredNanosPerTick = (double)(nanos - FirstNanos) / (double)(ticks - FirstTicks);
+    }
+
+    // Where the current calibration puts this moment. Times already handed out are at most
+    // this, so the new calibration starts here. After a TSC reset there is nothing to
+    // extrapolate from, so it starts from the old base point.
+    uint64_t predictedNanos = old.BaseNanos;
+    if (ticks > old.BaseTicks)
+        predictedNanos += (uint64_t)((double)(ticks - old.BaseTicks) * old.NanosPerTick);
+
+    const int64_t errorNanos = (int64_t)(nanos - predictedNanos);
+
+    c.BaseTicks = ticks;
+
+    if (errorNanos > MaxSlewNanos)
+    {
+        c.BaseNanos    = nanos;
+        c.NanosPerTick = c.MeasuredNanosPerTick;
+    }
+    else
+    {
+        // Stay continuous and make up the error over the next interval. When far ahead of the
+        // OS clock, run no slower than half speed; the offset left over carries into the
+        // following intervals until it is gone.
+        double correction = (double)errorNanos / (double)RecalibrateIntervalTicks;
+        if (correction < -0.5 * c.MeasuredNanosPerTick)
+            correction = -0.5 * c.MeasuredNanosPerTick;
+
+        c.BaseNanos    = predictedNanos;
+        c.NanosPerTick = c.MeasuredNanosPerTick + correction;
+    }
+
+    Calibration.SetState(c);
+    RecalibrateLock.Store_Release(0);
+}
+
+
+//------------------------------------------------------------------------
+// *** Timer - Raw timestamps
+
+uint64_t Timer::GetTicks()
+{
+    if (TSC_Timer.IsAvailable())
+        return TSCTimer::ReadTicks();
+
+    return GetTicksNanos();
+}
+
+double Timer::TicksToSeconds(uint64_t ticks)
+{
+    if (TSC_Timer.IsAvailable())
+        return (ticks * TSC_Timer.GetNanosPerTick()) * 1e-9;
+
+    return ticks * 1e-9;
+}
+
+uint64_t Timer::TicksToNanos(uint64_t ticks)
+{
+    if (TSC_Timer.IsAvailable())
+        return (uint64_t)(ticks * TSC_Timer.GetNanosPerTick());
+
+    return ticks;
+}
+
+bool Timer::IsUsingTSC()
+{
+    return TSC_Timer.IsAvailable();
+}
+
+
+
 //------------------------------------------------------------------------
 // *** Android Specific Timer
 
@@ -399,6 +703,9 @@ double Timer::GetSeconds()
 	if(useFakeSeconds)
 		return FakeSeconds;
 
+    if (TSC_Timer.IsAvailable())
+        return TSC_Timer.GetTimeNanos() * .000000001;
+
     return Win32_PerfTimer.GetTimeSecondsDouble();
 }
 
@@ -410,11 +717,22 @@ uint64_t Timer::GetTicksNanos()
     if (useFakeSeconds)
         return (uint64_t) (FakeSeconds * NanosPerSecond);
 
+    if (TSC_Timer.IsAvailable())
+        return TSC_Timer.GetTimeNanos();
+
+    return Win32_PerfTimer.GetTimeNanos();
+}
+
+// Reference clock the TSC is calibrated against.
+static uint64_t GetPerfTimerNanos()
+{
     return Win32_PerfTimer.GetTimeNanos();
 }
+
 void Timer::initializeTimerSystem()
 {
     Win32_PerfTimer.Initialize();
+    TSC_Timer.Initialize(&GetPerfTimerNanos);
 }
 void Timer::shutdownTimerSystem()
 {
@@ -473,6 +791,17 @@ void Timer::shutdownTimerSystem()
 bool Timer::MonotonicClockAvailable = false;
 
 
+#if defined(CLOCK_MONOTONIC)
+// Reference clock the TSC is calibrated against.
+static uint64_t GetMonotonicNanos()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+
 // Returns global high-resolution application timer in seconds.
 double Timer::GetSeconds()
 {
@@ -480,6 +809,9 @@ double Timer::GetSeconds()
 		return FakeSeconds;
 
     // http://linux/die/netman3/clock_gettime
+    if (TSC_Timer.IsAvailable())
+        return TSC_Timer.GetTimeNanos() * 1E-9;
+
     #if defined(CLOCK_MONOTONIC) // If we can use clock_gettime, which has nanosecond precision...
         if(MonotonicClockAvailable)
         {
@@ -489,7 +821,7 @@ double Timer::GetSeconds()
         }
     #endif
 
-    // We cannot use rdtsc because its frequency changes at runtime.
+    // No monotonic clock to calibrate the TSC against, so fall back to the system time.
     struct timeval tv;
     gettimeofday(&tv, 0);
 
@@ -502,6 +834,9 @@ uint64_t Timer::GetTicksNanos()
     if (useFakeSeconds)
         return (uint64_t) (FakeSeconds * NanosPerSecond);
 
+    if (TSC_Timer.IsAvailable())
+        return TSC_Timer.GetTimeNanos();
+
     #if defined(CLOCK_MONOTONIC) // If we can use clock_gettime, which has nanosecond precision...
         if(MonotonicClockAvailable)
         {
@@ -512,7 +847,7 @@ uint64_t Timer::GetTicksNanos()
     #endif
 
 
-    // We cannot use rdtsc because its frequency changes at runtime.
+    // No monotonic clock to calibrate the TSC against, so fall back to the system time.
 	uint64_t result;
 
     // Return microseconds.
@@ -533,6 +868,10 @@ void Timer::initializeTimerSystem()
         timespec ts; // We could also check for the availability of CLOCK_MONOTONIC with sysconf(_SC_MONOTONIC_CLOCK)
         int result = clock_gettime(CLOCK_MONOTONIC, &ts);
         MonotonicClockAvailable = (result == 0);
+
+        // The TSC is only used when there's a monotonic clock to calibrate it against.
+        if (MonotonicClockAvailable)
+            TSC_Timer.Initialize(&GetMonotonicNanos);
     #endif
 }
 
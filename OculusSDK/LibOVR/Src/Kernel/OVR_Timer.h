@@ -64,6 +64,19 @@ public:
     static uint32_t  OVR_STDCALL GetTicksMs()
     { return  uint32_t(GetTicksNanos() / 1000000); }
 
+    // ***** Raw Timestamps for Instrumentation
+
+    // GetTicks returns a raw timestamp in unspecified units, as cheaply as the platform allows:
+    // a bare RDTSC when the CPU has an invariant TSC, otherwise GetTicksNanos().
+    // Only differences between two values are meaningful; convert them with TicksToSeconds
+    // or TicksToNanos. Unaffected by SetFakeSeconds.
+    static uint64_t  OVR_STDCALL GetTicks();
+    static double    OVR_STDCALL TicksToSeconds(uint64_t ticks);
+    static uint64_t  OVR_STDCALL TicksToNanos(uint64_t ticks);
+
+    // Returns true if GetTicks and the calibrated GetSeconds/GetTicksNanos use the invariant TSC.
+    static bool      IsUsingTSC();
+
     // for recorded data playback
     static void SetFakeSeconds(double fakeSeconds, bool enable = true) 
     { 
@@ -25,6 +25,8 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_BitStream.h"
+#include "../OVR_JSON.h"
+#include "../Kernel/OVR_System.h"
 
 #ifdef OVR_OS_WIN32
 #include <WinSock2.h>
@@ -35,6 +37,122 @@ limitations under the License.
 namespace OVR { namespace Net {
 
 
+//-----------------------------------------------------------------------------
+// BitStreamBufferPool
+
+// Recycles the heap buffers of BitStreams that outgrow stackData. Buffers are
+// kept in power-of-two size classes so that once each class has been used the
+// steady-state send path stops reaching the allocator. The free lists are shared
+// and guarded by a Lock rather than kept per thread; see the note about TLS and
+// DLLs in the threads module. Buffers larger than the biggest class are not
+// pooled and go straight to OVR_ALLOC/OVR_FREE.
+class BitStreamBufferPool : public NewOverrideBase, public SystemSingletonBase<BitStreamBufferPool>
+{
+    OVR_DECLARE_SINGLETON(BitStreamBufferPool);
+
+public:
+    enum
+    {
+        MinClassShift     = 9,  // 512 bytes, the first size above BITSTREAM_STACK_ALLOCATION_SIZE
+        ClassCount        = 8,  // 512 bytes .. 64 KB
+        MaxCachedPerClass = 16
+    };
+
+    // Returns the capacity Alloc() hands out for a request of this many bytes.
+    static BitSize_t RoundUp(BitSize_t bytes)
+    {
+        if (bytes > ((BitSize_t)1 << (MinClassShift + ClassCount - 1)))
+            return bytes;
+
+        BitSize_t capacity = (BitSize_t)1 << MinClassShift;
+        while (capacity < bytes)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    static bool IsPooledSize(BitSize_t bytes)
+    {
+        return getClass(bytes) >= 0;
+    }
+
+    // bytes must have been passed through RoundUp().
+    unsigned char* Alloc(BitSize_t bytes)
+    {
+        int sizeClass = getClass(bytes);
+        if (sizeClass >= 0)
+        {
+            Lock::Locker locker(&PoolLock);
+
+            if (FreeCount[sizeClass] > 0)
+                return FreeLists[sizeClass][--FreeCount[sizeClass]];
+        }
+        return (unsigned char*) OVR_ALLOC((size_t) bytes);
+    }
+
+    // bytes is the capacity the buffer was allocated with.
+    void Free(unsigned char* p, BitSize_t bytes)
+    {
+        int sizeClass = getClass(bytes);
+        if (sizeClass >= 0)
+        {
+            Lock::Locker locker(&PoolLock);
+
+            if (FreeCount[sizeClass] < MaxCachedPerClass)
+            {
+                FreeLists[sizeClass][FreeCount[sizeClass]++] = p;
+                return;
+            }
+        }
+        OVR_FREE(p);
+    }
+
+private:
+    // Returns the size class holding buffers of exactly this many bytes, or -1.
+    static int getClass(BitSize_t bytes)
+    {
+        for (int i = 0; i < ClassCount; ++i)
+        {
+            if (bytes == ((BitSize_t)1 << (MinClassShift + i)))
+                return i;
+        }
+        return -1;
+    }
+
+    Lock           PoolLock;
+    unsigned char* FreeLists[ClassCount][MaxCachedPerClass];
+    int            FreeCount[ClassCount];
+};
+
+BitStreamBufferPool::BitStreamBufferPool()
+{
+    memset(FreeCount, 0, sizeof(FreeCount));
+
+    // Must be at end of function
+    PushDestroyCallbacks();
+}
+
+BitStreamBufferPool::~BitStreamBufferPool()
+{
+    for (int i = 0; i < ClassCount; ++i)
+    {
+        while (FreeCount[i] > 0)
+            OVR_FREE(FreeLists[i][--FreeCount[i]]);
+    }
+}
+
+void BitStreamBufferPool::OnSystemDestroy()
+{
+    delete this;
+}
+
+
+}} // OVR::Net
+
+OVR_DEFINE_SINGLETON(OVR::Net::BitStreamBufferPool);
+
+namespace OVR { namespace Net {
+
+
 //-----------------------------------------------------------------------------
 // BitStream
 	
@@ -65,8 +183,9 @@ BitStream::BitStream( const unsigned int initialBytesToAllocate )
 	}
 	else
 	{
-		data = ( unsigned char* ) OVR_ALLOC( (size_t) initialBytesToAllocate);
-		numberOfBitsAllocated = initialBytesToAllocate << 3;
+		BitSize_t capacity = BitStreamBufferPool::RoundUp( initialBytesToAllocate );
+		data = BitStreamBufferPool::GetInstance()->Alloc( capacity );
+		numberOfBitsAllocated = capacity << 3;
 	}
 #ifdef _DEBUG
 	OVR_ASSERT( data );
@@ -84,24 +203,22 @@ BitStream::BitStream( char* _data, const unsigned int lengthInBytes, bool _copyD
 
 	if ( copyData )
 	{
-		if ( lengthInBytes > 0 )
+		if (lengthInBytes <= BITSTREAM_STACK_ALLOCATION_SIZE)
 		{
-			if (lengthInBytes < BITSTREAM_STACK_ALLOCATION_SIZE)
-			{
-				data = ( unsigned char* ) stackData;
-				numberOfBitsAllocated = BITSTREAM_STACK_ALLOCATION_SIZE << 3;
-			}
-			else
-			{
-				data = ( unsigned char* ) OVR_ALLOC( (size_t) lengthInBytes);
-			}
+			data = ( unsigned char* ) stackData;
+			numberOfBitsAllocated = BITSTREAM_STACK_ALLOCATION_SIZE << 3;
+		}
+		else
+		{
+			BitSize_t capacity = BitStreamBufferPool::RoundUp( lengthInBytes );
+			data = BitStreamBufferPool::GetInstance()->Alloc( capacity );
+			numberOfBitsAllocated = capacity << 3;
+		}
 #ifdef _DEBUG
-			OVR_ASSERT( data );
+		OVR_ASSERT( data );
 #endif
+		if ( lengthInBytes > 0 )
 			memcpy( data, _data, (size_t) lengthInBytes );
-		}
-		else
-			data = 0;
 	}
 	else
 		data = ( unsigned char* ) _data;
@@ -118,8 +235,8 @@ void BitStream::SetNumberOfBitsAllocated( const BitSize_t lengthInBits )
 
 BitStream::~BitStream()
 {
-	if ( copyData && numberOfBitsAllocated > (BITSTREAM_STACK_ALLOCATION_SIZE << 3))
-		OVR_FREE( data );  // Use realloc and free so we are more efficient than delete and new for resizing
+	if ( copyData && data && data != stackData )
+		BitStreamBufferPool::GetInstance()->Free( data, BITS_TO_BYTES( numberOfBitsAllocated ) );
 }
 
 void BitStream::Reset( void )
@@ -456,6 +573,114 @@ void BitStream::WriteBits( const unsigned char* inByteArray, BitSize_t numberOfB
 	// } while(numberOfBitsToWrite>0);
 }
 
+// Writes a LEB128 varint: 7 bits per byte, low group first, high bit set on all but the last byte
+void BitStream::WriteVarInt( uint64_t value )
+{
+	unsigned char buffer[10];
+	unsigned int length = 0;
+
+	while ( value >= 0x80 )
+	{
+		buffer[ length++ ] = (unsigned char) ( value | 0x80 );
+		value >>= 7;
+	}
+	buffer[ length++ ] = (unsigned char) value;
+
+	Write( (const char*) buffer, length );
+}
+
+// Zigzag maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ... so small magnitudes encode in few bytes
+void BitStream::WriteVarIntSigned( int64_t value )
+{
+	WriteVarInt( ( (uint64_t) value << 1 ) ^ (uint64_t) ( value >> 63 ) );
+}
+
+// Like the other Read functions, a failed read leaves the read offset where it was
+bool BitStream::ReadVarInt( uint64_t &value )
+{
+	const BitSize_t start = readOffset;
+	uint64_t result = 0;
+	unsigned int shift = 0;
+
+	for (;;)
+	{
+		unsigned char byte;
+
+		// Parse straight out of the buffer when aligned
+		if ( ( readOffset & 7 ) == 0 )
+		{
+			if ( readOffset + 8 > numberOfBitsUsed )
+				break;
+			byte = data[ readOffset >> 3 ];
+			readOffset += 8;
+		}
+		else if ( ReadBits( &byte, 8 ) == false )
+			break;
+
+		// The tenth byte may only hold the top bit of a 64 bit value
+		if ( shift == 63 && ( byte & 0x7E ) != 0 )
+			break;
+
+		result |= (uint64_t) ( byte & 0x7F ) << shift;
+		if ( ( byte & 0x80 ) == 0 )
+		{
+			// A zero last byte means the value had a shorter encoding; WriteVarInt() never emits one,
+			// and accepting it would give the same value more than one valid encoding
+			if ( byte == 0 && shift != 0 )
+				break;
+
+			value = result;
+			return true;
+		}
+
+		shift += 7;
+		if ( shift > 63 )
+			break;
+	}
+
+	readOffset = start;
+	return false;
+}
+
+bool BitStream::ReadVarInt( uint32_t &value )
+{
+	const BitSize_t start = readOffset;
+	uint64_t v;
+	if ( ReadVarInt( v ) == false )
+		return false;
+	if ( v > 0xFFFFFFFFu )
+	{
+		readOffset = start;
+		return false;
+	}
+	value = (uint32_t) v;
+	return true;
+}
+
+bool BitStream::ReadVarIntSigned( int64_t &value )
+{
+	uint64_t v;
+	if ( ReadVarInt( v ) == false )
+		return false;
+	value = (int64_t) ( v >> 1 ) ^ -(int64_t) ( v & 1 );
+	return true;
+}
+
+bool BitStream::ReadVarIntSigned( int32_t &value )
+{
+	const BitSize_t start = readOffset;
+	int64_t v;
+	if ( ReadVarIntSigned( v ) == false )
+		return false;
+	if ( v < INT32_MIN || v > INT32_MAX )
+	{
+		readOffset = start;
+		return false;
+	}
+	value = (int32_t) v;
+	return true;
+}
+
 // Set the stream to some initial data.  For internal use
 void BitStream::SetData( unsigned char *inByteArray )
 {
@@ -688,25 +913,43 @@ void BitStream::AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite )
 			newNumberOfBitsAllocated = numberOfBitsToWrite + numberOfBitsUsed + 1048576;
 
 		//		BitSize_t newByteOffset = BITS_TO_BYTES( numberOfBitsAllocated );
-		// Use realloc and free so we are more efficient than delete and new for resizing
-		BitSize_t amountToAllocate = BITS_TO_BYTES( newNumberOfBitsAllocated );
+		// Heap buffers come from the size-classed pool, so grow by moving to the next class
+		BitSize_t amountToAllocate = BitStreamBufferPool::RoundUp( BITS_TO_BYTES( newNumberOfBitsAllocated ) );
+		BitSize_t amountAllocated = BITS_TO_BYTES( numberOfBitsAllocated );
 		if (data==(unsigned char*)stackData)
 		{
 			if (amountToAllocate > BITSTREAM_STACK_ALLOCATION_SIZE)
 			{
-				data = ( unsigned char* ) OVR_ALLOC( (size_t) amountToAllocate);
+				data = BitStreamBufferPool::GetInstance()->Alloc( amountToAllocate );
 				OVR_ASSERT(data);
                 if (data)
 				{
                     // need to copy the stack data over to our new memory area too
-                    memcpy ((void *)data, (void *)stackData, (size_t) BITS_TO_BYTES( numberOfBitsAllocated ));
+                    memcpy ((void *)data, (void *)stackData, (size_t) amountAllocated);
                 }
 			}
+			else
+			{
+				amountToAllocate = amountAllocated;
+			}
+		}
+		else if (BitStreamBufferPool::IsPooledSize( amountAllocated ))
+		{
+			unsigned char* newData = BitStreamBufferPool::GetInstance()->Alloc( amountToAllocate );
+			OVR_ASSERT(newData);
+			if (newData)
+			{
+				memcpy ((void *)newData, (void *)data, (size_t) BITS_TO_BYTES( numberOfBitsUsed ));
+			}
+			BitStreamBufferPool::GetInstance()->Free( data, amountAllocated );
+			data = newData;
 		}
 		else
 		{
+			// Past the largest size class; realloc as before
 			data = ( unsigned char* ) OVR_REALLOC( data, (size_t) amountToAllocate);
 		}
+		newNumberOfBitsAllocated = amountToAllocate << 3;
 
 #ifdef _DEBUG
 		OVR_ASSERT( data ); // Make sure realloc succeeded
@@ -894,6 +1137,32 @@ void BitStream::IgnoreBits( const BitSize_t numberOfBits )
 	readOffset += numberOfBits;
 }
 
+void BitStream::WriteJSON( JSON* json )
+{
+	ArrayPOD<uint8_t> buffer;
+	json->WriteBinary(buffer);
+
+	unsigned int length = (unsigned int) buffer.GetSize();
+	WriteCompressed(length);
+	WriteAlignedBytes(buffer.GetDataPtr(), length);
+}
+
+JSON* BitStream::ReadJSON( void )
+{
+	unsigned int length;
+	if (ReadCompressed(length)==false || length == 0)
+		return 0;
+
+	AlignReadToByteBoundary();
+	if (readOffset > numberOfBitsUsed || length > (GetNumberOfUnreadBits() >> 3))
+		return 0;
+
+	// Decode straight out of the stream's buffer
+	JSON* json = JSON::ParseBinary(data + ( readOffset >> 3 ), length);
+	readOffset += BYTES_TO_BITS(length);
+	return json;
+}
+
 void BitStream::IgnoreBytes( const unsigned int numberOfBytes )
 {
 	IgnoreBits(BYTES_TO_BITS(numberOfBytes));
@@ -956,20 +1225,27 @@ void BitStream::AssertCopyData( void )
 	{
 		copyData = true;
 
-		if ( numberOfBitsAllocated > 0 )
+		BitSize_t amountToCopy = BITS_TO_BYTES( numberOfBitsAllocated );
+		unsigned char * newdata;
+		if ( amountToCopy <= BITSTREAM_STACK_ALLOCATION_SIZE )
+		{
+			newdata = stackData;
+			numberOfBitsAllocated = BITSTREAM_STACK_ALLOCATION_SIZE << 3;
+		}
+		else
 		{
-			unsigned char * newdata = ( unsigned char* ) OVR_ALLOC( (size_t) BITS_TO_BYTES( numberOfBitsAllocated ));
+			BitSize_t capacity = BitStreamBufferPool::RoundUp( amountToCopy );
+			newdata = BitStreamBufferPool::GetInstance()->Alloc( capacity );
+			numberOfBitsAllocated = capacity << 3;
+		}
 #ifdef _DEBUG
 
-			OVR_ASSERT( data );
+		OVR_ASSERT( data );
 #endif
 
-			memcpy( newdata, data, (size_t) BITS_TO_BYTES( numberOfBitsAllocated ) );
-			data = newdata;
-		}
-
-		else
-			data = 0;
+		if ( amountToCopy > 0 )
+			memcpy( newdata, data, (size_t) amountToCopy );
+		data = newdata;
 	}
 }
 bool BitStream::IsNetworkOrderInternal(void)
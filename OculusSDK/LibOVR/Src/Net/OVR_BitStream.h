@@ -29,11 +29,16 @@ limitations under the License.
 #define OVR_Bitstream_h
 
 #include <math.h>
+#include <limits.h>
 #include "../Kernel/OVR_Types.h"
 #include "../Kernel/OVR_Std.h"
 #include "../Kernel/OVR_String.h"
 
-namespace OVR { namespace Net {
+namespace OVR {
+
+class JSON;
+
+namespace Net {
 
 typedef uint32_t BitSize_t;
 #define BITSTREAM_STACK_ALLOCATION_SIZE 256
@@ -577,6 +582,54 @@ public:
 	bool ReadAlignedBytesSafeAlloc( char **outByteArray, int &inputLength, const unsigned int maxBytesToRead );
 	bool ReadAlignedBytesSafeAlloc( char **outByteArray, unsigned int &inputLength, const unsigned int maxBytesToRead );
 
+	/// \brief Writes an unsigned integer as a LEB128 varint: 7 bits per byte, low bits first.
+	/// \details Takes 1 byte for values below 128 and at most 10 bytes for a full 64 bit value.
+	/// Unlike WriteCompressed(), the encoding is byte oriented and independent of the type's size.
+	/// \param[in] value The value to write
+	void WriteVarInt( uint64_t value );
+
+	/// \brief Writes a signed integer as a zigzag-encoded LEB128 varint, so small negative values stay small.
+	/// \param[in] value The value to write
+	void WriteVarIntSigned( int64_t value );
+
+	/// \brief Reads a value written with WriteVarInt().
+	/// \return true on success, false on truncated or malformed data (including overlong encodings), or if the value does not fit.
+	bool ReadVarInt( uint64_t &value );
+	bool ReadVarInt( uint32_t &value );
+
+	/// \brief Reads a value written with WriteVarIntSigned().
+	/// \return true on success, false on truncated or malformed data, or if the value does not fit.
+	bool ReadVarIntSigned( int64_t &value );
+	bool ReadVarIntSigned( int32_t &value );
+
+	/// \brief Byte aligns the stream and writes \a count elements of a POD type in one block.
+	/// \details No count is written; send it separately, for example with WriteVarInt().
+	/// By default the elements are copied in host byte order with a single memcpy. Pass true for
+	/// \a endianSwap to convert each element the way Write() does; for structures of scalars
+	/// (poses, IMU samples) pass a pointer to the scalar type so each scalar is swapped.
+	/// \param[in] values The elements to write
+	/// \param[in] count The number of elements
+	/// \param[in] endianSwap true to store the elements in network byte order
+	template <class templateType>
+	void WriteArray( const templateType *values, const unsigned int count, bool endianSwap = false );
+
+	/// \brief Reads \a count elements written with WriteArray().
+	/// \param[out] values Receives the elements
+	/// \param[in] count The number of elements
+	/// \param[in] endianSwap Must match the value passed to WriteArray()
+	/// \return true on success, false if the stream does not hold \a count elements.
+	template <class templateType>
+	bool ReadArray( templateType *values, const unsigned int count, bool endianSwap = false );
+
+	/// \brief Writes a JSON tree in its compact binary encoding, preceded by its length.
+	/// \details Smaller and faster to decode than sending the text form as a String.
+	/// \param[in] json The tree to write
+	void WriteJSON( JSON* json );
+
+	/// \brief Reads a JSON tree written with WriteJSON().
+	/// \return The tree, which must be Released, or 0 on failure.
+	JSON* ReadJSON( void );
+
 	/// \brief Align the next write and/or read to a byte boundary.  
 	/// \details This can be used to 'waste' bits to byte align for efficiency reasons It
 	/// can also be used to force coalesced bitstreams to start on byte
@@ -978,6 +1031,20 @@ inline void BitStream::Write(const templateType &inTemplateVar)
 #ifdef OVR_CC_MSVC
 #pragma warning(disable:4127)   // conditional expression is constant
 #endif
+	// Byte aligned with room left: store in place rather than going through WriteBits
+	if ((numberOfBitsUsed & 7) == 0 && numberOfBitsAllocated - numberOfBitsUsed >= sizeof(templateType) * 8)
+	{
+		unsigned char* dest = data + (numberOfBitsUsed >> 3);
+#ifndef __BITSTREAM_NATIVE_END
+		if (sizeof(templateType) > 1 && DoEndianSwap())
+			ReverseBytes((unsigned char*)&inTemplateVar, dest, sizeof(templateType));
+		else
+#endif
+			memcpy(dest, &inTemplateVar, sizeof(templateType));
+		numberOfBitsUsed += sizeof(templateType) * 8;
+		return;
+	}
+
 	if (sizeof(inTemplateVar)==1)
 		WriteBits( ( unsigned char* ) & inTemplateVar, sizeof( templateType ) * 8, true );
 	else
@@ -1224,6 +1291,20 @@ inline bool BitStream::Read(templateType &outTemplateVar)
 #ifdef OVR_CC_MSVC
 #pragma warning(disable:4127)   // conditional expression is constant
 #endif
+	// Byte aligned: copy out directly rather than going through ReadBits
+	if ((readOffset & 7) == 0 && readOffset + sizeof(templateType) * 8 <= numberOfBitsUsed)
+	{
+		const unsigned char* src = data + (readOffset >> 3);
+#ifndef __BITSTREAM_NATIVE_END
+		if (sizeof(templateType) > 1 && DoEndianSwap())
+			ReverseBytes((unsigned char*)src, (unsigned char*)&outTemplateVar, sizeof(templateType));
+		else
+#endif
+			memcpy(&outTemplateVar, src, sizeof(templateType));
+		readOffset += sizeof(templateType) * 8;
+		return true;
+	}
+
 	if (sizeof(outTemplateVar)==1)
 		return ReadBits( ( unsigned char* ) &outTemplateVar, sizeof(templateType) * 8, true );
 	else
@@ -1273,16 +1354,15 @@ inline bool BitStream::Read(OVR::String &outTemplateVar)
 	bool b;
 	uint16_t l;
 	b=Read(l);
+	AlignReadToByteBoundary();
 	if (b && l>0)
 	{
-		AlignReadToByteBoundary();
+		// The length came off the wire; don't read past the end of the data
+		if (BYTES_TO_BITS((BitSize_t) l) > GetNumberOfUnreadBits())
+			return false;
 		outTemplateVar.AssignString((const char*) (data + ( readOffset >> 3 )), (size_t) l);
 		IgnoreBytes(l);
 	}
-	else
-	{
-		AlignReadToByteBoundary();
-	}
 	return b;
 }
 template <>
@@ -1293,6 +1373,8 @@ inline bool BitStream::Read(char *&varString)
 	b=Read(l);
 	if (b && l>0)
 	{
+		if ( ( readOffset >> 3 ) + l > GetNumberOfBytesUsed() )
+			return false;
 		memcpy(varString, data + ( readOffset >> 3 ), l);
 		IgnoreBytes(l);
 	}
@@ -1310,6 +1392,8 @@ inline bool BitStream::Read(unsigned char *&varString)
 	b=Read(l);
 	if (b && l>0)
 	{
+		if ( ( readOffset >> 3 ) + l > GetNumberOfBytesUsed() )
+			return false;
 		memcpy(varString, data + ( readOffset >> 3 ), l);
 		IgnoreBytes(l);
 	}
@@ -1722,6 +1806,55 @@ bool BitStream::ReadOrthMatrix(
 	return true;
 }
 
+template <class templateType>
+inline void BitStream::WriteArray( const templateType *values, const unsigned int count, bool endianSwap )
+{
+	AlignWriteToByteBoundary();
+	if (count == 0)
+		return;
+
+	// count * sizeof(templateType) must not wrap.
+	if (count > UINT_MAX / sizeof(templateType))
+	{
+		OVR_ASSERT(0);
+		return;
+	}
+
+	const unsigned int numberOfBytes = count * sizeof(templateType);
+	const BitSize_t byteOffset = numberOfBitsUsed >> 3;
+	Write((const char*) values, numberOfBytes);
+
+	if (endianSwap && sizeof(templateType) > 1 && DoEndianSwap())
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			ReverseBytesInPlace(data + byteOffset + i * sizeof(templateType), sizeof(templateType));
+	}
+}
+
+template <class templateType>
+inline bool BitStream::ReadArray( templateType *values, const unsigned int count, bool endianSwap )
+{
+	if (count == 0)
+	{
+		AlignReadToByteBoundary();
+		return true;
+	}
+
+	// A count from the wire must not wrap the byte length.
+	if (count > UINT_MAX / sizeof(templateType))
+		return false;
+
+	if (!ReadAlignedBytes((unsigned char*) values, count * sizeof(templateType)))
+		return false;
+
+	if (endianSwap && sizeof(templateType) > 1 && DoEndianSwap())
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			ReverseBytesInPlace((unsigned char*) (values + i), sizeof(templateType));
+	}
+	return true;
+}
+
 template <class templateType>
 BitStream& operator<<(BitStream& out, templateType& c)
 {
@@ -1739,6 +1872,30 @@ BitStream& operator>>(BitStream& in, templateType& c)
 }
 
 
+//-----------------------------------------------------------------------------
+// BitStreamView
+
+// Read-only BitStream over memory it does not own, typically a received payload.
+// The data is parsed in place: constructing a view never copies or allocates,
+// so the viewed memory must outlive the view. Do not write to a view.
+class BitStreamView : public BitStream
+{
+public:
+	BitStreamView( const void* _data, const unsigned int lengthInBytes ) :
+		BitStream( (char*) _data, lengthInBytes, false )
+	{
+	}
+
+	/// \brief Views the unread remainder of \a source, starting at the byte holding its read offset.
+	/// \details Call AlignReadToByteBoundary() on \a source first if it may be mid-byte.
+	explicit BitStreamView( const BitStream* source ) :
+		BitStream( source->GetData() + ( source->GetReadOffset() >> 3 ),
+		           source->GetNumberOfBytesUsed() - ( source->GetReadOffset() >> 3 ), false )
+	{
+	}
+};
+
+
 }} // OVR::Net
 
 #endif
@@ -25,6 +25,7 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_PacketizedTCPSocket.h"
+#include "../Kernel/OVR_Log.h"
 
 namespace OVR { namespace Net {
 
@@ -33,6 +34,8 @@ namespace OVR { namespace Net {
 // Constants
 
 static const int LENGTH_FIELD_BYTES = 4;
+static const int RECV_BUFF_MIN_CAPACITY = 4096;
+static const int SEND_QUEUE_FLUSH_BYTES = 65536;
 
 
 //-----------------------------------------------------------------------------
@@ -42,6 +45,7 @@ PacketizedTCPSocket::PacketizedTCPSocket()
 {
 	pRecvBuff = 0;
 	pRecvBuffSize = 0;
+	recvBuffCapacity = 0;
 	Transport = TransportType_PacketizedTCP;
 }
 
@@ -49,6 +53,7 @@ PacketizedTCPSocket::PacketizedTCPSocket(SocketHandle _sock, bool isListenSocket
 {
 	pRecvBuff = 0;
 	pRecvBuffSize = 0;
+	recvBuffCapacity = 0;
 	Transport = TransportType_PacketizedTCP;
 }
 
@@ -57,32 +62,45 @@ PacketizedTCPSocket::~PacketizedTCPSocket()
 	OVR_FREE(pRecvBuff);
 }
 
+// Writes the 4 endian-neutral length bytes
+static void WriteLengthField(uint8_t* pDest, uint32_t lengthWord)
+{
+	pDest[0] = (uint8_t)lengthWord;
+	pDest[1] = (uint8_t)(lengthWord >> 8);
+	pDest[2] = (uint8_t)(lengthWord >> 16);
+	pDest[3] = (uint8_t)(lengthWord >> 24);
+}
+
 int PacketizedTCPSocket::Send(const void* pData, int bytes)
 {
     Lock::Locker locker(&sendLock);
 
-	if (bytes <= 0)
+	if (bytes <= 0 || bytes > MaxMessageBytes)
 	{
 		return -1;
 	}
 
-	// Convert length to 4 endian-neutral bytes
-	uint32_t lengthWord = bytes;
-	uint8_t lengthBytes[LENGTH_FIELD_BYTES] = {
-		(uint8_t)lengthWord,
-		(uint8_t)(lengthWord >> 8),
-		(uint8_t)(lengthWord >> 16),
-		(uint8_t)(lengthWord >> 24)
-	};
+	// Keep ordering with anything queued earlier
+	if (flushSendQueue() < 0)
+	{
+		return -1;
+	}
+
+	uint8_t lengthBytes[LENGTH_FIELD_BYTES];
+	WriteLengthField(lengthBytes, (uint32_t)bytes);
+
+	// Length field and payload go out in one system call
+	const void* buffers[2]       = { lengthBytes, pData };
+	const int   bufferLengths[2] = { LENGTH_FIELD_BYTES, bytes };
 
-	int s = PacketizedTCPSocketBase::Send(lengthBytes, LENGTH_FIELD_BYTES);
-	if (s > 0)
+	int s = PacketizedTCPSocketBase::SendVectored(buffers, bufferLengths, 2);
+	if (s > LENGTH_FIELD_BYTES)
 	{
-		return PacketizedTCPSocketBase::Send(pData,bytes);
+		return s - LENGTH_FIELD_BYTES;
 	}
 	else
 	{
-		return s;
+		return s < 0 ? s : -1;
 	}
 }
 
@@ -93,115 +111,235 @@ int PacketizedTCPSocket::SendAndConcatenate(const void** pDataArray, int* dataLe
     if (arrayCount == 0)
 		return 0;
 
-	int totalBytes = 0;
+	if (flushSendQueue() < 0)
+		return -1;
+
+	size_t totalBytes = 0;
 	for (int i = 0; i < arrayCount; i++)
-		totalBytes += dataLengthArray[i];
+		totalBytes += (size_t)dataLengthArray[i];
 
-	// Convert length to 4 endian-neutral bytes
-	uint32_t lengthWord = totalBytes;
-	uint8_t lengthBytes[LENGTH_FIELD_BYTES] = {
-		(uint8_t)lengthWord,
-		(uint8_t)(lengthWord >> 8),
-		(uint8_t)(lengthWord >> 16),
-		(uint8_t)(lengthWord >> 24)
-	};
+	if (totalBytes > (size_t)MaxMessageBytes)
+		return -1;
+
+	uint8_t lengthBytes[LENGTH_FIELD_BYTES];
+	WriteLengthField(lengthBytes, (uint32_t)totalBytes);
+
+	// Length field and all fragments go out together, in as few system calls as possible
+	static const int StackBuffers = 16;
+	const void* stackBuffers[StackBuffers];
+	int         stackLengths[StackBuffers];
+	const void** buffers = stackBuffers;
+	int*         lengths = stackLengths;
 
-	int s = PacketizedTCPSocketBase::Send(lengthBytes, LENGTH_FIELD_BYTES);
-	if (s > 0)
+	if (arrayCount + 1 > StackBuffers)
 	{
-		for (int i = 0; i < arrayCount; i++)
+		buffers = (const void**)OVR_ALLOC(sizeof(const void*) * (arrayCount + 1));
+		lengths = (int*)OVR_ALLOC(sizeof(int) * (arrayCount + 1));
+		if (!buffers || !lengths)
 		{
-			PacketizedTCPSocketBase::Send(pDataArray[i], dataLengthArray[i]);
+			OVR_FREE(buffers);
+			OVR_FREE(lengths);
+			return -1;
 		}
 	}
 
-	return s;
+	buffers[0] = lengthBytes;
+	lengths[0] = LENGTH_FIELD_BYTES;
+	for (int i = 0; i < arrayCount; i++)
+	{
+		buffers[i + 1] = pDataArray[i];
+		lengths[i + 1] = dataLengthArray[i];
+	}
+
+	int s = PacketizedTCPSocketBase::SendVectored(buffers, lengths, arrayCount + 1);
+
+	if (buffers != stackBuffers)
+	{
+		OVR_FREE(buffers);
+		OVR_FREE(lengths);
+	}
+
+	if (s > LENGTH_FIELD_BYTES)
+	{
+		return s - LENGTH_FIELD_BYTES;
+	}
+	else
+	{
+		return s < 0 ? s : -1;
+	}
 }
 
-void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead)
+int PacketizedTCPSocket::SendQueued(const void* pData, int bytes)
 {
-	uint8_t* dataSource = NULL;
-	int dataSourceSize = 0;
+    Lock::Locker locker(&sendLock);
+
+	if (bytes <= 0 || bytes > MaxMessageBytes)
+	{
+		return -1;
+	}
 
-	recvBuffLock.DoLock();
+	const size_t offset = sendQueue.GetSize();
+	sendQueue.Resize(offset + LENGTH_FIELD_BYTES + bytes);
 
-	if (pRecvBuff == NULL)
+	uint8_t* pDest = sendQueue.GetDataPtr() + offset;
+	WriteLengthField(pDest, (uint32_t)bytes);
+	memcpy(pDest + LENGTH_FIELD_BYTES, pData, bytes);
+
+	if (sendQueue.GetSizeI() >= SEND_QUEUE_FLUSH_BYTES && flushSendQueue() < 0)
 	{
-		dataSource = pData;
-		dataSourceSize = bytesRead;
+		return -1;
 	}
-	else
+
+	return bytes;
+}
+
+int PacketizedTCPSocket::FlushSendQueue()
+{
+    Lock::Locker locker(&sendLock);
+
+	return flushSendQueue();
+}
+
+int PacketizedTCPSocket::flushSendQueue()
+{
+	const int queuedBytes = sendQueue.GetSizeI();
+	if (queuedBytes == 0)
+	{
+		return 0;
+	}
+
+	int s = PacketizedTCPSocketBase::Send(sendQueue.GetDataPtr(), queuedBytes);
+
+	// Whatever was not written is lost either way: the stream can't be resynchronized
+	sendQueue.Clear();
+
+	return s == queuedBytes ? s : -1;
+}
+
+void PacketizedTCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead)
+{
+    Lock::Locker locker(&recvBuffLock);
+
+	// Finish the message left over from the previous read, copying only the bytes it still needs
+	if (pRecvBuffSize > 0)
 	{
-		uint8_t* pRecvBuffNew = (uint8_t*)OVR_REALLOC(pRecvBuff, bytesRead + pRecvBuffSize);
-		if (!pRecvBuffNew)
+		if (pRecvBuffSize < LENGTH_FIELD_BYTES)
 		{
-			OVR_FREE(pRecvBuff);
-			pRecvBuff = NULL;
-			pRecvBuffSize = 0;
-			recvBuffLock.Unlock();
-			return;
+			int take = LENGTH_FIELD_BYTES - (int)pRecvBuffSize;
+			if (take > bytesRead)
+				take = bytesRead;
+
+			if (!AppendRecvBuff(pData, take))
+			{
+				closeBrokenStream(eventHandler, 0);
+				return;
+			}
+			pData += take;
+			bytesRead -= take;
+
+			if (pRecvBuffSize < LENGTH_FIELD_BYTES)
+				return;
 		}
-		else
+
+		const uint32_t messageBytes = BytesFromStream(pRecvBuff, (int)pRecvBuffSize);
+		if (messageBytes > (uint32_t)MaxMessageBytes)
 		{
-			pRecvBuff = pRecvBuffNew;
+			closeBrokenStream(eventHandler, messageBytes);
+			return;
+		}
 
-			memcpy(pRecvBuff + pRecvBuffSize, pData, bytesRead);
+		const size_t totalBytes = LENGTH_FIELD_BYTES + (size_t)messageBytes;
+		size_t take = totalBytes - pRecvBuffSize;
+		if (take > (size_t)bytesRead)
+			take = (size_t)bytesRead;
 
-			dataSourceSize = pRecvBuffSize + bytesRead;
-			dataSource = pRecvBuff;
+		if (!AppendRecvBuff(pData, (int)take))
+		{
+			closeBrokenStream(eventHandler, messageBytes);
+			return;
 		}
+		pData += take;
+		bytesRead -= (int)take;
+
+		if (pRecvBuffSize < totalBytes)
+			return;
+
+		pRecvBuffSize = 0;
+		TCPSocket::OnRecv(eventHandler, pRecvBuff + LENGTH_FIELD_BYTES, (int)messageBytes);
 	}
 
-	int bytesReadFromStream;
-	while (bytesReadFromStream = BytesFromStream(dataSource, dataSourceSize),
-		   LENGTH_FIELD_BYTES + bytesReadFromStream <= dataSourceSize)
+	// Frame whole messages in place
+	while (bytesRead >= LENGTH_FIELD_BYTES)
 	{
-		dataSource += LENGTH_FIELD_BYTES;
-		dataSourceSize -= LENGTH_FIELD_BYTES;
+		const uint32_t messageBytes = BytesFromStream(pData, bytesRead);
+		if (messageBytes > (uint32_t)MaxMessageBytes)
+		{
+			closeBrokenStream(eventHandler, messageBytes);
+			return;
+		}
+
+		if ((size_t)messageBytes > (size_t)(bytesRead - LENGTH_FIELD_BYTES))
+			break;
 
-		TCPSocket::OnRecv(eventHandler, dataSource, bytesReadFromStream);
+		TCPSocket::OnRecv(eventHandler, pData + LENGTH_FIELD_BYTES, (int)messageBytes);
 
-		dataSource += bytesReadFromStream;
-		dataSourceSize -= bytesReadFromStream;
+		pData += LENGTH_FIELD_BYTES + messageBytes;
+		bytesRead -= LENGTH_FIELD_BYTES + (int)messageBytes;
 	}
 
-	if (dataSourceSize > 0)
+	// Queue the partial tail; the buffer grows only as its bytes arrive
+	if (bytesRead > 0 && !AppendRecvBuff(pData, bytesRead))
 	{
-        if (dataSource != NULL)
-        {
-            if (pRecvBuff == NULL)
-            {
-                pRecvBuff = (uint8_t*)OVR_ALLOC(dataSourceSize);
-                if (!pRecvBuff)
-                {
-                    pRecvBuffSize = 0;
-                    recvBuffLock.Unlock();
-                    return;
-                }
-                else
-                {
-                    memcpy(pRecvBuff, dataSource, dataSourceSize);
-                }
-            }
-            else
-            {
-                memmove(pRecvBuff, dataSource, dataSourceSize);
-            }
-        }
+		closeBrokenStream(eventHandler, bytesRead >= LENGTH_FIELD_BYTES ? BytesFromStream(pData, bytesRead) : 0);
 	}
-	else
-	{
-		if (pRecvBuff != NULL)
-			OVR_FREE(pRecvBuff);
+}
+
+void PacketizedTCPSocket::closeBrokenStream(SocketEvent_TCP* eventHandler, uint32_t messageBytes)
+{
+	// Without the message the stream can't be resynchronized
+	LogError("{ERR-104} [Socket] Dropping connection: unable to receive a %u byte message (limit %d bytes).",
+	         messageBytes, MaxMessageBytes);
+
+	pRecvBuffSize = 0;
+	Close();
+	eventHandler->TCP_OnClosed(this);
+}
 
-		pRecvBuff = NULL;
+bool PacketizedTCPSocket::ReserveRecvBuff(size_t bytes)
+{
+	if (bytes <= recvBuffCapacity)
+		return true;
+
+	// Bounded by MaxMessageBytes plus the length field, so this can't overflow
+	size_t newCapacity = recvBuffCapacity > (size_t)RECV_BUFF_MIN_CAPACITY ? recvBuffCapacity : (size_t)RECV_BUFF_MIN_CAPACITY;
+	while (newCapacity < bytes)
+		newCapacity *= 2;
+
+	uint8_t* pRecvBuffNew = (uint8_t*)OVR_REALLOC(pRecvBuff, newCapacity);
+	if (!pRecvBuffNew)
+	{
+		return false;
 	}
-	pRecvBuffSize = dataSourceSize;
 
-	recvBuffLock.Unlock();
+	pRecvBuff = pRecvBuffNew;
+	recvBuffCapacity = newCapacity;
+	return true;
+}
+
+bool PacketizedTCPSocket::AppendRecvBuff(uint8_t* pData, int bytes)
+{
+	if (bytes <= 0)
+		return true;
+
+	if (!ReserveRecvBuff(pRecvBuffSize + (size_t)bytes))
+		return false;
+
+	memcpy(pRecvBuff + pRecvBuffSize, pData, bytes);
+	pRecvBuffSize += bytes;
+	return true;
 }
 
-int PacketizedTCPSocket::BytesFromStream(uint8_t* pData, int bytesRead)
+uint32_t PacketizedTCPSocket::BytesFromStream(uint8_t* pData, int bytesRead)
 {
 	if (pData != 0 && bytesRead >= LENGTH_FIELD_BYTES)
 	{
@@ -31,6 +31,7 @@ limitations under the License.
 #include "OVR_Socket.h"
 #include "../Kernel/OVR_Allocator.h"
 #include "../Kernel/OVR_Atomic.h"
+#include "../Kernel/OVR_Array.h"
 
 #ifdef OVR_OS_WIN32
 #include "OVR_Win32_Socket.h"
@@ -69,16 +70,35 @@ public:
 	virtual int Send(const void* pData, int bytes);
 	virtual int SendAndConcatenate(const void** pDataArray, int *dataLengthArray, int arrayCount);
 
+	// Frames the message into the send queue instead of writing it to the socket.
+	// The queue goes out in one system call on FlushSendQueue(), the next Send(),
+	// or once it holds SEND_QUEUE_FLUSH_BYTES. Returns bytes queued, or -1.
+	int SendQueued(const void* pData, int bytes);
+	// Returns bytes written, 0 if the queue was empty, or -1 on error
+	int FlushSendQueue();
+
 protected:
 	virtual void OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead);
 
-	int BytesFromStream(uint8_t* pData, int bytesRead);
+	uint32_t BytesFromStream(uint8_t* pData, int bytesRead);
+	int flushSendQueue(); // Requires sendLock
+	bool ReserveRecvBuff(size_t bytes);
+	bool AppendRecvBuff(uint8_t* pData, int bytes);
+	void closeBrokenStream(SocketEvent_TCP* eventHandler, uint32_t messageBytes); // Requires recvBuffLock
 
     Lock   sendLock;
     Lock   recvBuffLock;
 
-	uint8_t* pRecvBuff;     // Queued receive buffered data
-	int    pRecvBuffSize; // Size of receive queue in bytes
+	// Holds at most one partial message, left over when a message straddles two reads.
+	// Complete messages are framed in place in the socket's receive buffer and never copied here.
+	// The buffer is reused across reads and grows with the bytes received, not the length announced,
+	// up to the largest message seen.
+	uint8_t* pRecvBuff;        // Queued receive buffered data
+	size_t pRecvBuffSize;      // Size of receive queue in bytes
+	size_t recvBuffCapacity;   // Allocated size of pRecvBuff in bytes
+
+	// Framed messages waiting for FlushSendQueue(); keeps its capacity between flushes
+	ArrayPOD< uint8_t, ArrayConstPolicy<0, 4096, true> > sendQueue;
 };
 
 
@@ -37,59 +37,298 @@ namespace OVR { namespace Net { namespace Plugins {
 
 enum {
 	ID_RPC4_SIGNAL,
-	CALL_BLOCKING,
+	CALL_BLOCKING,                     // Legacy call: one outstanding per connection, answered with ID_RPC4_RETURN or RPC_ERROR_FUNCTION_NOT_REGISTERED
 	RPC_ERROR_FUNCTION_NOT_REGISTERED,
 	ID_RPC4_RETURN,
+	CALL_ASYNC,                        // Call tagged with a request ID, answered with ID_RPC4_RETURN_ASYNC
+	ID_RPC4_RETURN_ASYNC,
+	ID_RPC1_ID_TABLE,                  // Numeric IDs the sender assigned to the names it registered
+	CALL_ASYNC_ID,                     // CALL_ASYNC naming the function by the callee's ID
+	ID_RPC1_SIGNAL_ID,                 // ID_RPC4_SIGNAL naming the slot by the receiver's ID
 };
 
+// Protocol minor versions (see OVR_Session.h) that brought the messages above
+static const int MinorVersion_RequestIds = 2; // CALL_ASYNC, ID_RPC4_RETURN_ASYNC
+static const int MinorVersion_IdTables   = 3; // ID_RPC1_ID_TABLE, CALL_ASYNC_ID, ID_RPC1_SIGNAL_ID
+
+
+//-----------------------------------------------------------------------------
+// RPCFuture
+
+RPCFuture::RPCFuture(uint32_t requestId, Connection* connection, BitStream* returnData) :
+    RequestId(requestId),
+    pConnection(connection),
+    State(State_Pending),
+    pReturnData(returnData ? returnData : &OwnReturnData)
+{
+}
+
+bool RPCFuture::Wait(unsigned delayMs)
+{
+    Mutex::Locker locker(&StateMutex);
+
+    if (delayMs == OVR_WAIT_INFINITE)
+    {
+        while (State == State_Pending)
+        {
+            StateWait.Wait(&StateMutex);
+        }
+    }
+    else if (State == State_Pending && delayMs > 0)
+    {
+        StateWait.Wait(&StateMutex, delayMs);
+    }
+
+    return State == State_Succeeded;
+}
+
+void RPCFuture::complete(bool success)
+{
+    if (success)
+    {
+        pReturnData->ResetReadPointer();
+    }
+
+    Mutex::Locker locker(&StateMutex);
+
+    State = success ? State_Succeeded : State_Failed;
+    pConnection = NULL;
+    StateWait.NotifyAll();
+}
+
 
 //-----------------------------------------------------------------------------
 // RPC1
 
-RPC1::RPC1()
+RPC1::RPC1() :
+    nextRequestId(0)
 {
-	blockingOnThisConnection = 0;
-	blockingReturnValue = new BitStream();
 }
 
 RPC1::~RPC1()
 {
 	slotHash.Clear();
-	delete blockingReturnValue;
 }
 
 void RPC1::RegisterSlot(OVR::String sharedIdentifier,  OVR::Observer<RPCSlot>* rpcSlotObserver )
 {
 	slotHash.AddObserverToSubject(sharedIdentifier, rpcSlotObserver);
+
+    Ptr< Observer<RPCSlot> > subject = slotHash.GetSubject(sharedIdentifier);
+    registerLocal(sharedIdentifier, NULL, subject);
 }
 
 bool RPC1::RegisterBlockingFunction(OVR::String uniqueID, RPCDelegate blockingFunction)
 {
-	if (registeredBlockingFunctions.Get(uniqueID))
+    Lock::Locker locker(&localTableLock);
+
+    const RPCLocalTable* table = localTable.GetForWrite();
+    const uint16_t*      id    = table ? table->Ids.Get(uniqueID) : NULL;
+
+	if (id && table->Entries[*id].Function.IsValid())
 		return false;
 
-	registeredBlockingFunctions.Set(uniqueID, blockingFunction);
+    registerLocal(uniqueID, &blockingFunction, NULL);
 	return true;
 }
 
 void RPC1::UnregisterBlockingFunction(OVR::String uniqueID)
 {
-	registeredBlockingFunctions.Remove(uniqueID);
+    Lock::Locker locker(&localTableLock);
+
+    const RPCLocalTable* table = localTable.GetForWrite();
+    if (!table || !table->Ids.Get(uniqueID))
+        return;
+
+    // The ID stays assigned, so calls still in flight are answered as not registered
+    RPCDelegate invalid;
+    registerLocal(uniqueID, &invalid, NULL);
+}
+
+void RPC1::registerLocal(const OVR::String& name, const RPCDelegate* function, Observer<RPCSlot>* subject)
+{
+    Lock::Locker locker(&localTableLock);
+
+    const RPCLocalTable* current = localTable.GetForWrite();
+    RPCLocalTable        table;
+    if (current)
+    {
+        table = *current;
+    }
+
+    const uint16_t* existingId = table.Ids.Get(name);
+    uint16_t        id;
+
+    if (existingId)
+    {
+        id = *existingId;
+    }
+    else
+    {
+        if (table.Entries.GetSize() >= InvalidId)
+        {
+            // Out of IDs: the name is still reachable by string
+            OVR_ASSERT(false);
+            return;
+        }
+
+        id = (uint16_t)table.Entries.GetSize();
+        table.Entries.PushBack(RPCLocalEntry());
+        table.Entries[id].Name = name;
+        table.Ids.Set(name, id);
+    }
+
+    if (function)
+    {
+        table.Entries[id].Function = *function;
+    }
+    if (subject)
+    {
+        table.Entries[id].Subject = subject;
+    }
+
+    localTable.Publish(table);
+
+    // Tell connected peers about the new name. Peers that connect later get the whole table
+    if (!existingId && pSession)
+    {
+        Ptr<Connection> conn;
+        for (int i = 0; (conn = pSession->GetConnectionAtIndex(i)) != NULL; ++i)
+        {
+            if (conn->State == State_Connected && conn->RemoteVersionAtLeast(MinorVersion_IdTables))
+            {
+                sendIdTable(conn, table, id);
+            }
+        }
+    }
+}
+
+void RPC1::sendIdTable(Connection* pConnection, const RPCLocalTable& table, int firstEntry)
+{
+    const int count = table.Entries.GetSizeI() - firstEntry;
+    if (count <= 0)
+    {
+        return;
+    }
+
+    OVR::Net::BitStream out;
+    out.Write((MessageID) OVRID_RPC1);
+    out.Write((MessageID) ID_RPC1_ID_TABLE);
+    out.Write((uint16_t) count);
+    for (int i = firstEntry; i < table.Entries.GetSizeI(); ++i)
+    {
+        out.Write((uint16_t) i);
+        out.Write(table.Entries[i].Name);
+    }
+
+    SendParameters sp(pConnection, out.GetData(), out.GetNumberOfBytesUsed());
+    pSession->Send(&sp);
+}
+
+void RPC1::readIdTable(Connection* pConnection, OVR::Net::BitStream& bsIn)
+{
+    uint16_t count = 0;
+    bsIn.Read(count);
+
+    Lock::Locker locker(&remoteIdsLock);
+
+    // A table still queued when the connection closed would otherwise recreate the entry
+    // OnDisconnected() removed, and pass it on to a new connection at the same address
+    if (pConnection->State != State_Connected)
+    {
+        return;
+    }
+
+    RemoteIdHash* ids = remoteIds.Get(pConnection);
+    if (!ids)
+    {
+        remoteIds.Set(pConnection, RemoteIdHash());
+        ids = remoteIds.Get(pConnection);
+    }
+
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        uint16_t    id = InvalidId;
+        OVR::String name;
+        if (!bsIn.Read(id) || !bsIn.Read(name))
+        {
+            break;
+        }
+
+        ids->Set(name, id);
+    }
+}
+
+bool RPC1::getRemoteId(Connection* pConnection, const OVR::String& name, uint16_t& idOut)
+{
+    Lock::Locker locker(&remoteIdsLock);
+
+    const RemoteIdHash* ids = remoteIds.Get(pConnection);
+    const uint16_t*     id  = ids ? ids->Get(name) : NULL;
+    if (!id)
+    {
+        return false;
+    }
+
+    idOut = *id;
+    return true;
 }
 
 bool RPC1::CallBlocking( OVR::String uniqueID, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection, OVR::Net::BitStream* returnData )
+{
+    if (returnData)
+    {
+        returnData->Reset();
+    }
+
+    // The reply is written straight into returnData, which outlives the call since we wait for it
+    Ptr<RPCFuture> future = callAsync(uniqueID, bitStream, pConnection, returnData);
+
+    return future && future->Wait();
+}
+
+Ptr<RPCFuture> RPC1::CallAsync( OVR::String uniqueID, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection )
+{
+    return callAsync(uniqueID, bitStream, pConnection, NULL);
+}
+
+Ptr<RPCFuture> RPC1::callAsync(const OVR::String& uniqueID, OVR::Net::BitStream* bitStream, Connection* pConnection, OVR::Net::BitStream* returnData)
 {
     // If invalid parameters,
     if (!pConnection)
     {
         // Note: This may happen if the endpoint disconnects just before the call
-        return false;
+        return NULL;
     }
 
+    if (!pConnection->RemoteVersionAtLeast(MinorVersion_RequestIds))
+    {
+        return callLegacy(uniqueID, bitStream, pConnection, returnData);
+    }
+
+    Ptr<RPCFuture> future;
+    {
+        Lock::Locker locker(&pendingCallsLock);
+
+        future = *new RPCFuture(nextRequestId++, pConnection, returnData);
+        pendingCalls.Set(future->RequestId, future);
+    }
+
+    uint16_t remoteId = InvalidId;
+    const bool byId = getRemoteId(pConnection, uniqueID, remoteId);
+
 	OVR::Net::BitStream out;
 	out.Write((MessageID) OVRID_RPC1);
-	out.Write((MessageID) CALL_BLOCKING);
-	out.Write(uniqueID);
+	out.Write((MessageID) (byId ? CALL_ASYNC_ID : CALL_ASYNC));
+	out.Write(future->RequestId);
+    if (byId)
+    {
+        out.Write(remoteId);
+    }
+    else
+    {
+        out.Write(uniqueID);
+    }
 	if (bitStream)
 	{
 		bitStream->ResetReadPointer();
@@ -99,51 +338,96 @@ bool RPC1::CallBlocking( OVR::String uniqueID, OVR::Net::BitStream* bitStream, P
 
 	SendParameters sp(pConnection, out.GetData(), out.GetNumberOfBytesUsed());
 
-    if (returnData)
+    // Registered before sending, since the reply may arrive before Send() returns
+    int bytesSent = pSession->Send(&sp);
+    if (bytesSent != sp.Bytes)
     {
-        returnData->Reset();
-    }
+        Lock::Locker locker(&pendingCallsLock);
 
-    // Only one thread call at a time
-    Lock::Locker singleRPCLocker(&singleRPCLock);
-
-    // Note this does not prevent multiple calls at a time because .Wait will unlock it below.
-    // The purpose of this mutex is to synchronize the polling thread and this one, not prevent
-    // multiple threads from invoking RPC.
-    Mutex::Locker locker(&callBlockingMutex);
+        pendingCalls.Remove(future->RequestId);
+        return NULL;
+    }
 
-    blockingReturnValue->Reset();
-    blockingOnThisConnection = pConnection;
+    return future;
+}
 
-    int bytesSent = pSession->Send(&sp);
-    if (bytesSent == sp.Bytes)
+Ptr<RPCFuture> RPC1::callLegacy(const OVR::String& uniqueID, OVR::Net::BitStream* bitStream, Connection* pConnection, OVR::Net::BitStream* returnData)
+{
+    // Replies to CALL_BLOCKING don't say which call they answer, so wait for the
+    // connection's outstanding call to finish before sending another
+    Ptr<RPCFuture> future;
+    for (;;)
     {
-        while (blockingOnThisConnection == pConnection)
+        Ptr<RPCFuture> previous;
         {
-            callBlockingWait.Wait(&callBlockingMutex);
+            Lock::Locker locker(&pendingCallsLock);
+
+            Ptr<RPCFuture>* outstanding = legacyCalls.Get(pConnection);
+            if (!outstanding)
+            {
+                future = *new RPCFuture(nextRequestId++, pConnection, returnData);
+                legacyCalls.Set(pConnection, future);
+                break;
+            }
+            previous = *outstanding;
         }
+
+        // Completes on reply or disconnect
+        previous->Wait();
     }
-	else
+
+	OVR::Net::BitStream out;
+	out.Write((MessageID) OVRID_RPC1);
+	out.Write((MessageID) CALL_BLOCKING);
+	out.Write(uniqueID);
+	if (bitStream)
 	{
-		return false;
+		bitStream->ResetReadPointer();
+		out.AlignWriteToByteBoundary();
+		out.Write(bitStream);
 	}
 
-    if (returnData)
+	SendParameters sp(pConnection, out.GetData(), out.GetNumberOfBytesUsed());
+
+    int bytesSent = pSession->Send(&sp);
+    if (bytesSent != sp.Bytes)
     {
-        returnData->Write(blockingReturnValue);
-        returnData->ResetReadPointer();
+        {
+            Lock::Locker locker(&pendingCallsLock);
+
+            Ptr<RPCFuture>* outstanding = legacyCalls.Get(pConnection);
+            if (outstanding && *outstanding == future)
+            {
+                legacyCalls.Remove(pConnection);
+            }
+        }
+
+        // Release callers queued behind this one
+        future->complete(false);
+        return NULL;
     }
 
-	return true;
+    return future;
 }
 
 bool RPC1::Signal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream, Ptr<Connection> pConnection)
 {
+    uint16_t remoteId = InvalidId;
+    const bool byId = pConnection && getRemoteId(pConnection, sharedIdentifier, remoteId);
+
 	OVR::Net::BitStream out;
 	out.Write((MessageID) OVRID_RPC1);
-	out.Write((MessageID) ID_RPC4_SIGNAL);
 	//out.Write(PluginId);
-	out.Write(sharedIdentifier);
+    if (byId)
+    {
+        out.Write((MessageID) ID_RPC1_SIGNAL_ID);
+        out.Write(remoteId);
+    }
+    else
+    {
+        out.Write((MessageID) ID_RPC4_SIGNAL);
+        out.Write(sharedIdentifier);
+    }
 	if (bitStream)
 	{
 		bitStream->ResetReadPointer();
@@ -154,6 +438,7 @@ bool RPC1::Signal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream,
 	int32_t bytesSent = pSession->Send(&sp);
 	return bytesSent == sp.Bytes;
 }
+// Sent by name: each peer numbers its slots independently, so no single ID fits every connection
 void RPC1::BroadcastSignal(OVR::String sharedIdentifier, OVR::Net::BitStream* bitStream)
 {
     OVR::Net::BitStream out;
@@ -176,59 +461,126 @@ void RPC1::OnReceive(ReceivePayload *pPayload, ListenerReceiveResult *lrrOut)
 
     if (pPayload->pData[0] == OVRID_RPC1)
     {
-		OVR_ASSERT(pPayload->Bytes >= 2);
+        // A message without a sub-ID byte is malformed
+        if (pPayload->Bytes < 2)
+        {
+            return;
+        }
 
-		OVR::Net::BitStream bsIn((char*)pPayload->pData, pPayload->Bytes, false);
+		OVR::Net::BitStreamView bsIn(pPayload->pData, pPayload->Bytes);
 		bsIn.IgnoreBytes(2);
 
-        if (pPayload->pData[1] == RPC_ERROR_FUNCTION_NOT_REGISTERED)
+        if (pPayload->pData[1] == ID_RPC4_RETURN_ASYNC)
         {
-            Mutex::Locker locker(&callBlockingMutex);
-
-            blockingReturnValue->Reset();
-            blockingOnThisConnection = 0;
-            callBlockingWait.NotifyAll();
+            uint32_t requestId = 0;
+            bool     success = false;
+            bsIn.Read(requestId);
+            bsIn.Read(success);
+
+            Ptr<RPCFuture> future;
+            {
+                Lock::Locker locker(&pendingCallsLock);
+
+                Ptr<RPCFuture>* pending = pendingCalls.Get(requestId);
+                if (pending)
+                {
+                    future = *pending;
+                    pendingCalls.Remove(requestId);
+                }
+            }
+
+            // Nobody else can reach the future now, so its return data can be written unlocked
+            if (future)
+            {
+                if (success)
+                {
+                    bsIn.AlignReadToByteBoundary();
+                    // Cast so the BitStream overload is chosen over the generic Write<T>()
+                    future->pReturnData->Write(static_cast<OVR::Net::BitStream&>(bsIn));
+                }
+                future->complete(success);
+            }
         }
-        else if (pPayload->pData[1] == ID_RPC4_RETURN)
+        else if (pPayload->pData[1] == ID_RPC4_RETURN || pPayload->pData[1] == RPC_ERROR_FUNCTION_NOT_REGISTERED)
         {
-            Mutex::Locker locker(&callBlockingMutex);
-
-            blockingReturnValue->Reset();
-			blockingReturnValue->Write(bsIn);
-            blockingOnThisConnection = 0;
-            callBlockingWait.NotifyAll();
-		}
-        else if (pPayload->pData[1] == CALL_BLOCKING)
+            // Reply to the connection's outstanding CALL_BLOCKING
+            Ptr<RPCFuture> future;
+            {
+                Lock::Locker locker(&pendingCallsLock);
+
+                Ptr<RPCFuture>* outstanding = legacyCalls.Get(pPayload->pConnection);
+                if (outstanding)
+                {
+                    future = *outstanding;
+                    legacyCalls.Remove(pPayload->pConnection);
+                }
+            }
+
+            if (future)
+            {
+                const bool success = (pPayload->pData[1] == ID_RPC4_RETURN);
+                if (success)
+                {
+                    future->pReturnData->Write(static_cast<OVR::Net::BitStream&>(bsIn));
+                }
+                future->complete(success);
+            }
+        }
+        else if (pPayload->pData[1] == ID_RPC1_ID_TABLE)
         {
-			OVR::String uniqueId;
-			bsIn.Read(uniqueId);
-
-			RPCDelegate *bf = registeredBlockingFunctions.Get(uniqueId);
-			if (bf==0)
-			{
-				OVR::Net::BitStream bsOut;
-				bsOut.Write((unsigned char) OVRID_RPC1);
-				bsOut.Write((unsigned char) RPC_ERROR_FUNCTION_NOT_REGISTERED);
+            readIdTable(pPayload->pConnection, bsIn);
+        }
+        else if (pPayload->pData[1] == CALL_ASYNC_ID || pPayload->pData[1] == CALL_ASYNC || pPayload->pData[1] == CALL_BLOCKING)
+        {
+            const bool legacyCall = (pPayload->pData[1] == CALL_BLOCKING);
+            const bool byId       = (pPayload->pData[1] == CALL_ASYNC_ID);
 
-				SendParameters sp(pPayload->pConnection, bsOut.GetData(), bsOut.GetNumberOfBytesUsed());
-				pSession->Send(&sp);
+            uint32_t requestId = 0;
+            if (!legacyCall)
+            {
+                bsIn.Read(requestId);
+            }
 
+            uint16_t    localId = InvalidId;
+			OVR::String uniqueId;
+            if (byId)
+            {
+                bsIn.Read(localId);
+            }
+            else
+            {
+			    bsIn.Read(uniqueId);
+            }
+
+            RPCDelegate bf;
+            {
+                LocklessSnapshot<RPCLocalTable>::Reader reader(localTable);
+                const RPCLocalTable* table = reader.GetPtr();
+                if (table)
+                {
+                    if (!byId)
+                    {
+                        const uint16_t* id = table->Ids.Get(uniqueId);
+                        localId = id ? *id : InvalidId;
+                    }
+                    if (localId < table->Entries.GetSize())
+                    {
+                        bf = table->Entries[localId].Function;
+                    }
+                }
+            }
+
+			if (!bf.IsValid())
+			{
+                sendReturn(pPayload, legacyCall ? RPC_ERROR_FUNCTION_NOT_REGISTERED : ID_RPC4_RETURN_ASYNC, requestId, false, NULL);
 				return;
 			}
 
 			OVR::Net::BitStream returnData;
 			bsIn.AlignReadToByteBoundary();
-			(*bf)(&bsIn, &returnData, pPayload);
-
-			OVR::Net::BitStream out;
-			out.Write((MessageID) OVRID_RPC1);
-			out.Write((MessageID) ID_RPC4_RETURN);
-			returnData.ResetReadPointer();
-			out.AlignWriteToByteBoundary();
-			out.Write(returnData);
+			bf(&bsIn, &returnData, pPayload);
 
-			SendParameters sp(pPayload->pConnection, out.GetData(), out.GetNumberOfBytesUsed());
-			pSession->Send(&sp);
+            sendReturn(pPayload, legacyCall ? ID_RPC4_RETURN : ID_RPC4_RETURN_ASYNC, requestId, true, &returnData);
 		}
 		else if (pPayload->pData[1]==ID_RPC4_SIGNAL)
 		{
@@ -243,27 +595,124 @@ void RPC1::OnReceive(ReceivePayload *pPayload, ListenerReceiveResult *lrrOut)
 
 				if (o)
 				{
-					OVR::Net::BitStream serializedParameters(bsIn.GetData() + bsIn.GetReadOffset()/8, bsIn.GetNumberOfUnreadBits()/8, false);
+					OVR::Net::BitStreamView serializedParameters(&bsIn);
 
 					o->Call(&serializedParameters, pPayload);
 				}
 			}
 		}
+        else if (pPayload->pData[1] == ID_RPC1_SIGNAL_ID)
+        {
+            uint16_t localId = InvalidId;
+            bsIn.Read(localId);
+
+            Ptr< Observer<RPCSlot> > o;
+            {
+                LocklessSnapshot<RPCLocalTable>::Reader reader(localTable);
+                const RPCLocalTable* table = reader.GetPtr();
+                if (table && localId < table->Entries.GetSize())
+                {
+                    o = table->Entries[localId].Subject;
+                }
+            }
+
+            if (o)
+            {
+                bsIn.AlignReadToByteBoundary();
+
+                OVR::Net::BitStreamView serializedParameters(&bsIn);
+
+                o->Call(&serializedParameters, pPayload);
+            }
+        }
 	}
 }
 
+void RPC1::sendReturn(ReceivePayload* pPayload, unsigned char returnId, uint32_t requestId, bool success, OVR::Net::BitStream* returnData)
+{
+	OVR::Net::BitStream out;
+	out.Write((MessageID) OVRID_RPC1);
+	out.Write((MessageID) returnId);
+
+    if (returnId == ID_RPC4_RETURN_ASYNC)
+    {
+        out.Write(requestId);
+        out.Write(success);
+    }
+
+    if (returnData)
+    {
+	    returnData->ResetReadPointer();
+	    out.AlignWriteToByteBoundary();
+	    out.Write(returnData);
+    }
+
+	SendParameters sp(pPayload->pConnection, out.GetData(), out.GetNumberOfBytesUsed());
+	pSession->Send(&sp);
+}
+
 void RPC1::OnDisconnected(Connection* conn)
 {
-    if (blockingOnThisConnection == conn)
     {
-        blockingOnThisConnection = 0;
-        callBlockingWait.NotifyAll();
+        Lock::Locker locker(&remoteIdsLock);
+        remoteIds.Remove(conn);
+    }
+
+    // Fail every call still waiting on this connection
+    Array< Ptr<RPCFuture> > failed;
+    {
+        Lock::Locker locker(&pendingCallsLock);
+
+        for (Hash< uint32_t, Ptr<RPCFuture> >::Iterator it = pendingCalls.Begin(); it != pendingCalls.End(); ++it)
+        {
+            if (it->Second->pConnection == conn)
+            {
+                failed.PushBack(it->Second);
+            }
+        }
+
+        const int count = failed.GetSizeI();
+        for (int i = 0; i < count; ++i)
+        {
+            pendingCalls.Remove(failed[i]->RequestId);
+        }
+
+        Ptr<RPCFuture>* outstanding = legacyCalls.Get(conn);
+        if (outstanding)
+        {
+            failed.PushBack(*outstanding);
+            legacyCalls.Remove(conn);
+        }
+    }
+
+    const int count = failed.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        failed[i]->complete(false);
     }
 }
 
 void RPC1::OnConnected(Connection* conn)
 {
-    OVR_UNUSED(conn);
+    // Forget IDs from an earlier connection object that lived at this address
+    {
+        Lock::Locker locker(&remoteIdsLock);
+        remoteIds.Remove(conn);
+    }
+
+    // Offer the peer numeric IDs for everything registered so far.
+    // Peers that predate ID_RPC1_ID_TABLE keep calling by name
+    if (!conn->RemoteVersionAtLeast(MinorVersion_IdTables))
+    {
+        return;
+    }
+
+    LocklessSnapshot<RPCLocalTable>::Reader reader(localTable);
+    const RPCLocalTable* table = reader.GetPtr();
+    if (table)
+    {
+        sendIdTable(conn, *table, 0);
+    }
 }
 
 
@@ -35,6 +35,7 @@ limitations under the License.
 #include "../Kernel/OVR_Threads.h"
 #include "../Kernel/OVR_Delegates.h"
 #include "../Kernel//OVR_Observer.h"
+#include "../Kernel/OVR_Lockless.h"
 
 namespace OVR { namespace Net { namespace Plugins {
 
@@ -43,6 +44,69 @@ typedef Delegate3<void, BitStream*, BitStream*, ReceivePayload*> RPCDelegate;
 typedef Delegate2<void, BitStream*, ReceivePayload*> RPCSlot;
 // typedef void ( *Slot ) ( OVR::Net::BitStream *userData, OVR::Net::ReceivePayload *pPayload );
 
+
+/// Result of an RPC1::CallAsync() that may not have completed yet.
+/// The reply can arrive on the polling thread at any time; Wait() blocks the caller until it does.
+class RPCFuture : public RefCountBase<RPCFuture>
+{
+    friend class RPC1;
+
+public:
+    RPCFuture(uint32_t requestId, Connection* pConnection, BitStream* returnData);
+
+    /// Waits up to delayMs for the call to complete
+    /// \return true if the remote function ran and its return data is available.
+    /// False on timeout, disconnect, or if the function is not registered remotely
+    bool       Wait(unsigned delayMs = OVR_WAIT_INFINITE);
+
+    /// True once the call has completed, successfully or not
+    bool       IsComplete() const { return State != State_Pending; }
+    bool       Succeeded() const  { return State == State_Succeeded; }
+
+    /// Data written by the remote function, with the read pointer at the start.
+    /// Only valid once Wait() has returned true
+    BitStream* GetReturnData()    { return pReturnData; }
+
+    uint32_t   GetRequestId() const { return RequestId; }
+
+protected:
+    enum EState
+    {
+        State_Pending,
+        State_Succeeded,
+        State_Failed
+    };
+
+    void complete(bool success);
+
+    uint32_t          RequestId;
+    Ptr<Connection>   pConnection;  // Connection the call was sent on
+    volatile EState   State;
+    Mutex             StateMutex;
+    WaitCondition     StateWait;
+
+    BitStream*        pReturnData;  // Points at OwnReturnData unless the caller supplied its own
+    BitStream         OwnReturnData;
+};
+
+/// Function and slot registered locally under one name.
+/// Its index in RPC1's table is the numeric ID offered to peers in place of the name
+struct RPCLocalEntry
+{
+    String                    Name;
+    RPCDelegate               Function; // Invalid if no blocking function is registered
+    Ptr< Observer<RPCSlot> >  Subject;  // NULL if no slot is registered
+};
+
+/// Snapshot of the local registrations: a flat array indexed by ID, and the IDs by name
+struct RPCLocalTable
+{
+    typedef Hash< String, uint16_t, String::HashFunctor > IdHash;
+
+    Array<RPCLocalEntry> Entries;
+    IdHash               Ids;
+};
+
 /// NetworkPlugin that maps strings to function pointers. Can invoke the functions using blocking calls with return values, or signal/slots. Networked parameters serialized with BitStream
 class RPC1 : public NetworkPlugin, public NewOverrideBase
 {
@@ -73,6 +137,16 @@ public:
 	/// \return true if successfully called. False on disconnect, function not registered, or not connected to begin with
 	bool CallBlocking( OVR::String uniqueID, OVR::Net::BitStream * bitStream, Ptr<Connection> pConnection, OVR::Net::BitStream *returnData = NULL );
 
+	/// \brief Same as CallBlocking(), but returns as soon as the call is sent.
+	/// Any number of calls may be outstanding on a connection at once, from any number of threads,
+	/// and the replies may complete in any order. Wait on the returned future for the result.
+	/// Peers older than protocol 1.2 take one call at a time, so against them this first waits for the previous call.
+	/// \param[in] Identifier originally passed to RegisterBlockingFunction() on the remote system
+	/// \param[in] bitStream bitStream encoded data to send to the function callback
+	/// \param[in] pConnection connection to send on
+	/// \return The pending call, or NULL if it could not be sent
+	Ptr<RPCFuture> CallAsync( OVR::String uniqueID, OVR::Net::BitStream * bitStream, Ptr<Connection> pConnection );
+
 	/// Calls zero or more functions identified by sharedIdentifier registered with RegisterSlot()
 	/// \param[in] sharedIdentifier parameter of the same name passed to RegisterSlot() on the remote system
 	/// \param[in] bitStream bitStream encoded data to send to the function callback
@@ -87,16 +161,36 @@ protected:
     virtual void OnDisconnected(Connection* conn);
     virtual void OnConnected(Connection* conn);
 
-	Hash< String, RPCDelegate, String::HashFunctor > registeredBlockingFunctions;
 	ObserverHash< RPCSlot > slotHash;
 
-    // Synchronization for RPC caller
-    Lock            singleRPCLock;
-    Mutex           callBlockingMutex;
-    WaitCondition   callBlockingWait;
-
-    Net::BitStream* blockingReturnValue;
-	Ptr<Connection> blockingOnThisConnection;
+    // Names registered here. Each one is given a numeric ID the first time it is
+    // registered, which is kept for the life of the plugin so a peer never sees it reused.
+    // Writers hold localTableLock; dispatch reads the published snapshot without locking.
+    Lock                                 localTableLock;
+    LocklessSnapshot<RPCLocalTable>      localTable;
+
+    // IDs offered by each peer for the names it has registered.
+    // Until a peer has sent its table (or if it is too old to send one), calls carry the name
+    typedef RPCLocalTable::IdHash        RemoteIdHash;
+    Lock                                 remoteIdsLock;
+    Hash< Connection*, RemoteIdHash >    remoteIds;
+
+    static const uint16_t                InvalidId = 0xffff;
+
+    void registerLocal(const OVR::String& name, const RPCDelegate* function, Observer<RPCSlot>* subject);
+    bool getRemoteId(Connection* pConnection, const OVR::String& name, uint16_t& idOut);
+    void sendIdTable(Connection* pConnection, const RPCLocalTable& table, int firstEntry);
+    void readIdTable(Connection* pConnection, OVR::Net::BitStream& bsIn);
+
+    Ptr<RPCFuture> callAsync(const OVR::String& uniqueID, OVR::Net::BitStream* bitStream, Connection* pConnection, OVR::Net::BitStream* returnData);
+    Ptr<RPCFuture> callLegacy(const OVR::String& uniqueID, OVR::Net::BitStream* bitStream, Connection* pConnection, OVR::Net::BitStream* returnData);
+    void sendReturn(ReceivePayload* pPayload, unsigned char returnId, uint32_t requestId, bool success, OVR::Net::BitStream* returnData);
+
+    // Calls waiting for a reply, by request ID
+    Lock                                 pendingCallsLock;
+    Hash< uint32_t, Ptr<RPCFuture> >     pendingCalls;
+    Hash< Connection*, Ptr<RPCFuture> >  legacyCalls;  // The CALL_BLOCKING outstanding on each pre-1.2 peer
+    uint32_t                             nextRequestId;
 };
 
 
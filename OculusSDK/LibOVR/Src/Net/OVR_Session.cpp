@@ -38,13 +38,15 @@ namespace OVR { namespace Net {
 static const char* OfficialHelloString = "OculusVR_Hello";
 static const char* OfficialAuthorizedString = "OculusVR_Authorized";
 
-void RPC_C2S_Hello::Generate(Net::BitStream* bs)
+void RPC_C2S_Hello::Generate(Net::BitStream* bs, bool requestSharedMemory)
 {
     RPC_C2S_Hello hello;
     hello.HelloString = OfficialHelloString;
     hello.MajorVersion = RPCVersion_Major;
-    hello.MinorVersion = RPCVersion_Minor;
+    hello.MinorVersion = RPCVersion_MinorAdvertised;
     hello.PatchVersion = RPCVersion_Patch;
+    hello.RequestSharedMemory = requestSharedMemory;
+    hello.ActualMinorVersion = RPCVersion_Minor;
     hello.Serialize(bs);
 }
 
@@ -55,7 +57,7 @@ bool RPC_C2S_Hello::Validate()
            HelloString.CompareNoCase(OfficialHelloString) == 0;
 }
 
-void RPC_S2C_Authorization::Generate(Net::BitStream* bs, String errorString)
+void RPC_S2C_Authorization::Generate(Net::BitStream* bs, String errorString, String sharedMemoryName)
 {
     RPC_S2C_Authorization auth;
     if (errorString.IsEmpty())
@@ -69,6 +71,7 @@ void RPC_S2C_Authorization::Generate(Net::BitStream* bs, String errorString)
     auth.MajorVersion = RPCVersion_Major;
     auth.MinorVersion = RPCVersion_Minor;
     auth.PatchVersion = RPCVersion_Patch;
+    auth.SharedMemoryName = sharedMemoryName;
     auth.Serialize(bs);
 }
 
@@ -77,10 +80,74 @@ bool RPC_S2C_Authorization::Validate()
     return AuthString.CompareNoCase(OfficialAuthorizedString) == 0;
 }
 
+void RPC_C2S_SharedMemoryAck::Generate(Net::BitStream* bs, bool opened)
+{
+    RPC_C2S_SharedMemoryAck ack;
+    ack.Opened = opened;
+    ack.Serialize(bs);
+}
+
 
 //-----------------------------------------------------------------------------
 // Session
 
+// Shared-memory connections keep their packetized TCP socket for disconnect detection
+static inline bool HasPacketizedSocket(const Connection* conn)
+{
+    return conn->Transport == TransportType_PacketizedTCP ||
+           conn->Transport == TransportType_SharedMemory;
+}
+
+static int findConnectionIndex(const Array< Ptr<Connection> >& connections, const Connection* conn)
+{
+    const int count = connections.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        if (connections[i].GetPtr() == conn)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+Session::~Session()
+{
+    StopIOThread();
+
+    // Stop the shared-memory readers while the listeners are still around
+    Array< Ptr<SharedMemoryChannel> > channels;
+    {
+        Lock::Locker locker(&ConnectionsLock);
+
+        const int count = AllConnections.GetSizeI();
+        for (int i = 0; i < count; ++i)
+        {
+            if (AllConnections[i]->Transport == TransportType_SharedMemory)
+            {
+                channels.PushBack(((PacketizedTCPConnection*)AllConnections[i].GetPtr())->pChannel);
+            }
+        }
+    }
+
+    const int channelCount = channels.GetSizeI();
+    for (int i = 0; i < channelCount; ++i)
+    {
+        channels[i]->Close();
+    }
+
+    // Free anything that was never delivered
+    QueuedReceivePayload queued;
+    while (ReceiveQueue.Pop(queued))
+    {
+        if (queued.pData)
+        {
+            OVR_FREE(queued.pData);
+        }
+    }
+}
+
 void Session::Shutdown()
 {
     {
@@ -100,13 +167,16 @@ void Session::Shutdown()
     {
         Connection* arrayItem = AllConnections[i].GetPtr();
 
-        if (arrayItem->Transport == TransportType_PacketizedTCP)
+        if (HasPacketizedSocket(arrayItem))
         {
             PacketizedTCPConnection* ptcp = (PacketizedTCPConnection*)arrayItem;
 
             ptcp->pSocket->Close();
         }
     }
+
+    // Closed handles never signal, so have the next Poll() report them
+    ClosedSocketsPending.Store_Release(1);
 }
 
 SessionResult Session::Listen(ListenerDescription* pListenerDescription)
@@ -121,8 +191,16 @@ SessionResult Session::Listen(ListenerDescription* pListenerDescription)
             return SessionResult_ListenFailure;
         }
 
+        if (!PollState.Add(tcpSocket))
+        {
+            tcpSocket->Close();
+            return SessionResult_ListenFailure;
+        }
+
 		Lock::Locker locker(&SocketListenersLock);
         SocketListeners.PushBack(tcpSocket);
+
+        setPollTimeout(tcpSocket);
 	}
     else if (pListenerDescription->Transport == TransportType_Loopback)
 	{
@@ -146,8 +224,7 @@ SessionResult Session::Connect(ConnectParameters *cp)
         {
             Lock::Locker locker(&ConnectionsLock);
 
-            int connIndex;
-            Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(AllConnections, cp2->BoundSocketToConnectWith, &connIndex);
+            Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(cp2->BoundSocketToConnectWith);
             if (conn)
             {
                 return SessionResult_AlreadyConnected;
@@ -173,8 +250,16 @@ SessionResult Session::Connect(ConnectParameters *cp)
             c->Transport = cp2->Transport;
             c->SetState(Client_Connecting);
 
-            AllConnections.PushBack(c);
+            addConnection(c);
 
+            // Added after Connect() so the poll state also waits for the connection to complete
+            if (!PollState.Add(c->pSocket))
+            {
+                removeConnection(c->pSocket);
+                c->pSocket->Close();
+                return SessionResult_ConnectFailure;
+            }
+            setPollTimeout(c->pSocket);
         }
 
         if (cp2->Blocking)
@@ -210,7 +295,7 @@ SessionResult Session::Connect(ConnectParameters *cp)
 
             {
                 Lock::Locker locker(&ConnectionsLock);
-                AllConnections.PushBack(c);
+                addConnection(c);
             }
 
 			invokeSessionEvent(&SessionListener::OnConnectionRequestAccepted, c);
@@ -245,6 +330,14 @@ SessionResult Session::ListenPTCP(OVR::Net::BerkleyBindParameters *bbp)
 
 SessionResult Session::ConnectPTCP(OVR::Net::BerkleyBindParameters* bbp, SockAddr* remoteAddress, bool blocking)
 {
+    // Local sockets connect by path
+    SockAddr noAddress;
+    if (!remoteAddress)
+    {
+        OVR_ASSERT(!bbp->LocalPath.IsEmpty());
+        remoteAddress = &noAddress;
+    }
+
     ConnectParametersBerkleySocket cp(NULL, remoteAddress, blocking, TransportType_PacketizedTCP);
     Ptr<PacketizedTCPSocket> connectSocket = *new PacketizedTCPSocket();
 
@@ -257,25 +350,10 @@ SessionResult Session::ConnectPTCP(OVR::Net::BerkleyBindParameters* bbp, SockAdd
 	return Connect(&cp);
 }
 
-Ptr<PacketizedTCPConnection> Session::findConnectionBySockAddr(SockAddr* address)
+Ptr<PacketizedTCPConnection> Session::findConnectionByChannel(SharedMemoryChannel* channel)
 {
-    const int count = AllConnections.GetSizeI();
-    for (int i = 0; i < count; ++i)
-    {
-        Connection* arrayItem = AllConnections[i].GetPtr();
-
-        if (arrayItem->Transport == TransportType_PacketizedTCP)
-        {
-            PacketizedTCPConnection* conn = (PacketizedTCPConnection*)arrayItem;
-
-            if (conn->Address == *address)
-            {
-                return conn;
-            }
-        }
-    }
-
-    return 0;
+    const Ptr<PacketizedTCPConnection>* conn = ConnectionsByChannel.Get(channel);
+    return conn ? *conn : NULL;
 }
 
 int Session::Send(SendParameters *payload)
@@ -312,8 +390,48 @@ int Session::Send(SendParameters *payload)
 	{
 		PacketizedTCPConnection* conn = (PacketizedTCPConnection*)payload->pConnection.GetPtr();
 
+        // Replies sent from listener callbacks go out together at the end of Poll()
+        if (SendCoalescing && PollThreadId.Load_Acquire() == GetCurrentThreadId())
+        {
+            PacketizedTCPSocket* ptcpSocket = (PacketizedTCPSocket*)conn->pSocket.GetPtr();
+
+            int bytes = ptcpSocket->SendQueued(payload->pData, payload->Bytes);
+            if (bytes > 0)
+            {
+                const int pendingCount = PendingFlushSockets.GetSizeI();
+                int i = 0;
+                while (i < pendingCount && PendingFlushSockets[i] != ptcpSocket)
+                {
+                    ++i;
+                }
+                if (i == pendingCount)
+                {
+                    PendingFlushSockets.PushBack(ptcpSocket);
+                }
+            }
+            return bytes;
+        }
+
         return conn->pSocket->Send(payload->pData, payload->Bytes);
 	}
+    else if (payload->pConnection->Transport == TransportType_SharedMemory)
+    {
+        PacketizedTCPConnection* conn = (PacketizedTCPConnection*)payload->pConnection.GetPtr();
+
+        // Never waits for the peer, so one slow client does not hold up a Broadcast()
+        const int bytes = conn->pChannel->Send(payload->pData, payload->Bytes);
+        if (bytes < 0)
+        {
+            // The peer stopped reading. Closed handles never signal, so have the next Poll() report it.
+            conn->pSocket->Close();
+            ClosedSocketsPending.Store_Release(1);
+        }
+        else if (conn->pChannel->HasBacklog())
+        {
+            ChannelBacklogsPending.Store_Release(1);
+        }
+        return bytes;
+    }
     else
     {
         OVR_ASSERT(false);
@@ -327,87 +445,260 @@ void Session::Broadcast(BroadcastParameters *payload)
     sp.Bytes=payload->Bytes;
     sp.pData=payload->pData;
 
+    // Iterates a snapshot, so sends to slow peers do not hold ConnectionsLock against the receive path
+    ConnectionSnapshot::Reader reader(FullConnectionsSnapshot);
+    const Array< Ptr<Connection> >* connections = reader.GetPtr();
+    if (connections)
     {
-        Lock::Locker locker(&ConnectionsLock);
-
-        const int connectionCount = FullConnections.GetSizeI();
+        const int connectionCount = connections->GetSizeI();
         for (int i = 0; i < connectionCount; ++i)
         {
-            sp.pConnection = FullConnections[i];
+            sp.pConnection = (*connections)[i];
             Send(&sp);
-        }    
+        }
     }
 }
-// DO NOT CALL Poll() FROM MULTIPLE THREADS due to allBlockingTcpSockets being a member
+// DO NOT CALL Poll() FROM MULTIPLE THREADS: the poll state holds the events of the last wait
 void Session::Poll(bool listeners)
 {
-    allBlockingTcpSockets.Clear();
+    PollThreadId.Store_Release(GetCurrentThreadId());
 
-	if (listeners)
+    if (ClosedSocketsPending.Exchange_Acquire(0) != 0)
+    {
+        pollClosedSockets();
+    }
+
+	if (PollState.IsValid())
 	{
-		Lock::Locker locker(&SocketListenersLock);
+        // Come back soon to move channel backlogs along; the peer reading them does not wake us
+        int timeoutUsec = PollTimeoutUsec.Load_Acquire();
+        if (ChannelBacklogsPending.Load_Acquire() != 0 && timeoutUsec > 1000)
+        {
+            timeoutUsec = 1000;
+        }
 
-        const int listenerCount = SocketListeners.GetSizeI();
-        for (int i = 0; i < listenerCount; ++i)
-		{
-            allBlockingTcpSockets.PushBack(SocketListeners[i]);
-		}
+        // If polling returns with an event,
+        if (PollState.Poll(timeoutUsec % 1000000, timeoutUsec / 1000000, listeners))
+        {
+            // Handle the events of the sockets that are ready
+            PollState.HandleEvents(this);
+        }
+
+        flushPendingSends();
+        flushChannelBacklogs();
 	}
 
+    PollThreadId.Store_Release(0);
+}
+
+void Session::setPollTimeout(TCPSocket* pSocket)
+{
+    // One value, so that Poll() on another thread never sees half of an update
+    PollTimeoutUsec.Store_Release(pSocket->GetBlockingTimeoutSec() * 1000000 + pSocket->GetBlockingTimeoutUsec());
+}
+
+void Session::flushPendingSends()
+{
+    const int count = PendingFlushSockets.GetSizeI();
+    for (int i = 0; i < count; ++i)
     {
-        Lock::Locker locker(&ConnectionsLock);
+        PendingFlushSockets[i]->FlushSendQueue();
+    }
 
-        const int connectionCount = AllConnections.GetSizeI();
+    PendingFlushSockets.Clear();
+}
+
+void Session::flushChannelBacklogs()
+{
+    if (ChannelBacklogsPending.Exchange_Acquire(0) == 0)
+    {
+        return;
+    }
+
+    bool stillPending = false;
+
+    ConnectionSnapshot::Reader reader(FullConnectionsSnapshot);
+    const Array< Ptr<Connection> >* connections = reader.GetPtr();
+    if (connections)
+    {
+        const int connectionCount = connections->GetSizeI();
         for (int i = 0; i < connectionCount; ++i)
         {
-            Connection* arrayItem = AllConnections[i].GetPtr();
+            Connection* arrayItem = (*connections)[i].GetPtr();
+            if (arrayItem->Transport != TransportType_SharedMemory)
+            {
+                continue;
+            }
 
-            if (arrayItem->Transport == TransportType_PacketizedTCP)
+            PacketizedTCPConnection* conn = (PacketizedTCPConnection*)arrayItem;
+            if (!conn->pChannel->HasBacklog())
             {
-                PacketizedTCPConnection* ptcp = (PacketizedTCPConnection*)arrayItem;
+                continue;
+            }
 
-                allBlockingTcpSockets.PushBack(ptcp->pSocket);
+            if (!conn->pChannel->Flush())
+            {
+                // The peer stopped reading; TCP_OnClosed() closes the channel
+                conn->pSocket->Close();
+                ClosedSocketsPending.Store_Release(1);
             }
-            else
+            else if (conn->pChannel->HasBacklog())
             {
-                OVR_ASSERT(false);
+                stillPending = true;
             }
         }
     }
 
-    const int count = allBlockingTcpSockets.GetSizeI();
-	if (count > 0)
-	{
-        TCPSocketPollState state;
+    if (stillPending)
+    {
+        ChannelBacklogsPending.Store_Release(1);
+    }
+}
 
-        // Add all the sockets for polling,
-        for (int i = 0; i < count; ++i)
+bool Session::StartIOThread(bool listeners)
+{
+    if (pIOThread)
+    {
+        return true;
+    }
+
+    IOThreadListeners = listeners;
+    IOThreadTerminated.Store_Release(0);
+
+    pIOThread = *new Thread(ioThreadFunction, this);
+    if (!pIOThread || !pIOThread->Start())
+    {
+        pIOThread = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void Session::StopIOThread()
+{
+    if (pIOThread)
+    {
+        IOThreadTerminated.Store_Release(1);
+        pIOThread->Join();
+        pIOThread = NULL;
+    }
+}
+
+int Session::ioThreadFunction(Thread* pthread, void* h)
+{
+    Session* session = (Session*)h;
+
+    pthread->SetThreadName("NetSessionIO");
+
+    while (session->IOThreadTerminated.Load_Acquire() == 0)
+    {
+        session->Poll(session->IOThreadListeners);
+
+        // Poll() returns at once when there is nothing to wait on
+        if (!session->PollState.IsValid())
         {
-            Net::TCPSocket* sock = allBlockingTcpSockets[i].GetPtr();
+            Thread::MSleep(10);
+        }
+    }
 
-            // If socket handle is invalid,
-            if (sock->GetSocketHandle() == INVALID_SOCKET)
-            {
-                OVR_DEBUG_LOG(("[Session] Detected an invalid socket handle - Treating it as a disconnection."));
-                sock->IsConnecting = false;
-                TCP_OnClosed(sock);
-            }
-            else
-            {
-                state.Add(sock);
-            }
+    return 0;
+}
+
+void Session::queueReceivedData(Connection* pConnection, uint8_t* pData, int bytesRead)
+{
+    QueuedReceivePayload queued;
+    queued.pData = (uint8_t*)OVR_ALLOC(bytesRead > 0 ? bytesRead : 1);
+    if (!queued.pData)
+    {
+        return;
+    }
+
+    memcpy(queued.pData, pData, bytesRead);
+    queued.Bytes = bytesRead;
+    queued.pConnection = pConnection;
+
+    pushReceiveQueue(queued);
+}
+
+void Session::pushReceiveQueue(QueuedReceivePayload& queued)
+{
+    ReceiveQueue.Push(queued);
+    ReceiveQueueCount.ExchangeAdd_Sync(1);
+
+    // Only pay for the wakeup when a consumer is actually waiting
+    if (ReceiveQueueWaiters.Load_Acquire() > 0)
+    {
+        ReceiveQueueEvent.SetEvent();
+    }
+}
+
+int Session::ProcessReceiveQueue(int maxMessages, unsigned waitMs)
+{
+    if (waitMs > 0 && ReceiveQueueCount.Load_Acquire() <= 0)
+    {
+        // Reset before announcing the wait, so a message queued after the
+        // count check below always finds the waiter and sets the event
+        ReceiveQueueEvent.ResetEvent();
+        ReceiveQueueWaiters.ExchangeAdd_Sync(1);
+
+        if (ReceiveQueueCount.Load_Acquire() <= 0)
+        {
+            ReceiveQueueEvent.Wait(waitMs);
         }
 
-        // If polling returns with an event,
-        if (state.Poll(allBlockingTcpSockets[0]->GetBlockingTimeoutUsec(), allBlockingTcpSockets[0]->GetBlockingTimeoutSec()))
+        ReceiveQueueWaiters.ExchangeAdd_Sync(-1);
+    }
+
+    Lock::Locker locker(&ReceiveQueueConsumerLock);
+
+    int delivered = 0;
+    QueuedReceivePayload queued;
+    while ((maxMessages <= 0 || delivered < maxMessages) && ReceiveQueue.Pop(queued))
+    {
+        ReceiveQueueCount.ExchangeAdd_Sync(-1);
+
+        if (queued.Event)
         {
-            // Handle any events for each socket
-            for (int i = 0; i < count; ++i)
-            {
-                state.HandleEvent(allBlockingTcpSockets[i], this);
-            }
+            dispatchSessionEvent(queued.Event, queued.pConnection);
+            queued.Event = NULL;
         }
-	}
+        else
+        {
+            ReceivePayload rp;
+            rp.pConnection = queued.pConnection;
+            rp.pData = queued.pData;
+            rp.Bytes = queued.Bytes;
+
+            invokeSessionListeners(&rp);
+
+            OVR_FREE(queued.pData);
+            queued.pData = NULL;
+        }
+        ++delivered;
+    }
+
+    return delivered;
+}
+
+void Session::pollClosedSockets()
+{
+    Array< Ptr<TCPSocket> > sockets;
+    PollState.GetSockets(sockets);
+
+    const int count = sockets.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        Net::TCPSocket* sock = sockets[i].GetPtr();
+
+        // If socket handle is invalid,
+        if (sock->GetSocketHandle() == INVALID_SOCKET)
+        {
+            OVR_DEBUG_LOG(("[Session] Detected an invalid socket handle - Treating it as a disconnection."));
+            sock->IsConnecting = false;
+            TCP_OnClosed(sock);
+        }
+    }
 }
 
 void Session::AddSessionListener(SessionListener* se)
@@ -465,29 +756,82 @@ Ptr<Connection> Session::AllocConnection(TransportType transport)
     return NULL;
 }
 
-Ptr<PacketizedTCPConnection> Session::findConnectionBySocket(Array< Ptr<Connection> >& connectionArray, Socket* s, int *connectionIndex)
+void Session::addConnection(Connection* conn)
 {
-    const int count = connectionArray.GetSizeI();
-    for (int i = 0; i < count; ++i)
+    AllConnections.PushBack(conn);
+
+    if (HasPacketizedSocket(conn))
     {
-        Connection* arrayItem = connectionArray[i].GetPtr();
+        PacketizedTCPConnection* ptcp = (PacketizedTCPConnection*)conn;
 
-        if (arrayItem->Transport == TransportType_PacketizedTCP)
-        {
-            PacketizedTCPConnection* ptc = (PacketizedTCPConnection*)arrayItem;
+        ConnectionsBySocket.Set(ptcp->pSocket.GetPtr(), ptcp);
+    }
+}
 
-            if (ptc->pSocket == s)
-            {
-                if (connectionIndex)
-                {
-                    *connectionIndex = i;
-                }
-                return ptc;
-            }
-        }
+void Session::promoteConnection(PacketizedTCPConnection* conn)
+{
+    // Skip it if it closed meanwhile or was already promoted
+    if (findConnectionBySocket(conn->pSocket) != conn ||
+        findConnectionIndex(FullConnections, conn) >= 0)
+    {
+        return;
     }
 
-    return NULL;
+    FullConnections.PushBack(conn);
+    FullConnectionsSnapshot.Publish(FullConnections);
+
+    if (conn->pChannel)
+    {
+        ConnectionsByChannel.Set(conn->pChannel.GetPtr(), conn);
+    }
+}
+
+void Session::acceptConnection(PacketizedTCPConnection* conn)
+{
+    // Mark as connected
+    conn->SetState(State_Connected);
+	ConnectionsLock.DoLock();
+	promoteConnection(conn);
+	ConnectionsLock.Unlock();
+    invokeSessionEvent(&SessionListener::OnNewIncomingConnection, conn);
+
+    // Anything the client sent meanwhile waits in the ring
+    if (conn->pChannel)
+    {
+        conn->pChannel->StartReceiving(this);
+    }
+}
+
+Ptr<PacketizedTCPConnection> Session::removeConnection(Socket* s)
+{
+    Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(s);
+    if (!conn)
+    {
+        return NULL;
+    }
+
+    ConnectionsBySocket.Remove(s);
+    AllConnections.RemoveAtUnordered(findConnectionIndex(AllConnections, conn));
+
+    const int fullIndex = findConnectionIndex(FullConnections, conn);
+    if (fullIndex >= 0)
+    {
+        FullConnections.RemoveAtUnordered(fullIndex);
+        FullConnectionsSnapshot.Publish(FullConnections);
+    }
+
+    if (conn->pChannel)
+    {
+        ConnectionsByChannel.Remove(conn->pChannel.GetPtr());
+    }
+
+    return conn;
+}
+
+Ptr<PacketizedTCPConnection> Session::findConnectionBySocket(Socket* s)
+{
+    const Ptr<PacketizedTCPConnection>* conn = ConnectionsBySocket.Get(s);
+    return conn ? *conn : NULL;
 }
 
 int Session::invokeSessionListeners(ReceivePayload* rp)
@@ -514,14 +858,16 @@ void Session::TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
 	// KevinJ: 9/2/2014 Fix deadlock - Watchdog calls Broadcast(), which locks ConnectionsLock().
 	// Lock::Locker locker(&ConnectionsLock);
 
-    // Look for the connection in the full connection list first
-    int connIndex;
 	ConnectionsLock.DoLock();
-    Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(AllConnections, pSocket, &connIndex);
+    Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(pSocket);
 	ConnectionsLock.Unlock();
     if (conn)
     {
-        if (conn->State == State_Connected)
+        if (conn->State == State_Connected && ReceiveQueueing)
+        {
+            queueReceivedData(conn, pData, bytesRead);
+        }
+        else if (conn->State == State_Connected)
         {
             ReceivePayload rp;
             rp.Bytes = bytesRead;
@@ -534,7 +880,7 @@ void Session::TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
         else if (conn->State == Client_ConnectedWait)
         {
             // Check the version data from the message
-            BitStream bsIn((char*)pData, bytesRead, false);
+            BitStreamView bsIn(pData, bytesRead);
 
             RPC_S2C_Authorization auth;
             if (!auth.Deserialize(&bsIn) ||
@@ -552,22 +898,48 @@ void Session::TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
                 conn->RemoteMinorVersion = auth.MinorVersion;
                 conn->RemotePatchVersion = auth.PatchVersion;
 
+                // Move over to the channel the server set up for us
+                Ptr<SharedMemoryChannel> channel;
+                if (!auth.SharedMemoryName.IsEmpty())
+                {
+                    channel = *new SharedMemoryChannel;
+                    if (!channel->Open(auth.SharedMemoryName))
+                    {
+                        // Only this connection stays on TCP; the server is told so below
+                        LogError("{ERR-102} [Session] Unable to open shared memory channel %s - Staying on TCP.", auth.SharedMemoryName.ToCStr());
+                        channel.Clear();
+                    }
+
+                    // Server waits for this before using the channel or the socket
+                    BitStream bsOut;
+                    RPC_C2S_SharedMemoryAck::Generate(&bsOut, channel != NULL);
+                    conn->pSocket->Send(bsOut.GetData(), bsOut.GetNumberOfBytesUsed());
+
+                    if (channel)
+                    {
+                        conn->pChannel = channel;
+                        conn->Transport = TransportType_SharedMemory;
+                    }
+                }
+
                 // Mark as connected
                 conn->SetState(State_Connected);
 				ConnectionsLock.DoLock();
-				int connIndex2;
-				if (findConnectionBySocket(AllConnections, pSocket, &connIndex2)==conn && findConnectionBySocket(FullConnections, pSocket, &connIndex2)==NULL)
-				{
-					FullConnections.PushBack(conn);
-				}
+				promoteConnection(conn);
 				ConnectionsLock.Unlock();
                 invokeSessionEvent(&SessionListener::OnConnectionRequestAccepted, conn);
+
+                // Anything the server sent meanwhile waits in the ring
+                if (channel)
+                {
+                    channel->StartReceiving(this);
+                }
             }
         }
         else if (conn->State == Server_ConnectedWait)
         {
             // Check the version data from the message
-            BitStream bsIn((char*)pData, bytesRead, false);
+            BitStreamView bsIn(pData, bytesRead);
 
             RPC_C2S_Hello hello;
             if (!hello.Deserialize(&bsIn) ||
@@ -586,28 +958,74 @@ void Session::TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
             }
             else
             {
-                // Read remote version
+                // Read remote version; features are chosen by what the client really speaks
                 conn->RemoteMajorVersion = hello.MajorVersion;
-                conn->RemoteMinorVersion = hello.MinorVersion;
+                conn->RemoteMinorVersion = hello.ActualMinorVersion;
                 conn->RemotePatchVersion = hello.PatchVersion;
 
+                // Set up a shared-memory channel if the client asked for one
+                Ptr<SharedMemoryChannel> channel;
+                if (hello.RequestSharedMemory && SharedMemoryTransport)
+                {
+                    channel = *new SharedMemoryChannel;
+                    if (!channel->Create(SharedMemoryChannel::GenerateName()))
+                    {
+                        LogError("{ERR-103} [Session] Unable to create shared memory channel - Staying on TCP.");
+                        channel.Clear();
+                    }
+                }
+
                 // Send auth response
                 BitStream bsOut;
-                RPC_S2C_Authorization::Generate(&bsOut);
+                RPC_S2C_Authorization::Generate(&bsOut, "", channel ? channel->GetName() : String());
                 conn->pSocket->Send(bsOut.GetData(), bsOut.GetNumberOfBytesUsed());
 
-                // Mark as connected
-                conn->SetState(State_Connected);
-				ConnectionsLock.DoLock();
-				int connIndex2;
-				if (findConnectionBySocket(AllConnections, pSocket, &connIndex2)==conn && findConnectionBySocket(FullConnections, pSocket, &connIndex2)==NULL)
-				{
-					FullConnections.PushBack(conn);
-				}
-				ConnectionsLock.Unlock();
-                invokeSessionEvent(&SessionListener::OnNewIncomingConnection, conn);
+                if (channel)
+                {
+                    // Connected once the client says whether it could open the channel
+                    conn->pChannel = channel;
+                    conn->SetState(Server_ChannelWait);
+                }
+                else
+                {
+                    acceptConnection(conn);
+                }
+            }
+        }
+        else if (conn->State == Server_ChannelWait)
+        {
+            BitStreamView bsIn(pData, bytesRead);
 
+            RPC_C2S_SharedMemoryAck ack;
+            if (!ack.Deserialize(&bsIn))
+            {
+                LogError("{ERR-106} [Session] REJECTED: Malformed shared memory channel acknowledgement.");
+
+                // Closed handles never signal, so have the next Poll() report it.
+                // TCP_OnClosed() then closes the channel.
+                conn->pSocket->Close();
+                ClosedSocketsPending.Store_Release(1);
+                return;
             }
+
+            if (ack.Opened)
+            {
+                // Everything after the ack goes through the channel
+                conn->Transport = TransportType_SharedMemory;
+            }
+            else
+            {
+                LogError("{ERR-107} [Session] Client could not open shared memory channel %s - Staying on TCP.", conn->pChannel->GetName().ToCStr());
+
+                ConnectionsLock.DoLock();
+                Ptr<SharedMemoryChannel> channel = conn->pChannel;
+                conn->pChannel.Clear();
+                ConnectionsLock.Unlock();
+
+                channel->Close();
+            }
+
+            acceptConnection(conn);
         }
         else
         {
@@ -618,41 +1036,46 @@ void Session::TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
 
 void Session::TCP_OnClosed(TCPSocket* s)
 {
-	Lock::Locker locker(&ConnectionsLock);
+    PollState.Remove(s);
+
+    Ptr<SharedMemoryChannel> channel;
 
-    // If found in the full connection list,
-    int connIndex;
-    Ptr<PacketizedTCPConnection> conn = findConnectionBySocket(AllConnections, s, &connIndex);
-    if (conn)
     {
-        AllConnections.RemoveAtUnordered(connIndex);
+        Lock::Locker locker(&ConnectionsLock);
 
-        // If in the full connection list,
-        if (findConnectionBySocket(FullConnections, s, &connIndex))
+        // If found, drop it from the lists and indices
+        Ptr<PacketizedTCPConnection> conn = removeConnection(s);
+        if (conn)
         {
-            FullConnections.RemoveAtUnordered(connIndex);
-        }
+            // Generate an appropriate event for the current state
+            switch (conn->State)
+            {
+            case Client_Connecting:
+                invokeSessionEvent(&SessionListener::OnConnectionAttemptFailed, conn);
+                break;
+            case Client_ConnectedWait:
+            case Server_ConnectedWait:
+            case Server_ChannelWait:
+                invokeSessionEvent(&SessionListener::OnHandshakeAttemptFailed, conn);
+                break;
+            case State_Connected:
+            case State_Zombie:
+                invokeSessionEvent(&SessionListener::OnDisconnected, conn);
+                break;
+            default:
+                OVR_ASSERT(false);
+                break;
+            }
 
-        // Generate an appropriate event for the current state
-        switch (conn->State)
-        {
-        case Client_Connecting:
-            invokeSessionEvent(&SessionListener::OnConnectionAttemptFailed, conn);
-            break;
-        case Client_ConnectedWait:
-        case Server_ConnectedWait:
-            invokeSessionEvent(&SessionListener::OnHandshakeAttemptFailed, conn);
-            break;
-        case State_Connected:
-        case State_Zombie:
-            invokeSessionEvent(&SessionListener::OnDisconnected, conn);
-            break;
-        default:
-            OVR_ASSERT(false);
-            break;
+            conn->SetState(State_Zombie);
+            channel = conn->pChannel;
         }
+    }
 
-        conn->SetState(State_Zombie);
+    // Not under ConnectionsLock: the channel's reader thread takes it to deliver messages
+    if (channel)
+    {
+        channel->Close();
     }
 }
 
@@ -672,6 +1095,12 @@ void Session::TCP_OnAccept(TCPSocket* pListener, SockAddr* pSockAddr, SocketHand
 
 	if (newSocket)
 	{
+        if (!PollState.Add(newSocket))
+        {
+            newSocket->Close();
+            return;
+        }
+
 		Ptr<Connection> b = AllocConnection(TransportType_PacketizedTCP);
 		Ptr<PacketizedTCPConnection> c = (PacketizedTCPConnection*)b.GetPtr();
 		c->pSocket = newSocket;
@@ -680,7 +1109,7 @@ void Session::TCP_OnAccept(TCPSocket* pListener, SockAddr* pSockAddr, SocketHand
 
         {
             Lock::Locker locker(&ConnectionsLock);
-            AllConnections.PushBack(c);
+            addConnection(c);
         }
 
         // Server does not send the first packet.  It waits for the client to send its version
@@ -692,14 +1121,14 @@ void Session::TCP_OnConnected(TCPSocket *s)
     Lock::Locker locker(&ConnectionsLock);
 
     // If connection was found,
-    PacketizedTCPConnection* conn = findConnectionBySocket(AllConnections, s);
+    PacketizedTCPConnection* conn = findConnectionBySocket(s);
     if (conn)
     {
         OVR_ASSERT(conn->State == Client_Connecting);
 
         // Send hello message
         BitStream bsOut;
-        RPC_C2S_Hello::Generate(&bsOut);
+        RPC_C2S_Hello::Generate(&bsOut, SharedMemoryTransport);
         conn->pSocket->Send(bsOut.GetData(), bsOut.GetNumberOfBytesUsed());
 
         // Just update state but do not generate any notifications yet
@@ -707,7 +1136,61 @@ void Session::TCP_OnConnected(TCPSocket *s)
     }
 }
 
-void Session::invokeSessionEvent(void(SessionListener::*f)(Connection*), Connection* conn)
+void Session::SharedMemory_OnRecv(SharedMemoryChannel* pChannel, uint8_t* pData, int bytesRead)
+{
+    ConnectionsLock.DoLock();
+    Ptr<PacketizedTCPConnection> conn = findConnectionByChannel(pChannel);
+    ConnectionsLock.Unlock();
+
+    // Dropped if the socket has closed in the meantime
+    if (conn && conn->State == State_Connected)
+    {
+        if (ReceiveQueueing)
+        {
+            queueReceivedData(conn, pData, bytesRead);
+        }
+        else
+        {
+            ReceivePayload rp;
+            rp.Bytes = bytesRead;
+            rp.pConnection = conn;
+            rp.pData = pData;
+
+            invokeSessionListeners(&rp);
+        }
+    }
+}
+
+void Session::SharedMemory_OnBroken(SharedMemoryChannel* pChannel)
+{
+    Lock::Locker locker(&ConnectionsLock);
+
+    Ptr<PacketizedTCPConnection> conn = findConnectionByChannel(pChannel);
+    if (conn)
+    {
+        // Closed handles never signal, so have the next Poll() report it.
+        // TCP_OnClosed() then closes the channel.
+        conn->pSocket->Close();
+        ClosedSocketsPending.Store_Release(1);
+    }
+}
+
+void Session::invokeSessionEvent(SessionEventFunction f, Connection* conn)
+{
+    // Delivered by the consumer thread after any data already queued for the connection
+    if (ReceiveQueueing)
+    {
+        QueuedReceivePayload queued;
+        queued.pConnection = conn;
+        queued.Event = f;
+        pushReceiveQueue(queued);
+        return;
+    }
+
+    dispatchSessionEvent(f, conn);
+}
+
+void Session::dispatchSessionEvent(SessionEventFunction f, Connection* conn)
 {
     Lock::Locker locker(&SessionListenersLock);
 
@@ -720,13 +1203,12 @@ void Session::invokeSessionEvent(void(SessionListener::*f)(Connection*), Connect
 
 Ptr<Connection> Session::GetConnectionAtIndex(int index)
 {
-    Lock::Locker locker(&ConnectionsLock);
-
-    const int count = FullConnections.GetSizeI();
+    ConnectionSnapshot::Reader reader(FullConnectionsSnapshot);
+    const Array< Ptr<Connection> >* connections = reader.GetPtr();
 
-    if (index < count)
+    if (connections && index < connections->GetSizeI())
     {
-        return FullConnections[index];
+        return (*connections)[index];
     }
 
     return NULL;
@@ -30,10 +30,13 @@ limitations under the License.
 
 #include "OVR_Socket.h"
 #include "OVR_PacketizedTCPSocket.h"
+#include "OVR_SharedMemoryChannel.h"
 #include "../Kernel/OVR_Array.h"
+#include "../Kernel/OVR_Hash.h"
 #include "../Kernel/OVR_Threads.h"
 #include "../Kernel/OVR_Atomic.h"
 #include "../Kernel/OVR_RefCount.h"
+#include "../Kernel/OVR_Lockless.h"
 
 namespace OVR { namespace Net {
 
@@ -47,33 +50,58 @@ class Session;
 // 1.0.0 - [SDK 0.4.0] Initial version (July 21, 2014)
 // 1.1.0 - Add Get/SetDriverMode_1, HMDCountUpdate_1
 //         Version mismatch results (July 28, 2014)
+// 1.2.0 - RPC1 calls tagged with request IDs, so several can be outstanding at once
+// 1.3.0 - RPC1 peers exchange numeric IDs for function and slot names
+// 1.4.0 - Add GetValues_1, SetValues_1
+// 1.5.0 - Add PropertyChanged_1; clients cache property reads until it arrives
+// 1.6.0 - Hello may request a shared-memory channel; authorization names it and
+//         the client answers whether it could open it
+//         Hello carries the client's real minor version after the one it advertises
+//
+// Each side looks at the other's version (Connection::RemoteVersionAtLeast) before
+// using anything added after 1.1, since peers back to 1.1 still connect.
 //-----------------------------------------------------------------------------
 
 static const uint16_t RPCVersion_Major = 1; // MAJOR version when you make incompatible API changes,
-static const uint16_t RPCVersion_Minor = 1; // MINOR version when you add functionality in a backwards-compatible manner, and
+static const uint16_t RPCVersion_Minor = 6; // MINOR version when you add functionality in a backwards-compatible manner, and
 static const uint16_t RPCVersion_Patch = 0; // PATCH version when you make backwards-compatible bug fixes.
 
+// Minor version put in the Hello. Servers refuse clients with a newer minor version than
+// their own, so clients claim the oldest one they still talk to (shipped 1.1 services), and
+// send RPCVersion_Minor after it for newer servers to read.
+static const uint16_t RPCVersion_MinorAdvertised = 1;
+
 // Client starts communication by sending its version number.
 struct RPC_C2S_Hello
 {
     RPC_C2S_Hello() :
         MajorVersion(0),
         MinorVersion(0),
-        PatchVersion(0)
+        PatchVersion(0),
+        RequestSharedMemory(false),
+        ActualMinorVersion(0)
     {
     }
 
     String HelloString;
 
-    // Client version info
+    // Client version info; MinorVersion is RPCVersion_MinorAdvertised from 1.6.0 clients
     uint16_t MajorVersion, MinorVersion, PatchVersion;
 
+    // Client would like its traffic moved to a shared-memory channel (1.6.0)
+    bool RequestSharedMemory;
+
+    // Client's own minor version (1.6.0); MinorVersion for older clients
+    uint16_t ActualMinorVersion;
+
     void Serialize(Net::BitStream* bs)
     {
         bs->Write(HelloString);
         bs->Write(MajorVersion);
         bs->Write(MinorVersion);
         bs->Write(PatchVersion);
+        bs->Write(RequestSharedMemory);
+        bs->Write(ActualMinorVersion);
     }
 
     bool Deserialize(Net::BitStream* bs)
@@ -81,10 +109,21 @@ struct RPC_C2S_Hello
         bs->Read(HelloString);
         bs->Read(MajorVersion);
         bs->Read(MinorVersion);
-        return bs->Read(PatchVersion);
+        if (!bs->Read(PatchVersion))
+        {
+            return false;
+        }
+
+        // Older clients end here
+        if (!bs->Read(RequestSharedMemory) || !bs->Read(ActualMinorVersion))
+        {
+            RequestSharedMemory = false;
+            ActualMinorVersion  = MinorVersion;
+        }
+        return true;
     }
 
-    static void Generate(Net::BitStream* bs);
+    static void Generate(Net::BitStream* bs, bool requestSharedMemory = false);
 
     bool Validate();
 };
@@ -104,12 +143,16 @@ struct RPC_S2C_Authorization
     // Server version info
     uint16_t MajorVersion, MinorVersion, PatchVersion;
 
+    // Channel the client should open and use from now on, or empty to stay on TCP (1.6.0)
+    String SharedMemoryName;
+
     void Serialize(Net::BitStream* bs)
     {
         bs->Write(AuthString);
         bs->Write(MajorVersion);
         bs->Write(MinorVersion);
         bs->Write(PatchVersion);
+        bs->Write(SharedMemoryName);
     }
 
     bool Deserialize(Net::BitStream* bs)
@@ -117,14 +160,49 @@ struct RPC_S2C_Authorization
         bs->Read(AuthString);
         bs->Read(MajorVersion);
         bs->Read(MinorVersion);
-        return bs->Read(PatchVersion);
+        if (!bs->Read(PatchVersion))
+        {
+            return false;
+        }
+
+        // Older servers end here
+        if (!bs->Read(SharedMemoryName))
+        {
+            SharedMemoryName.Clear();
+        }
+        return true;
     }
 
-    static void Generate(Net::BitStream* bs, String errorString = "");
+    static void Generate(Net::BitStream* bs, String errorString = "", String sharedMemoryName = "");
 
     bool Validate();
 };
 
+// Client tells the server whether it opened the shared-memory channel named in the
+// authorization (1.6.0).  Only sent when a channel was named.
+struct RPC_C2S_SharedMemoryAck
+{
+    RPC_C2S_SharedMemoryAck() :
+        Opened(false)
+    {
+    }
+
+    // False: the client could not open the channel, so the connection stays on TCP
+    bool Opened;
+
+    void Serialize(Net::BitStream* bs)
+    {
+        bs->Write(Opened);
+    }
+
+    bool Deserialize(Net::BitStream* bs)
+    {
+        return bs->Read(Opened);
+    }
+
+    static void Generate(Net::BitStream* bs, bool opened);
+};
+
 
 //-----------------------------------------------------------------------------
 // Result of a session function
@@ -151,6 +229,7 @@ enum EConnectionState
 
     // Server-only:
     Server_ConnectedWait,  // Connected! Waiting for client handshake
+    Server_ChannelWait,    // Authorized! Waiting for client to open the shared-memory channel
 
     State_Connected        // Connected
 };
@@ -176,6 +255,12 @@ public:
 public:
     virtual void SetState(EConnectionState s) {State = s;}
 
+    // True if the peer speaks protocol 1.minor or later
+    bool RemoteVersionAtLeast(int minor) const
+    {
+        return RemoteMajorVersion == RPCVersion_Major && RemoteMinorVersion >= minor;
+    }
+
     TransportType    Transport;
     EConnectionState State;
 
@@ -252,6 +337,10 @@ public:
 
 //-----------------------------------------------------------------------------
 // Packetized TCP Connection
+//
+// When both ends agree during the handshake, Transport becomes TransportType_SharedMemory
+// and messages go through pChannel instead. The socket stays open, so that the session
+// still learns when the peer goes away.
 class PacketizedTCPConnection : public TCPConnection
 {
 public:
@@ -262,6 +351,9 @@ public:
     virtual ~PacketizedTCPConnection()
     {
     }
+
+public:
+    Ptr<SharedMemoryChannel> pChannel;
 };
 
 
@@ -435,76 +527,181 @@ public:
     virtual void OnRemovedFromSession(Session* session)        { OVR_UNUSED(session); }
 };
 
+typedef void (SessionListener::*SessionEventFunction)(Connection*);
+
+// Received message or connection event waiting in the Session receive queue
+struct QueuedReceivePayload
+{
+    QueuedReceivePayload() :
+        pData(NULL),
+        Bytes(0),
+        Event(NULL)
+    {
+    }
+
+    Ptr<Connection>      pConnection; // Source connection, kept alive until delivery
+    uint8_t*             pData;       // Copy of the data received, owned by the queue entry
+    int                  Bytes;       // Number of bytes of data received
+    SessionEventFunction Event;       // Connection event to deliver instead of data, if set
+};
+
 
 //-----------------------------------------------------------------------------
 // Session
 
 //  Interface for network events such as listening on a socket, sending data, connecting, and disconnecting. Works independently of the transport medium and also implements loopback
-class Session : public SocketEvent_TCP, public NewOverrideBase
+class Session : public SocketEvent_TCP, public SharedMemoryChannelEvents, public NewOverrideBase
 {
-    // Implement a policy to avoid releasing memory backing allBlockingTcpSockets
-	struct ArrayNoShrinkPolicy : ArrayDefaultPolicy
-	{
-		bool NeverShrinking() const { return 1; }
-	};
-
 public:
     Session() :
-        HasLoopbackListener(false)
+        HasLoopbackListener(false),
+        SendCoalescing(false),
+        SharedMemoryTransport(false),
+        PollTimeoutUsec(1000000),
+        ClosedSocketsPending(0),
+        ChannelBacklogsPending(0),
+        ReceiveQueueing(false),
+        ReceiveQueueCount(0),
+        ReceiveQueueWaiters(0),
+        IOThreadTerminated(0),
+        IOThreadListeners(true)
     {
     }
-    virtual ~Session()
-    {
-        // Ensure memory backing the sockets array is released
-		allBlockingTcpSockets.ClearAndRelease();
-    }
+    virtual ~Session();
 
 	virtual SessionResult Listen(ListenerDescription* pListenerDescription);
 	virtual SessionResult Connect(ConnectParameters* cp);
 	virtual int           Send(SendParameters* payload);
     virtual void          Broadcast(BroadcastParameters* payload);
-    // DO NOT CALL Poll() FROM MULTIPLE THREADS due to allBlockingTcpSockets being a member
+    // DO NOT CALL Poll() FROM MULTIPLE THREADS: the poll state holds the events of the last wait.
+    // Do not call it at all while the I/O thread is running.
     virtual void          Poll(bool listeners = true);
 	virtual void          AddSessionListener(SessionListener* se);
 	virtual void          RemoveSessionListener(SessionListener* se);
     virtual SInt32        GetActiveSocketsCount();
 
-    // Packetized TCP convenience functions
+    // Packetized TCP convenience functions.
+    // With bbp->LocalPath set, these use an AF_UNIX socket (Unix only) with the same
+    // framing, and RemoteAddress may be NULL.
     virtual SessionResult ListenPTCP(BerkleyBindParameters* bbp);
     virtual SessionResult ConnectPTCP(BerkleyBindParameters* bbp, SockAddr* RemoteAddress, bool blocking);
 
     // Closes all the sockets; useful for interrupting the socket polling during shutdown
     void            Shutdown();
 
+    // When enabled, messages sent from inside Poll() (that is, from SessionListener
+    // callbacks) are queued per connection and written with one system call per
+    // connection at the end of Poll(). Sends from other threads are unaffected.
+    void            SetSendCoalescing(bool enable)
+    {
+        SendCoalescing = enable;
+    }
+
+    // When enabled, a client asks the server for a shared-memory channel during the handshake,
+    // and a server grants it, so connections between two processes on this machine skip the
+    // socket stack. Both ends must enable it; otherwise the connection stays on TCP.
+    void            SetSharedMemoryTransport(bool enable)
+    {
+        SharedMemoryTransport = enable;
+    }
+
+    // When enabled, data received on connected sessions is not passed to the listeners from
+    // Poll(). It is copied into a lock-free queue instead, and delivered on whichever thread
+    // calls ProcessReceiveQueue(), so a slow listener never holds up socket reads.
+    // Connection events are queued the same way, so listeners see them in order with the data.
+    void            SetReceiveQueueing(bool enable)
+    {
+        ReceiveQueueing = enable;
+    }
+    // Delivers up to maxMessages queued messages (0 for all) to the session listeners on the
+    // calling thread, first waiting up to waitMs for one to arrive. Consumers are serialized,
+    // but never wait on the socket or connection locks. Returns the number delivered.
+    int             ProcessReceiveQueue(int maxMessages = 0, unsigned waitMs = 0);
+
+    // Calls Poll() from a dedicated thread until StopIOThread() or destruction.
+    // Usually combined with SetReceiveQueueing(true).
+    bool            StartIOThread(bool listeners = true);
+    void            StopIOThread();
+
     // Get count of successful connections (past handshake point)
     int             GetConnectionCount() const
     {
-        return FullConnections.GetSizeI();
+        ConnectionSnapshot::Reader reader(FullConnectionsSnapshot);
+        const Array< Ptr<Connection> >* connections = reader.GetPtr();
+        return connections ? connections->GetSizeI() : 0;
     }
     Ptr<Connection> GetConnectionAtIndex(int index);
 
 protected:
 	virtual Ptr<Connection> AllocConnection(TransportType transportType);
 
+    typedef LocklessSnapshot< Array< Ptr<Connection> > > ConnectionSnapshot;
+
     Lock SocketListenersLock, ConnectionsLock, SessionListenersLock;
     bool                      HasLoopbackListener; // Has loopback listener installed?
 	Array< Ptr<TCPSocket> >   SocketListeners;     // List of active sockets
     Array< Ptr<Connection> >  AllConnections;      // List of active connections stuck at the versioning handshake
     Array< Ptr<Connection> >  FullConnections;     // List of active connections past the versioning handshake
+    mutable ConnectionSnapshot FullConnectionsSnapshot; // Copy of FullConnections, republished on change, for lock-free iteration
+
+    // Indices into AllConnections for the receive and close paths, kept in step by add/promote/removeConnection().
+    // Keyed by socket, never by address: every local (AF_UNIX) peer reports the same one.
+    Hash< Socket*, Ptr<PacketizedTCPConnection> >             ConnectionsBySocket;
+    Hash< SharedMemoryChannel*, Ptr<PacketizedTCPConnection> > ConnectionsByChannel; // Shared-memory connections past the handshake
     Array< SessionListener* > SessionListeners;    // List of session listeners
-    Array< Ptr< Net::TCPSocket >, ArrayNoShrinkPolicy > allBlockingTcpSockets; // Preallocated blocking sockets array
+    TCPSocketPollState        PollState;           // Listening and connected sockets, kept up to date as they come and go
+
+    // Send coalescing
+    bool                      SendCoalescing;      // Queue sends made from the Poll() thread?
+    AtomicPtr<void>           PollThreadId;        // ThreadId of the thread inside Poll(), or 0; read by Send() on any thread
+    Array< Ptr<PacketizedTCPSocket> > PendingFlushSockets; // Sockets with queued sends; only used on the Poll() thread
+
+    bool                      SharedMemoryTransport; // Request (client) or grant (server) shared-memory channels?
+
+    AtomicInt<int>            PollTimeoutUsec;     // Blocking timeout of the last socket to listen or connect; read by Poll()
+    AtomicInt<int>            ClosedSocketsPending; // Set by Shutdown() so that Poll() reports the closed sockets
+    AtomicInt<int>            ChannelBacklogsPending; // Set by Send() when a channel is holding records for a slow peer
+
+    // Receive queue
+    bool                      ReceiveQueueing;     // Queue received data instead of dispatching it from Poll()?
+    LocklessQueue<QueuedReceivePayload> ReceiveQueue; // Filled by Poll(), drained by ProcessReceiveQueue()
+    Lock                      ReceiveQueueConsumerLock; // Serializes ProcessReceiveQueue() callers
+    AtomicInt<int>            ReceiveQueueCount;   // Messages pushed but not yet popped
+    Event                     ReceiveQueueEvent;   // Set when data is queued while a consumer waits
+    AtomicInt<int>            ReceiveQueueWaiters; // Number of consumers waiting on ReceiveQueueEvent
+
+    // I/O thread
+    Ptr<Thread>               pIOThread;
+    AtomicInt<int>            IOThreadTerminated;
+    bool                      IOThreadListeners;   // Poll() argument for the I/O thread
 
     // Tools
-    Ptr<PacketizedTCPConnection> findConnectionBySocket(Array< Ptr<Connection> >& connectionArray, Socket* s, int *connectionIndex = NULL); // Call with ConnectionsLock held
-    Ptr<PacketizedTCPConnection> findConnectionBySockAddr(SockAddr* address); // Call with ConnectionsLock held
+    void                  flushPendingSends();
+    void                  flushChannelBacklogs();
+    void                  setPollTimeout(TCPSocket* pSocket);     // Makes Poll() wait as long as pSocket blocks
+    void                  pollClosedSockets();
+    void                  queueReceivedData(Connection* pConnection, uint8_t* pData, int bytesRead);
+    void                  pushReceiveQueue(QueuedReceivePayload& queued);
+    static int            ioThreadFunction(Thread* pthread, void* h);
+    void                  addConnection(Connection* conn);                    // Call with ConnectionsLock held
+    void                  promoteConnection(PacketizedTCPConnection* conn);   // Call with ConnectionsLock held
+    void                  acceptConnection(PacketizedTCPConnection* conn);    // Server side, once the handshake is done
+    Ptr<PacketizedTCPConnection> removeConnection(Socket* s);                 // Call with ConnectionsLock held
+    Ptr<PacketizedTCPConnection> findConnectionBySocket(Socket* s);           // Call with ConnectionsLock held
+    Ptr<PacketizedTCPConnection> findConnectionByChannel(SharedMemoryChannel* channel); // Call with ConnectionsLock held
     int                   invokeSessionListeners(ReceivePayload*);
-    void                  invokeSessionEvent(void(SessionListener::*f)(Connection*), Connection* pConnection);
+    void                  invokeSessionEvent(SessionEventFunction f, Connection* pConnection);   // Queued when ReceiveQueueing is on
+    void                  dispatchSessionEvent(SessionEventFunction f, Connection* pConnection);
 
 	// TCP
 	virtual void          TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead);
 	virtual void          TCP_OnClosed(TCPSocket* pSocket);
 	virtual void          TCP_OnAccept(TCPSocket* pListener, SockAddr* pSockAddr, SocketHandle newSock);
 	virtual void          TCP_OnConnected(TCPSocket* pSocket);
+
+    // Shared memory
+    virtual void          SharedMemory_OnRecv(SharedMemoryChannel* pChannel, uint8_t* pData, int bytesRead);
+    virtual void          SharedMemory_OnBroken(SharedMemoryChannel* pChannel);
 };
 
 
@@ -0,0 +1,600 @@
+/************************************************************************************
+
+Filename    :   OVR_SharedMemoryChannel.cpp
+Content     :   Message channel between two processes on one machine, over shared-memory rings
+Created     :   October 19, 2026
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_SharedMemoryChannel.h"
+#include "OVR_Socket.h"
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_Timer.h"
+
+#if defined(OVR_OS_WIN32)
+#include <Sddl.h> // ConvertStringSecurityDescriptorToSecurityDescriptor
+#elif defined(OVR_OS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#if (defined(OVR_OS_LINUX) || defined(OVR_OS_MAC)) && !defined(OVR_FAKE_SHAREDMEMORY)
+#include <sys/mman.h> // shm_unlink()
+#include <unistd.h>   // getpid()
+#endif
+
+namespace OVR { namespace Net {
+
+
+//-----------------------------------------------------------------------------
+// Shared layout
+
+enum
+{
+    Direction_ToService = 0, // Client writes, service reads
+    Direction_ToClient  = 1, // Service writes, client reads
+
+    ChannelCacheLineSize = 64,
+    ChannelMagicValue    = 0x4F43484E, // 'OCHN'
+    ChannelVersion       = 1,
+
+    RecordSize           = 512,
+    RecordPayloadBytes   = RecordSize - 2 * sizeof(uint32_t),
+    RecordCapacity       = 512,
+    RecordFlag_Last      = 1,          // Final fragment of a message
+
+    ReaderSpinCount      = 2000,       // Empty polls before the reader sleeps on its doorbell, on multi-core machines
+    ReaderWaitMs         = 100,        // Longest sleep, so Close() is never stuck behind a lost wakeup
+    MaxBacklogBytes      = 2 * MaxMessageBytes // Records Send() may hold while the peer catches up
+};
+
+struct SharedMemoryDoorbell
+{
+    AtomicInt<uint32_t> Sequence; // Bumped by the writer after each record
+    AtomicInt<uint32_t> Sleeping; // Nonzero while the reader is about to sleep or asleep
+    uint8_t             Pad[ChannelCacheLineSize - 2 * sizeof(uint32_t)];
+};
+
+struct SharedMemoryChannelHeader
+{
+    // Written once by Create(). Magic is written last so Open() never sees a half-initialized header.
+    AtomicInt<uint32_t>  Magic;
+    uint32_t             Version;
+    uint8_t              Pad0[ChannelCacheLineSize - 2 * sizeof(uint32_t)];
+
+    SharedMemoryDoorbell Bells[2]; // By direction
+};
+
+struct SharedMemoryRecord
+{
+    uint32_t Bytes;  // Payload bytes in this fragment
+    uint32_t Flags;
+    uint8_t  Data[RecordPayloadBytes];
+};
+
+static const char* DirectionSuffix[2] = { "_c2s", "_s2c" };
+
+
+//-----------------------------------------------------------------------------
+// Doorbell wait and wake
+
+#if defined(OVR_OS_WIN32)
+
+static HANDLE CreateBellEvent(const String& name, bool create)
+{
+    if (!create)
+    {
+        return OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name.ToCStr());
+    }
+
+    // Same access as the shared memory: System, Administrators and Interactive Users (games)
+    SECURITY_ATTRIBUTES security;
+    ZeroMemory(&security, sizeof(security));
+    security.nLength = sizeof(security);
+
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA("D:P(A;OICI;GA;;;SY)(A;OICI;GA;;;BA)(A;OICI;GA;;;IU)",
+                                                              SDDL_REVISION_1, &security.lpSecurityDescriptor, NULL))
+    {
+        OVR_DEBUG_LOG(("[SharedMemoryChannel] FAILURE: Unable to convert access string, error code = %d", GetLastError()));
+        return NULL;
+    }
+
+    HANDLE hEvent = CreateEventA(&security, FALSE, FALSE, name.ToCStr());
+
+    LocalFree(security.lpSecurityDescriptor);
+    return hEvent;
+}
+
+#elif defined(OVR_OS_LINUX)
+
+// Not FUTEX_PRIVATE: the word lives in memory mapped by two processes
+static void FutexWait(volatile uint32_t* word, uint32_t expected, unsigned timeoutMs)
+{
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+static void FutexWake(volatile uint32_t* word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+#endif
+
+
+//-----------------------------------------------------------------------------
+// SharedMemoryChannel
+
+SharedMemoryChannel::SharedMemoryChannel() :
+    IsCreator(false),
+    pHeader(NULL),
+    pInboundBell(NULL),
+    pOutboundBell(NULL),
+    InboundDirection(0),
+    OutboundDirection(0),
+    BacklogHead(0),
+    BacklogMovedTime(0.),
+    BacklogBytes(0),
+    Stopping(0),
+    pHandler(NULL),
+    SpinCount(0)
+{
+#if defined(OVR_OS_WIN32)
+    BellEvents[0] = BellEvents[1] = NULL;
+#endif
+}
+
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    Close();
+}
+
+String SharedMemoryChannel::GenerateName()
+{
+    static AtomicInt<uint32_t> counter(0);
+
+#if defined(OVR_OS_WIN32)
+    const unsigned processId = (unsigned)GetCurrentProcessId();
+#elif !defined(OVR_FAKE_SHAREDMEMORY)
+    const unsigned processId = (unsigned)getpid();
+#else
+    const unsigned processId = 0;
+#endif
+
+    char name[64];
+    OVR_sprintf(name, sizeof(name), "OVRSessionChannel_%u_%u", processId, (unsigned)counter.ExchangeAdd_Sync(1));
+    return name;
+}
+
+bool SharedMemoryChannel::Create(const String& baseName)
+{
+    return attach(baseName, true);
+}
+
+bool SharedMemoryChannel::Open(const String& baseName)
+{
+    return attach(baseName, false);
+}
+
+bool SharedMemoryChannel::attach(const String& baseName, bool create)
+{
+    Close();
+
+    Lock::Locker locker(&CloseLock);
+
+    Name = baseName;
+    IsCreator = create;
+    Stopping.Store_Release(0);
+
+    SharedMemory::OpenParameters params;
+    String controlName = baseName + "_ctl";
+    params.globalName   = controlName.ToCStr();
+    params.minSizeBytes = (int)sizeof(SharedMemoryChannelHeader);
+    // Created afresh and private to this user: the name is predictable, so a region someone
+    // else made under it must not be used. Not ReadOnly: the client rings the service's doorbell.
+    params.openMode     = create ? SharedMemory::OpenMode_CreateOnly : SharedMemory::OpenMode_OpenOnly;
+    params.remoteMode   = SharedMemory::RemoteMode_Private;
+    params.accessMode   = SharedMemory::AccessMode_ReadWrite;
+
+    pControlMemory = SharedMemoryFactory::GetInstance()->Open(params);
+    if (!pControlMemory || !pControlMemory->GetData())
+    {
+        detach();
+        return false;
+    }
+
+    SharedMemoryChannelHeader* header = (SharedMemoryChannelHeader*)pControlMemory->GetData();
+
+    if (create)
+    {
+        header->Magic.Store_Release(0);
+        header->Version = ChannelVersion;
+        for (int i = 0; i < 2; ++i)
+        {
+            header->Bells[i].Sequence.Store_Release(0);
+            header->Bells[i].Sleeping.Store_Release(0);
+        }
+    }
+    else if (header->Magic.Load_Acquire() != ChannelMagicValue ||
+             header->Version != ChannelVersion)
+    {
+        OVR_DEBUG_LOG(("[SharedMemoryChannel] FAILURE: %s has an incompatible header", baseName.ToCStr()));
+        detach();
+        return false;
+    }
+
+    InboundDirection  = create ? Direction_ToService : Direction_ToClient;
+    OutboundDirection = create ? Direction_ToClient : Direction_ToService;
+
+    String inboundName  = baseName + DirectionSuffix[InboundDirection];
+    String outboundName = baseName + DirectionSuffix[OutboundDirection];
+
+    bool ringsOk;
+    if (create)
+    {
+        ringsOk = Inbound.Create(inboundName.ToCStr(), RecordSize, RecordCapacity,
+                                 SharedRingBuffer::SingleProducer, SharedRingBuffer::Overflow_Reject,
+                                 SharedMemory::RemoteMode_Private) &&
+                  Outbound.Create(outboundName.ToCStr(), RecordSize, RecordCapacity,
+                                  SharedRingBuffer::SingleProducer, SharedRingBuffer::Overflow_Reject,
+                                  SharedMemory::RemoteMode_Private);
+    }
+    else
+    {
+        ringsOk = Inbound.Open(inboundName.ToCStr(), RecordSize) &&
+                  Outbound.Open(outboundName.ToCStr(), RecordSize);
+    }
+
+#if defined(OVR_OS_WIN32)
+    for (int i = 0; i < 2 && ringsOk; ++i)
+    {
+        BellEvents[i] = CreateBellEvent(baseName + DirectionSuffix[i] + "_bell", create);
+        ringsOk = (BellEvents[i] != NULL);
+    }
+#endif
+
+    if (!ringsOk)
+    {
+        OVR_DEBUG_LOG(("[SharedMemoryChannel] FAILURE: Unable to %s %s", create ? "create" : "open", baseName.ToCStr()));
+        detach();
+        return false;
+    }
+
+    if (create)
+    {
+        header->Magic.Store_Release(ChannelMagicValue);
+    }
+
+    pHeader       = header;
+    pInboundBell  = &header->Bells[InboundDirection];
+    pOutboundBell = &header->Bells[OutboundDirection];
+    return true;
+}
+
+void SharedMemoryChannel::Close()
+{
+    Stopping.Store_Release(1);
+
+    Lock::Locker locker(&CloseLock);
+
+    if (pReaderThread)
+    {
+        // Wake the reader if it is asleep on its doorbell
+        if (pInboundBell)
+        {
+            ring(pInboundBell, InboundDirection);
+        }
+
+        if (pReaderThread->GetThreadId() != GetCurrentThreadId())
+        {
+            pReaderThread->Join();
+        }
+        pReaderThread = NULL;
+    }
+
+    // Wait for a sender that is still writing
+    Lock::Locker sendLocker(&SendLock);
+
+    detach();
+}
+
+void SharedMemoryChannel::detach()
+{
+    pHeader = NULL;
+    pInboundBell = NULL;
+    pOutboundBell = NULL;
+    Backlog.Clear();
+    BacklogHead = 0;
+    BacklogBytes.Store_Release(0);
+    Inbound.Close();
+    Outbound.Close();
+    pControlMemory.Clear();
+
+#if defined(OVR_OS_WIN32)
+    for (int i = 0; i < 2; ++i)
+    {
+        if (BellEvents[i])
+        {
+            CloseHandle(BellEvents[i]);
+            BellEvents[i] = NULL;
+        }
+    }
+#endif
+
+#if (defined(OVR_OS_LINUX) || defined(OVR_OS_MAC)) && !defined(OVR_FAKE_SHAREDMEMORY)
+    // The names would otherwise outlive both processes; mappings already open stay valid
+    if (IsCreator && !Name.IsEmpty())
+    {
+        shm_unlink((Name + "_ctl").ToCStr());
+        shm_unlink((Name + DirectionSuffix[0]).ToCStr());
+        shm_unlink((Name + DirectionSuffix[1]).ToCStr());
+    }
+#endif
+
+    IsCreator = false;
+}
+
+int SharedMemoryChannel::Send(const void* pData, int bytes)
+{
+    Lock::Locker locker(&SendLock);
+
+    if (!pHeader || Stopping.Load_Acquire() != 0 || bytes < 0 || bytes > MaxMessageBytes)
+    {
+        return -1;
+    }
+
+    // Older records go first
+    if (!flushBacklog())
+    {
+        return -1;
+    }
+
+    // Rejected whole, so the peer never sees part of a message.
+    // An empty backlog always has room for one message.
+    const int recordCount = (bytes + RecordPayloadBytes - 1) / RecordPayloadBytes;
+    if (BacklogBytes.Load_Acquire() + (recordCount > 0 ? recordCount : 1) * RecordSize > MaxBacklogBytes)
+    {
+        LogError("{ERR-101} [SharedMemoryChannel] Send failed: %s is too far behind", Name.ToCStr());
+        return -1;
+    }
+
+    const uint8_t* src = (const uint8_t*)pData;
+    int remaining = bytes;
+
+    SharedMemoryRecord record;
+    do
+    {
+        const int fragmentBytes = remaining < RecordPayloadBytes ? remaining : RecordPayloadBytes;
+        record.Bytes = (uint32_t)fragmentBytes;
+        record.Flags = (fragmentBytes == remaining) ? RecordFlag_Last : 0;
+        memcpy(record.Data, src, fragmentBytes);
+
+        // The ring rejects writes while full; keep the rest for Flush() instead of waiting
+        if (BacklogHead != Backlog.GetSize() || !Outbound.Write(&record))
+        {
+            if (BacklogHead == Backlog.GetSize())
+            {
+                BacklogMovedTime = Timer::GetSeconds();
+            }
+            Backlog.Append((const uint8_t*)&record, RecordSize);
+        }
+
+        src += fragmentBytes;
+        remaining -= fragmentBytes;
+    } while (remaining > 0);
+
+    BacklogBytes.Store_Release((int)(Backlog.GetSize() - BacklogHead));
+
+    ring(pOutboundBell, OutboundDirection);
+    return bytes;
+}
+
+bool SharedMemoryChannel::Flush()
+{
+    Lock::Locker locker(&SendLock);
+
+    if (!pHeader || Stopping.Load_Acquire() != 0)
+    {
+        return false;
+    }
+
+    return flushBacklog();
+}
+
+bool SharedMemoryChannel::flushBacklog()
+{
+    const size_t size = Backlog.GetSize();
+    size_t head = BacklogHead;
+    if (head == size)
+    {
+        return true;
+    }
+
+    while (head < size && Outbound.Write(&Backlog[head]))
+    {
+        head += RecordSize;
+    }
+
+    const double now = Timer::GetSeconds();
+    if (head != BacklogHead)
+    {
+        BacklogMovedTime = now;
+        ring(pOutboundBell, OutboundDirection);
+    }
+    else if (now - BacklogMovedTime > SendTimeoutMs * 0.001)
+    {
+        LogError("{ERR-101} [SharedMemoryChannel] Send timed out: %s is not reading", Name.ToCStr());
+        return false;
+    }
+
+    if (head == size)
+    {
+        Backlog.Clear();
+        head = 0;
+    }
+    else if (head >= size / 2)
+    {
+        // Drop the sent half so the backlog does not grow without bound while it drains
+        Backlog.RemoveMultipleAt(0, head);
+        head = 0;
+    }
+
+    BacklogHead = head;
+    BacklogBytes.Store_Release((int)(Backlog.GetSize() - head));
+    return true;
+}
+
+void SharedMemoryChannel::ring(SharedMemoryDoorbell* bell, int direction)
+{
+    // The full barrier orders the ring write before the Sleeping check; the
+    // reader orders its Sleeping store before its last look at the ring.
+    bell->Sequence.ExchangeAdd_Sync(1);
+
+    if (bell->Sleeping.Load_Acquire() != 0)
+    {
+#if defined(OVR_OS_WIN32)
+        SetEvent(BellEvents[direction]);
+#elif defined(OVR_OS_LINUX)
+        OVR_UNUSED(direction);
+        FutexWake(&bell->Sequence.Value);
+#else
+        OVR_UNUSED(direction);
+#endif
+    }
+}
+
+// Returns true if there is data to read
+bool SharedMemoryChannel::waitForData()
+{
+    for (int i = 0; i < SpinCount; ++i)
+    {
+        if (Inbound.GetPendingCount() > 0)
+        {
+            return true;
+        }
+    }
+
+    const uint32_t sequence = pInboundBell->Sequence.Load_Acquire();
+    pInboundBell->Sleeping.Exchange_Sync(1);
+
+    if (Inbound.GetPendingCount() <= 0 && Stopping.Load_Acquire() == 0)
+    {
+#if defined(OVR_OS_WIN32)
+        OVR_UNUSED(sequence);
+        WaitForSingleObject(BellEvents[InboundDirection], ReaderWaitMs);
+#elif defined(OVR_OS_LINUX)
+        FutexWait(&pInboundBell->Sequence.Value, sequence, ReaderWaitMs);
+#else
+        OVR_UNUSED(sequence);
+        Thread::MSleep(1);
+#endif
+    }
+
+    pInboundBell->Sleeping.Store_Release(0);
+
+    return Inbound.GetPendingCount() > 0;
+}
+
+bool SharedMemoryChannel::StartReceiving(SharedMemoryChannelEvents* handler)
+{
+    Lock::Locker locker(&CloseLock);
+
+    if (!pHeader || pReaderThread)
+    {
+        return false;
+    }
+
+    pHandler = handler;
+
+    // With one core, spinning only delays the writer we are waiting for
+    SpinCount = (Thread::GetCPUCount() > 1) ? ReaderSpinCount : 0;
+
+    pReaderThread = *new Thread(readerThreadFunction, this);
+    if (!pReaderThread || !pReaderThread->Start())
+    {
+        pReaderThread = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+int SharedMemoryChannel::readerThreadFunction(Thread* pthread, void* h)
+{
+    SharedMemoryChannel* channel = (SharedMemoryChannel*)h;
+
+    pthread->SetThreadName("NetSessionSHM");
+
+    SharedMemoryRecord record;
+    while (channel->Stopping.Load_Acquire() == 0)
+    {
+        if (!channel->Inbound.Read(&record))
+        {
+            channel->waitForData();
+            continue;
+        }
+
+        const int fragmentBytes = (record.Bytes <= sizeof(record.Data)) ? (int)record.Bytes : (int)sizeof(record.Data);
+        const bool last = (record.Flags & RecordFlag_Last) != 0;
+
+        ArrayPOD< uint8_t, ArrayConstPolicy<0, 4096, true> >& message = channel->Reassembly;
+
+        // Most messages fit one record and are delivered straight from it
+        if (last && message.GetSize() == 0)
+        {
+            channel->pHandler->SharedMemory_OnRecv(channel, record.Data, fragmentBytes);
+            continue;
+        }
+
+        const size_t oldSize = message.GetSize();
+
+        // A peer that never ends its message would otherwise grow the buffer without bound
+        if (oldSize + fragmentBytes > (size_t)MaxMessageBytes)
+        {
+            LogError("{ERR-105} [SharedMemoryChannel] Closing %s: incoming message is over the %d byte limit.",
+                     channel->Name.ToCStr(), MaxMessageBytes);
+
+            // Stop here; Close() from the owner joins this thread and detaches
+            channel->Stopping.Store_Release(1);
+            message.ClearAndRelease();
+            channel->pHandler->SharedMemory_OnBroken(channel);
+            break;
+        }
+
+        message.Resize(oldSize + fragmentBytes);
+        memcpy(&message[oldSize], record.Data, fragmentBytes);
+
+        if (last)
+        {
+            channel->pHandler->SharedMemory_OnRecv(channel, &message[0], (int)message.GetSize());
+            message.Clear();
+        }
+    }
+
+    return 0;
+}
+
+
+}} // OVR::Net
@@ -0,0 +1,166 @@
+/************************************************************************************
+
+PublicHeader:   n/a
+Filename    :   OVR_SharedMemoryChannel.h
+Content     :   Message channel between two processes on one machine, over shared-memory rings
+Created     :   October 19, 2026
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_SharedMemoryChannel_h
+#define OVR_SharedMemoryChannel_h
+
+#include "../Kernel/OVR_SharedMemory.h"
+#include "../Kernel/OVR_Threads.h"
+#include "../Kernel/OVR_Atomic.h"
+#include "../Kernel/OVR_Array.h"
+#include "../Kernel/OVR_String.h"
+
+namespace OVR { namespace Net {
+
+class SharedMemoryChannel;
+struct SharedMemoryChannelHeader;
+struct SharedMemoryDoorbell;
+
+
+//-----------------------------------------------------------------------------
+// SharedMemoryChannelEvents
+
+// Callback interface for messages arriving on a SharedMemoryChannel.
+// Called on the channel's reader thread.
+class SharedMemoryChannelEvents
+{
+public:
+    virtual ~SharedMemoryChannelEvents() {}
+
+    virtual void SharedMemory_OnRecv(SharedMemoryChannel* pChannel, uint8_t* pData, int bytesRead) = 0;
+
+    // The peer sent a message over MaxMessageBytes. The channel has stopped receiving
+    // and rejects Send(); the owner should drop the connection and Close() it.
+    virtual void SharedMemory_OnBroken(SharedMemoryChannel* pChannel) = 0;
+};
+
+
+//-----------------------------------------------------------------------------
+// SharedMemoryChannel
+
+// Message-framed, two-way channel between the service and one local client.
+//
+// Each direction is a SharedRingBuffer of fixed-size records. Messages larger than
+// one record are split into fragments and put back together by the reader, so the
+// caller sees the same framing as a PacketizedTCPSocket.
+//
+// The reader thread spins briefly when its ring runs dry, then sleeps on a doorbell:
+// a sequence number in a small control region, paired with a futex on Linux and a
+// named event on Windows (other platforms poll). Writers only pay for the wakeup
+// when the reader is actually asleep.
+//
+// The service creates the channel (creating shared memory may need privileges the
+// client does not have) and the client opens it by name.
+class SharedMemoryChannel : public RefCountBase<SharedMemoryChannel>
+{
+public:
+    SharedMemoryChannel();
+    ~SharedMemoryChannel();
+
+    // Service side: creates the rings and doorbells under baseName.
+    bool Create(const String& baseName);
+
+    // Client side: attaches to a channel created by the service.
+    bool Open(const String& baseName);
+
+    // Stops the reader thread, waiting for it unless called from it, and detaches.
+    // Pending and later Send() calls fail.
+    void Close();
+
+    bool IsOpen() const
+    {
+        return pHeader != NULL;
+    }
+    const String& GetName() const
+    {
+        return Name;
+    }
+
+    // Writes one message of up to MaxMessageBytes without waiting. Records that do not fit
+    // in the ring go to a backlog, which Send() and Flush() move into the ring as the peer reads.
+    // Returns bytes, or -1 if the channel is closed, the backlog would pass twice
+    // MaxMessageBytes, or the peer has not read anything for SendTimeoutMs.
+    int  Send(const void* pData, int bytes);
+
+    // Moves backlogged records into the ring. Returns false on the same failures as Send().
+    bool Flush();
+
+    bool HasBacklog() const
+    {
+        return BacklogBytes.Load_Acquire() != 0;
+    }
+
+    // Starts the thread that delivers incoming messages to handler.
+    bool StartReceiving(SharedMemoryChannelEvents* handler);
+
+    // Returns a name that is unique on this machine for the life of the process.
+    static String GenerateName();
+
+protected:
+    static const unsigned SendTimeoutMs = 5000;
+
+    bool attach(const String& baseName, bool create);
+    bool flushBacklog(); // Call with SendLock held
+    void detach();
+    bool waitForData();
+    void ring(SharedMemoryDoorbell* bell, int direction);
+    static int readerThreadFunction(Thread* pthread, void* h);
+
+    String                     Name;
+    bool                       IsCreator;
+
+    Ptr<SharedMemory>          pControlMemory;
+    SharedMemoryChannelHeader* pHeader;
+    SharedMemoryDoorbell*      pInboundBell;  // Rung by the peer when it writes to Inbound
+    SharedMemoryDoorbell*      pOutboundBell; // Rung by Send()
+    int                        InboundDirection, OutboundDirection;
+    SharedRingBuffer           Inbound, Outbound;
+
+#if defined(OVR_OS_WIN32)
+    void*                      BellEvents[2]; // Event HANDLE per direction
+#endif
+
+    Lock                       SendLock;      // Serializes Send(), which makes Outbound single-producer, against Close()
+    ArrayPOD<uint8_t>          Backlog;       // Whole records waiting for room in Outbound, oldest at BacklogHead; SendLock
+    size_t                     BacklogHead;
+    double                     BacklogMovedTime; // When the backlog last drained into Outbound
+    AtomicInt<int>             BacklogBytes;  // Records still in Backlog, in bytes; readable without SendLock
+    Lock                       CloseLock;
+    AtomicInt<int>             Stopping;
+    Ptr<Thread>                pReaderThread;
+    SharedMemoryChannelEvents* pHandler;
+    int                        SpinCount;     // Empty polls before sleeping on the doorbell
+    ArrayPOD< uint8_t, ArrayConstPolicy<0, 4096, true> > Reassembly; // Fragments of the incoming message so far; reader thread only
+
+private:
+    OVR_NON_COPYABLE(SharedMemoryChannel);
+};
+
+
+}} // OVR::Net
+
+#endif // OVR_SharedMemoryChannel_h
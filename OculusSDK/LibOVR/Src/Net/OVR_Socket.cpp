@@ -44,7 +44,8 @@ Socket::Socket() :
 BerkleyBindParameters::BerkleyBindParameters() :
 	Port(0),
     Address(),
-    blockingTimeout(0x7fffffff)
+    blockingTimeout(0x7fffffff),
+    LocalPath()
 {
 }
 
@@ -75,9 +75,14 @@ enum TransportType
 	TransportType_Loopback,      // Loopback transport: Class talks to itself
 	TransportType_TCP,           // TCP/IPv4/v6
 	TransportType_UDP,           // UDP/IPv4/v6
-	TransportType_PacketizedTCP  // Packetized TCP: Message framing is automatic
+	TransportType_PacketizedTCP, // Packetized TCP: Message framing is automatic
+	TransportType_SharedMemory   // Shared-memory rings to a local peer, set up over a packetized TCP connection
 };
 
+// Largest message the message-framed transports will send or accept.
+// A peer announcing a larger one is treated as broken and disconnected.
+static const int MaxMessageBytes = 16 * 1024 * 1024;
+
 
 //-----------------------------------------------------------------------------
 // Abstraction for a network socket. Inheritance hierarchy
@@ -105,6 +110,12 @@ public:
 	uint16_t Port;     // Port
 	String Address;
     uint32_t blockingTimeout;
+
+    // Unix only: if set, Bind() makes an AF_UNIX stream socket instead, and Port and
+    // Address are ignored. A socket that then listens is bound to this path; one that
+    // connects goes to the server listening on it, ignoring the remote SockAddr.
+    // Saves the loopback TCP overhead for clients on the same machine.
+    String LocalPath;
 };
 
 
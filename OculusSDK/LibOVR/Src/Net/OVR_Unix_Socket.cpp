@@ -0,0 +1,1052 @@
+/************************************************************************************
+
+Filename    :   OVR_Unix_Socket.cpp
+Content     :   Berkeley-socket networking implementation for Linux and other Unix systems
+Created     :   June 10, 2014
+Authors     :   Kevin Jenkins
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_Unix_Socket.h"
+#include "../Kernel/OVR_Std.h"
+#include "../Kernel/OVR_Allocator.h"
+#include "../Kernel/OVR_Threads.h" // Thread::MSleep
+#include "../Kernel/OVR_Log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+
+namespace OVR { namespace Net {
+
+
+//-----------------------------------------------------------------------------
+// BerkleySocket
+
+void BerkleySocket::Close()
+{
+	if (TheSocket != INVALID_SOCKET)
+	{
+		close(TheSocket);
+		TheSocket = INVALID_SOCKET;
+	}
+}
+
+int32_t BerkleySocket::GetSockname(SockAddr *pSockAddrOut)
+{
+	struct sockaddr_in6 sa;
+	memset(&sa,0,sizeof(sa));
+	socklen_t size = sizeof(sa);
+	int32_t i = getsockname(TheSocket, (sockaddr*) &sa, &size);
+	if (i>=0)
+	{
+		pSockAddrOut->Set(&sa);
+	}
+	return i;
+}
+
+
+//-----------------------------------------------------------------------------
+// BitStream overloads for SockAddr
+
+BitStream& operator<<(BitStream& out, SockAddr& in)
+{
+	out.WriteBits((const unsigned char*) &in.Addr6, sizeof(in.Addr6)*8, true);
+	return out;
+}
+
+BitStream& operator>>(BitStream& in, SockAddr& out)
+{
+	bool success = in.ReadBits((unsigned char*) &out.Addr6, sizeof(out.Addr6)*8, true);
+	OVR_ASSERT(success);
+	OVR_UNUSED(success);
+	return in;
+}
+
+
+//-----------------------------------------------------------------------------
+// SockAddr
+
+SockAddr::SockAddr()
+{
+    // Zero out the address to squelch static analysis tools
+    memset(&Addr6, 0, sizeof(Addr6));
+}
+
+SockAddr::SockAddr(SockAddr* address)
+{
+	Set(&address->Addr6);
+}
+
+SockAddr::SockAddr(sockaddr_storage* storage)
+{
+	Set(storage);
+}
+
+SockAddr::SockAddr(sockaddr_in6* address)
+{
+	Set(address);
+}
+
+SockAddr::SockAddr(const char* hostAddress, uint16_t port, int sockType)
+{
+	Set(hostAddress, port, sockType);
+}
+
+void SockAddr::Set(const sockaddr_storage* storage)
+{
+	memcpy(&Addr6, storage, sizeof(Addr6));
+}
+
+void SockAddr::Set(const sockaddr_in6* address)
+{
+	memcpy(&Addr6, address, sizeof(Addr6));
+}
+
+void SockAddr::Set(const char* hostAddress, uint16_t port, int sockType)
+{
+	memset(&Addr6, 0, sizeof(Addr6));
+
+	struct addrinfo hints;
+
+	// make sure the struct is empty
+	memset(&hints, 0, sizeof (addrinfo));
+
+	hints.ai_socktype = sockType; // SOCK_DGRAM or SOCK_STREAM
+	hints.ai_flags = AI_PASSIVE;     // fill in my IP for me
+	hints.ai_family = AF_INET6;
+	hints.ai_protocol = (sockType == SOCK_DGRAM) ? IPPROTO_UDP : IPPROTO_TCP;
+
+    struct addrinfo* servinfo = NULL;  // will point to the results
+
+	char portStr[32];
+	OVR_itoa(port, portStr, sizeof(portStr), 10);
+	int errcode = getaddrinfo(hostAddress, portStr, &hints, &servinfo);
+
+    if (0 != errcode)
+    {
+        OVR::LogError("{ERR-008u} getaddrinfo error: %s", gai_strerror(errcode));
+    }
+
+    OVR_ASSERT(servinfo);
+
+    if (servinfo)
+    {
+        memcpy(&Addr6, servinfo->ai_addr, sizeof(Addr6));
+
+        freeaddrinfo(servinfo);
+    }
+}
+
+uint16_t SockAddr::GetPort()
+{
+	return htons(Addr6.sin6_port);
+}
+
+String SockAddr::ToString(bool writePort, char portDelineator) const
+{
+    char dest[INET6_ADDRSTRLEN + 1];
+
+	int ret = getnameinfo((struct sockaddr*)&Addr6,
+						  sizeof(struct sockaddr_in6),
+						  dest,
+						  INET6_ADDRSTRLEN,
+						  NULL,
+						  0,
+						  NI_NUMERICHOST);
+	if (ret != 0)
+	{
+		dest[0] = '\0';
+	}
+
+	if (writePort)
+	{
+		unsigned char ch[2];
+		ch[0]=portDelineator;
+		ch[1]=0;
+		OVR_strcat(dest, 16, (const char*) ch);
+		OVR_itoa(ntohs(Addr6.sin6_port), dest+strlen(dest), 16, 10);
+	}
+
+    return String(dest);
+}
+bool SockAddr::IsLocalhost() const
+{
+    static const unsigned char localhost_bytes[] =
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+
+    return memcmp(Addr6.sin6_addr.s6_addr, localhost_bytes, 16) == 0;
+}
+bool SockAddr::operator==( const SockAddr& right ) const
+{
+	return memcmp(&Addr6, &right.Addr6, sizeof(Addr6)) == 0;
+}
+
+bool SockAddr::operator!=( const SockAddr& right ) const
+{
+	return !(*this == right);
+}
+
+bool SockAddr::operator>( const SockAddr& right ) const
+{
+	return memcmp(&Addr6, &right.Addr6, sizeof(Addr6)) > 0;
+}
+
+bool SockAddr::operator<( const SockAddr& right ) const
+{
+	return memcmp(&Addr6, &right.Addr6, sizeof(Addr6)) < 0;
+}
+
+static bool SetSocketOptions(SocketHandle sock)
+{
+    int result = 0;
+	int sock_opt;
+
+	// This doubles the max throughput rate
+    sock_opt = 1024 * 256;
+    result |= setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char *)& sock_opt, sizeof (sock_opt));
+
+	// Immediate hard close. Don't linger the socket.
+    struct linger linger_opt;
+    linger_opt.l_onoff = 0;
+    linger_opt.l_linger = 0;
+    result |= setsockopt(sock, SOL_SOCKET, SO_LINGER, (char *)& linger_opt, sizeof (linger_opt));
+
+	// This doesn't make much difference: 10% maybe
+    sock_opt = 1024 * 16;
+    result |= setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char *)& sock_opt, sizeof (sock_opt));
+
+    // Send small messages at once instead of holding them back until the previous one
+    // is acknowledged, which costs a delayed-ACK timeout (~40ms) when a signal follows a call.
+    // Local (AF_UNIX) sockets have no Nagle algorithm and reject the option.
+    sock_opt = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char *)& sock_opt, sizeof (sock_opt));
+
+#ifdef SO_NOSIGPIPE
+    // Report a closed peer as EPIPE rather than raising SIGPIPE
+    sock_opt = 1;
+    result |= setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, (char *)& sock_opt, sizeof (sock_opt));
+#endif
+
+    // If all the setsockopt() returned 0 there were no failures, so return true for success, else false
+    return result == 0;
+}
+
+static void SetNonBlocking(SocketHandle sock, bool nonblocking)
+{
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags != -1)
+    {
+        fcntl(sock, F_SETFL, nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+    }
+}
+
+static SocketHandle BindShared(int ai_family, int ai_socktype, BerkleyBindParameters* pBindParameters)
+{
+	SocketHandle sock;
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof (addrinfo)); // make sure the struct is empty
+	hints.ai_family = ai_family;
+	hints.ai_socktype = ai_socktype;
+	hints.ai_flags = AI_PASSIVE;     // fill in my IP for me
+	struct addrinfo *servinfo=0, *aip;  // will point to the results
+	char portStr[32];
+	OVR_itoa(pBindParameters->Port, portStr, sizeof(portStr), 10);
+
+    int errcode = 0;
+	if (!pBindParameters->Address.IsEmpty())
+		errcode = getaddrinfo(pBindParameters->Address.ToCStr(), portStr, &hints, &servinfo);
+	else
+		errcode = getaddrinfo(0, portStr, &hints, &servinfo);
+
+    if (0 != errcode)
+    {
+        OVR::LogError("{ERR-020u} getaddrinfo error: %s", gai_strerror(errcode));
+    }
+
+	for (aip = servinfo; aip != NULL; aip = aip->ai_next)
+	{
+		// Open socket. The address type depends on what
+		// getaddrinfo() gave us.
+		sock = socket(aip->ai_family, aip->ai_socktype, aip->ai_protocol);
+        if (sock != INVALID_SOCKET)
+		{
+            // Allow the service to rebind its port while old connections sit in TIME_WAIT
+            if (pBindParameters->Port != 0)
+            {
+                int reuse = 1;
+                setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char *)& reuse, sizeof (reuse));
+            }
+
+            if (bind(sock, aip->ai_addr, (socklen_t)aip->ai_addrlen) != SOCKET_ERROR)
+			{
+				// The actual socket is always non-blocking
+				// Blocking is controlled by the poll timeout
+				SetNonBlocking(sock, true);
+                freeaddrinfo(servinfo);
+				return sock;
+			}
+
+            close(sock);
+        }
+	}
+
+    if (servinfo) { freeaddrinfo(servinfo); }
+	return INVALID_SOCKET;
+}
+
+// Fills in an AF_UNIX address; fails if the path does not fit
+static bool SetLocalAddress(sockaddr_un* addr, const String& path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+
+    if (path.GetSize() >= sizeof(addr->sun_path))
+    {
+        OVR::LogError("{ERR-021u} Local socket path is too long: %s", path.ToCStr());
+        return false;
+    }
+
+    memcpy(addr->sun_path, path.ToCStr(), path.GetSize() + 1);
+    return true;
+}
+
+// Makes way for a server to bind a local socket at addr. A socket file left behind by a
+// server that did not shut down cleanly is removed, but only once connecting to it has
+// been refused: a live server, or a file that is not a socket, is left alone.
+static bool RemoveStaleLocalSocket(const sockaddr_un& addr)
+{
+    struct stat st;
+    if (lstat(addr.sun_path, &st) < 0)
+    {
+        return errno == ENOENT;
+    }
+
+    if (!S_ISSOCK(st.st_mode))
+    {
+        OVR::LogError("{ERR-023u} Not replacing %s with a local socket: it is not a socket", addr.sun_path);
+        return false;
+    }
+
+    SocketHandle probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    int result = connect(probe, (sockaddr*)&addr, sizeof(addr));
+    int errsv = errno;
+    close(probe);
+
+    if (result < 0 && errsv == ECONNREFUSED)
+    {
+        unlink(addr.sun_path);
+        return true;
+    }
+
+    OVR::LogError("{ERR-024u} Local socket %s is in use by another server", addr.sun_path);
+    return false;
+}
+
+// Waits until the socket can take more data, up to the given timeout
+static bool WaitWritable(SocketHandle sock, int timeoutMs)
+{
+    pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    int result;
+    while ((result = poll(&pfd, 1, timeoutMs)) < 0 && errno == EINTR)
+    {
+    }
+
+    return result > 0 && (pfd.revents & POLLOUT) != 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// UDPSocket
+
+UDPSocket::UDPSocket()
+{
+	RecvBuf = new uint8_t[RecvBufSize];
+}
+
+UDPSocket::~UDPSocket()
+{
+	delete[] RecvBuf;
+}
+
+SocketHandle UDPSocket::Bind(BerkleyBindParameters *pBindParameters)
+{
+	SocketHandle s = BindShared(AF_INET6, SOCK_DGRAM, pBindParameters);
+	if (s == INVALID_SOCKET)
+		return s;
+
+	Close();
+	TheSocket = s;
+	SetSocketOptions(TheSocket);
+
+	return TheSocket;
+}
+
+void UDPSocket::OnRecv(SocketEvent_UDP* eventHandler, uint8_t* pData, int bytesRead, SockAddr* address)
+{
+	eventHandler->UDP_OnRecv(this, pData, bytesRead, address);
+}
+
+int UDPSocket::Send(const void* pData, int bytes, SockAddr* address)
+{
+	return (int)sendto(TheSocket, (const char*)pData, bytes, 0, (const sockaddr*)&address->Addr6, sizeof(address->Addr6));
+}
+
+void UDPSocket::Poll(SocketEvent_UDP *eventHandler)
+{
+	struct sockaddr_storage unix_addr;
+	socklen_t fromlen;
+	int bytesRead;
+
+    // FIXME: Implement blocking poll wait for UDP
+
+	// While some bytes are read,
+	while (fromlen = sizeof(unix_addr), // Must set fromlen each time
+		   bytesRead = (int)recvfrom(TheSocket, (char*)RecvBuf, RecvBufSize, 0, (sockaddr*)&unix_addr, &fromlen),
+		   bytesRead > 0)
+	{
+		SockAddr address(&unix_addr); // Wrap address
+
+		OnRecv(eventHandler, RecvBuf, bytesRead, &address);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// TCPSocket
+
+TCPSocket::TCPSocket()
+{
+	IsConnecting = false;
+	IsListenSocket = false;
+	LocalPathDevice = 0;
+	LocalPathInode = 0;
+}
+TCPSocket::TCPSocket(SocketHandle boundHandle, bool isListenSocket)
+{
+	TheSocket = boundHandle;
+	IsListenSocket = isListenSocket;
+	IsConnecting = false;
+	LocalPathDevice = 0;
+	LocalPathInode = 0;
+	SetSocketOptions(TheSocket);
+
+	// The actual socket is always non-blocking
+	SetNonBlocking(TheSocket, true);
+}
+
+TCPSocket::~TCPSocket()
+{
+    // Here rather than in ~BerkleySocket, so a listening local socket removes its path
+    Close();
+}
+
+void TCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead)
+{
+	eventHandler->TCP_OnRecv(this, pData, bytesRead);
+}
+
+SocketHandle TCPSocket::Bind(BerkleyBindParameters* pBindParameters)
+{
+	SocketHandle s;
+
+    if (!pBindParameters->LocalPath.IsEmpty())
+    {
+        // The path is only bound by Listen(), since a connecting socket must not take it
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s != INVALID_SOCKET)
+        {
+            SetNonBlocking(s, true);
+        }
+    }
+    else
+    {
+        s = BindShared(AF_INET6, SOCK_STREAM, pBindParameters);
+    }
+
+	if (s == INVALID_SOCKET)
+		return s;
+
+	Close();
+
+    SetBlockingTimeout(pBindParameters->blockingTimeout);
+    TheSocket = s;
+    LocalPath = pBindParameters->LocalPath;
+
+    SetSocketOptions(TheSocket);
+
+	return TheSocket;
+}
+
+int TCPSocket::Listen()
+{
+    if (IsListenSocket)
+    {
+        return 0;
+    }
+
+    if (!LocalPath.IsEmpty())
+    {
+        sockaddr_un addr;
+        if (!SetLocalAddress(&addr, LocalPath))
+        {
+            return -1;
+        }
+
+        if (!RemoveStaleLocalSocket(addr))
+        {
+            return -1;
+        }
+
+        if (bind(TheSocket, (sockaddr*)&addr, sizeof(addr)) < 0)
+        {
+            OVR::LogError("{ERR-022u} Unable to bind local socket %s: %d", LocalPath.ToCStr(), errno);
+            return -1;
+        }
+
+        struct stat st;
+        if (lstat(addr.sun_path, &st) == 0)
+        {
+            LocalPathDevice = st.st_dev;
+            LocalPathInode  = st.st_ino;
+        }
+    }
+
+	int i = listen(TheSocket, SOMAXCONN);
+	if (i >= 0)
+	{
+		IsListenSocket = true;
+	}
+
+	return i;
+}
+
+int TCPSocket::Connect(SockAddr* address)
+{
+	int retval;
+
+    if (!LocalPath.IsEmpty())
+    {
+        // Local sockets connect at once, or fail with EAGAIN when the backlog is full
+        sockaddr_un addr;
+        if (!SetLocalAddress(&addr, LocalPath))
+        {
+            return -1;
+        }
+
+        retval = connect(TheSocket, (sockaddr*)&addr, sizeof(addr));
+    }
+    else
+    {
+        retval = connect(TheSocket, (struct sockaddr *) &address->Addr6, sizeof(address->Addr6));
+    }
+
+	if (retval < 0)
+	{
+		int errsv = errno;
+		if (errsv == EINPROGRESS)
+		{
+            IsConnecting = true;
+            return 0;
+		}
+
+		OVR::LogText("TCPSocket::Connect failed:Error code - %d\n", errsv);
+	}
+	else
+	{
+		// Connected immediately (loopback); report it from the next poll like any other connection
+		IsConnecting = true;
+	}
+
+	return retval;
+}
+
+void TCPSocket::Close()
+{
+    // A listening local socket owns the file at its path, unless another server has
+    // replaced it since
+    if (IsListenSocket && !LocalPath.IsEmpty() && TheSocket != INVALID_SOCKET)
+    {
+        struct stat st;
+        if (lstat(LocalPath.ToCStr(), &st) == 0 &&
+            st.st_dev == LocalPathDevice && st.st_ino == LocalPathInode)
+        {
+            unlink(LocalPath.ToCStr());
+        }
+    }
+
+    BerkleySocket::Close();
+}
+
+int TCPSocket::Send(const void* pData, int bytes)
+{
+	if (bytes <= 0)
+	{
+		return 0;
+	}
+	else
+	{
+		return SendVectored(&pData, &bytes, 1);
+	}
+}
+
+int TCPSocket::SendVectored(const void** pDataArray, const int* dataLengthArray, int arrayCount)
+{
+    static const int MaxBuffers = 16; // Well under IOV_MAX everywhere
+
+    int totalSent = 0;
+    int timeoutMs = TimeoutSec * 1000 + TimeoutUsec / 1000;
+
+    // Each group of up to MaxBuffers buffers goes out in one system call, unless the
+    // socket buffer fills up, in which case the rest follows as soon as there is room.
+    for (int first = 0; first < arrayCount; first += MaxBuffers)
+    {
+        iovec iov[MaxBuffers];
+        int   iovCount = 0;
+
+        for (int i = first; i < arrayCount && iovCount < MaxBuffers; ++i)
+        {
+            if (dataLengthArray[i] > 0)
+            {
+                iov[iovCount].iov_base = (void*)pDataArray[i];
+                iov[iovCount].iov_len  = (size_t)dataLengthArray[i];
+                ++iovCount;
+            }
+        }
+
+        iovec* pIov = iov;
+        while (iovCount > 0)
+        {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov    = pIov;
+            msg.msg_iovlen = iovCount;
+
+#ifdef MSG_NOSIGNAL
+            ssize_t sent = sendmsg(TheSocket, &msg, MSG_NOSIGNAL);
+#else
+            ssize_t sent = sendmsg(TheSocket, &msg, 0);
+#endif
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && WaitWritable(TheSocket, timeoutMs))
+                {
+                    continue;
+                }
+                return totalSent > 0 ? totalSent : -1;
+            }
+
+            totalSent += (int)sent;
+
+            // Skip past what was written
+            while (iovCount > 0 && (size_t)sent >= pIov->iov_len)
+            {
+                sent -= pIov->iov_len;
+                ++pIov;
+                --iovCount;
+            }
+            if (iovCount > 0)
+            {
+                pIov->iov_base = (char*)pIov->iov_base + sent;
+                pIov->iov_len -= sent;
+            }
+        }
+    }
+
+    return totalSent;
+}
+
+
+//// TCPSocketPollState
+
+#if defined(OVR_OS_LINUX)
+
+TCPSocketPollState::TCPSocketPollState() :
+    ReadyCount(0),
+    ListenersArmed(true)
+{
+    EpollHandle = epoll_create1(EPOLL_CLOEXEC);
+    OVR_ASSERT(EpollHandle != INVALID_SOCKET);
+}
+
+TCPSocketPollState::~TCPSocketPollState()
+{
+    if (EpollHandle != INVALID_SOCKET)
+    {
+        close(EpollHandle);
+    }
+}
+
+// Adds the handle to the epoll set, or updates the events it waits for
+static bool ArmSocket(SocketHandle epollHandle, TCPSocket* tcpSocket)
+{
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    if (tcpSocket->IsConnecting)
+    {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.ptr = tcpSocket;
+
+    SocketHandle handle = tcpSocket->GetSocketHandle();
+    if (epoll_ctl(epollHandle, EPOLL_CTL_ADD, handle, &ev) == 0)
+    {
+        return true;
+    }
+    return errno == EEXIST && epoll_ctl(epollHandle, EPOLL_CTL_MOD, handle, &ev) == 0;
+}
+
+bool TCPSocketPollState::Add(TCPSocket* tcpSocket)
+{
+    if (!tcpSocket || tcpSocket->GetSocketHandle() == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    Lock::Locker locker(&SocketsLock);
+
+    // Listen sockets are level-triggered: left in the set while they are not handled,
+    // a pending connection would wake every Poll()
+    if (ListenersArmed || !tcpSocket->IsListenSocket)
+    {
+        if (!ArmSocket(EpollHandle, tcpSocket))
+        {
+            OVR::LogError("{ERR-025u} [Socket] Unable to poll socket %d: %d", tcpSocket->GetSocketHandle(), errno);
+            return false;
+        }
+    }
+
+    Sockets.Set(tcpSocket, tcpSocket);
+    return true;
+}
+
+void TCPSocketPollState::Remove(TCPSocket* tcpSocket)
+{
+    if (!tcpSocket)
+    {
+        return;
+    }
+
+    Lock::Locker locker(&SocketsLock);
+
+    if (!Sockets.Get(tcpSocket))
+    {
+        return;
+    }
+
+    // A closed handle has left the epoll set already
+    SocketHandle handle = tcpSocket->GetSocketHandle();
+    if (handle != INVALID_SOCKET)
+    {
+        epoll_ctl(EpollHandle, EPOLL_CTL_DEL, handle, NULL);
+    }
+
+    Sockets.Remove(tcpSocket);
+}
+
+bool TCPSocketPollState::Poll(long usec, long seconds, bool listeners)
+{
+    if (listeners != ListenersArmed)
+    {
+        Lock::Locker locker(&SocketsLock);
+
+        for (Hash< TCPSocket*, Ptr<TCPSocket> >::Iterator it = Sockets.Begin(); it != Sockets.End(); ++it)
+        {
+            TCPSocket*   tcpSocket = it->Second;
+            SocketHandle handle    = tcpSocket->GetSocketHandle();
+            if (!tcpSocket->IsListenSocket || handle == INVALID_SOCKET)
+            {
+                continue;
+            }
+
+            if (listeners)
+            {
+                ArmSocket(EpollHandle, tcpSocket);
+            }
+            else
+            {
+                epoll_ctl(EpollHandle, EPOLL_CTL_DEL, handle, NULL);
+            }
+        }
+
+        ListenersArmed = listeners;
+    }
+
+    int timeoutMs = (int)(seconds * 1000 + (usec + 999) / 1000);
+
+    ReadyCount = epoll_wait(EpollHandle, ReadyEvents, MaxReadyEvents, timeoutMs);
+    if (ReadyCount < 0)
+    {
+        // EINTR and friends: report no events
+        ReadyCount = 0;
+    }
+
+    return ReadyCount > 0;
+}
+
+void TCPSocketPollState::HandleEvents(SocketEvent_TCP* eventHandler)
+{
+    if (!eventHandler)
+    {
+        return;
+    }
+
+    for (int i = 0; i < ReadyCount; ++i)
+    {
+        Ptr<TCPSocket> tcpSocket;
+        {
+            Lock::Locker locker(&SocketsLock);
+
+            // The socket may have been removed by a handler for an earlier event
+            Ptr<TCPSocket>* registered = Sockets.Get((TCPSocket*)ReadyEvents[i].data.ptr);
+            if (!registered)
+            {
+                continue;
+            }
+            tcpSocket = *registered;
+        }
+
+        const uint32_t events = ReadyEvents[i].events;
+        handleEvent(tcpSocket, eventHandler,
+                    (events & EPOLLIN) != 0,
+                    (events & EPOLLOUT) != 0,
+                    (events & (EPOLLERR | EPOLLHUP)) != 0);
+    }
+
+    ReadyCount = 0;
+}
+
+#else // OVR_OS_LINUX
+
+TCPSocketPollState::TCPSocketPollState()
+{
+}
+
+TCPSocketPollState::~TCPSocketPollState()
+{
+}
+
+bool TCPSocketPollState::Add(TCPSocket* tcpSocket)
+{
+    if (!tcpSocket || tcpSocket->GetSocketHandle() == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    Lock::Locker locker(&SocketsLock);
+    Sockets.Set(tcpSocket, tcpSocket);
+    return true;
+}
+
+void TCPSocketPollState::Remove(TCPSocket* tcpSocket)
+{
+    Lock::Locker locker(&SocketsLock);
+    Sockets.Remove(tcpSocket);
+}
+
+bool TCPSocketPollState::Poll(long usec, long seconds, bool listeners)
+{
+    PollFDs.Clear();
+    PollSockets.Clear();
+
+    {
+        Lock::Locker locker(&SocketsLock);
+
+        for (Hash< TCPSocket*, Ptr<TCPSocket> >::Iterator it = Sockets.Begin(); it != Sockets.End(); ++it)
+        {
+            if (!listeners && it->Second->IsListenSocket)
+            {
+                continue;
+            }
+
+            // A closed handle is negative, which poll() skips
+            pollfd pfd;
+            pfd.fd = it->Second->GetSocketHandle();
+            pfd.events = POLLIN;
+            if (it->Second->IsConnecting)
+            {
+                pfd.events |= POLLOUT;
+            }
+            pfd.revents = 0;
+
+            PollFDs.PushBack(pfd);
+            PollSockets.PushBack(it->Second);
+        }
+    }
+
+    int timeoutMs = (int)(seconds * 1000 + (usec + 999) / 1000);
+
+    return poll(PollFDs.GetDataPtr(), (nfds_t)PollFDs.GetSize(), timeoutMs) > 0;
+}
+
+void TCPSocketPollState::HandleEvents(SocketEvent_TCP* eventHandler)
+{
+    if (!eventHandler)
+    {
+        return;
+    }
+
+    const int count = PollFDs.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        const short revents = PollFDs[i].revents;
+        if (revents == 0)
+        {
+            continue;
+        }
+
+        handleEvent(PollSockets[i], eventHandler,
+                    (revents & POLLIN) != 0,
+                    (revents & POLLOUT) != 0,
+                    (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0);
+    }
+
+    PollSockets.Clear();
+}
+
+#endif // OVR_OS_LINUX
+
+bool TCPSocketPollState::IsValid() const
+{
+    Lock::Locker locker(&SocketsLock);
+
+    return Sockets.GetSize() > 0;
+}
+
+void TCPSocketPollState::GetSockets(Array< Ptr<TCPSocket> >& sockets)
+{
+    Lock::Locker locker(&SocketsLock);
+
+    sockets.Clear();
+    for (Hash< TCPSocket*, Ptr<TCPSocket> >::Iterator it = Sockets.Begin(); it != Sockets.End(); ++it)
+    {
+        sockets.PushBack(it->Second);
+    }
+}
+
+void TCPSocketPollState::handleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler,
+                                     bool readable, bool writable, bool error)
+{
+    SocketHandle handle = tcpSocket->GetSocketHandle();
+    if (handle == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    if (tcpSocket->IsConnecting && (writable || error))
+    {
+        tcpSocket->IsConnecting = false;
+
+        int connectError = 0;
+        socklen_t connectErrorSize = sizeof(connectError);
+        if (getsockopt(handle, SOL_SOCKET, SO_ERROR, &connectError, &connectErrorSize) < 0 || connectError != 0)
+        {
+            eventHandler->TCP_OnClosed(tcpSocket);
+            return;
+        }
+
+#if defined(OVR_OS_LINUX)
+        // Connected: stop waiting for writability
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = tcpSocket;
+        epoll_ctl(EpollHandle, EPOLL_CTL_MOD, handle, &ev);
+#endif
+
+        eventHandler->TCP_OnConnected(tcpSocket);
+    }
+
+    if (readable)
+    {
+        if (!tcpSocket->IsListenSocket)
+        {
+            static const int BUFF_SIZE = 8096;
+            char data[BUFF_SIZE];
+
+            int bytesRead = (int)recv(handle, data, BUFF_SIZE, 0);
+            if (bytesRead > 0)
+            {
+                tcpSocket->OnRecv(eventHandler, (uint8_t*)data, bytesRead);
+            }
+            else if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                // Spurious wakeup
+            }
+            else // Disconnection event:
+            {
+                tcpSocket->IsConnecting = false;
+                eventHandler->TCP_OnClosed(tcpSocket);
+                return;
+            }
+        }
+        else
+        {
+            struct sockaddr_storage sockAddr;
+            socklen_t sockAddrSize = sizeof(sockAddr);
+
+            SocketHandle newSock = accept(handle, (sockaddr*)&sockAddr, &sockAddrSize);
+            if (newSock != INVALID_SOCKET)
+            {
+                SockAddr sa(&sockAddr);
+
+                // Local socket peers have no IP address, but are on this machine by definition
+                if (sockAddr.ss_family == AF_UNIX)
+                {
+                    sockaddr_in6 loopback;
+                    memset(&loopback, 0, sizeof(loopback));
+                    loopback.sin6_family = AF_INET6;
+                    loopback.sin6_addr = in6addr_loopback;
+                    sa.Set(&loopback);
+                }
+
+                eventHandler->TCP_OnAccept(tcpSocket, &sa, newSock);
+            }
+        }
+    }
+    else if (error)
+    {
+        tcpSocket->IsConnecting = false;
+        eventHandler->TCP_OnClosed(tcpSocket);
+    }
+}
+
+
+}} // namespace OVR::Net
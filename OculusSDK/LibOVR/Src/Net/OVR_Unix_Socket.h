@@ -0,0 +1,199 @@
+/************************************************************************************
+
+PublicHeader:   n/a
+Filename    :   OVR_Unix_Socket.h
+Content     :   Berkeley-socket networking implementation for Linux and other Unix systems
+Created     :   June 10, 2014
+Authors     :   Kevin Jenkins
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_Unix_Socket_h
+#define OVR_Unix_Socket_h
+
+#include "OVR_Socket.h"
+#include "OVR_BitStream.h"
+#include "../Kernel/OVR_Array.h"
+#include "../Kernel/OVR_Hash.h"
+#include "../Kernel/OVR_Atomic.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#if defined(OVR_OS_LINUX)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+namespace OVR { namespace Net {
+
+
+//-----------------------------------------------------------------------------
+// SockAddr
+
+// Abstraction for IPV6 socket address, with various convenience functions
+class SockAddr
+{
+public:
+	SockAddr();
+	SockAddr(SockAddr* sa);
+	SockAddr(sockaddr_storage* sa);
+	SockAddr(sockaddr_in6* sa);
+	SockAddr(const char* hostAddress, uint16_t port, int sockType);
+
+public:
+	void   Set(const sockaddr_storage* sa);
+	void   Set(const sockaddr_in6* sa);
+	void   Set(const char* hostAddress, uint16_t port, int sockType); // SOCK_DGRAM or SOCK_STREAM
+
+	uint16_t GetPort();
+
+	String ToString(bool writePort, char portDelineator) const;
+    bool IsLocalhost() const;
+
+	void   Serialize(BitStream* bs);
+	bool   Deserialize(BitStream);
+
+	bool   operator==( const SockAddr& right ) const;
+	bool   operator!=( const SockAddr& right ) const;
+	bool   operator >( const SockAddr& right ) const;
+	bool   operator <( const SockAddr& right ) const;
+
+public:
+	sockaddr_in6 Addr6;
+};
+
+
+//-----------------------------------------------------------------------------
+// UDP Socket
+
+// Unix version of UDP socket
+class UDPSocket : public UDPSocketBase
+{
+public:
+	UDPSocket();
+	virtual ~UDPSocket();
+
+public:
+	virtual SocketHandle Bind(BerkleyBindParameters* pBindParameters);
+	virtual int          Send(const void* pData, int bytes, SockAddr* address);
+	virtual void         Poll(SocketEvent_UDP* eventHandler);
+
+protected:
+	static const int RecvBufSize = 1048576;
+	uint8_t* RecvBuf;
+
+	virtual void         OnRecv(SocketEvent_UDP* eventHandler, uint8_t* pData,
+								int bytesRead, SockAddr* address);
+};
+
+
+//-----------------------------------------------------------------------------
+// TCP Socket
+
+// Unix version of TCP socket
+class TCPSocket : public TCPSocketBase
+{
+    friend class TCPSocketPollState;
+
+public:
+	TCPSocket();
+	TCPSocket(SocketHandle boundHandle, bool isListenSocket);
+	virtual ~TCPSocket();
+
+public:
+	virtual SocketHandle Bind(BerkleyBindParameters* pBindParameters);
+	virtual int          Listen();
+	virtual int          Connect(SockAddr* address);
+	virtual int          Send(const void* pData, int bytes);
+	virtual int          SendVectored(const void** pDataArray, const int* dataLengthArray, int arrayCount);
+	virtual void         Close();
+
+protected:
+	virtual void         OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData,
+								int bytesRead);
+
+public:
+	bool IsConnecting; // Is in the process of connecting?
+
+protected:
+	String LocalPath;  // AF_UNIX path from BerkleyBindParameters::LocalPath, or empty for TCP
+	dev_t  LocalPathDevice; // File that Listen() bound at LocalPath, so Close() only removes its own
+	ino_t  LocalPathInode;
+};
+
+
+//-----------------------------------------------------------------------------
+// TCPSocketPollState
+
+// Polls multiple blocking TCP sockets at once.
+// The set is persistent: sockets are added when they start listening, connecting
+// or are accepted, and removed when they close. On Linux it is an epoll set, so
+// a Poll() costs time in proportion to the ready sockets, not the registered ones.
+class TCPSocketPollState
+{
+public:
+    TCPSocketPollState();
+    ~TCPSocketPollState();
+
+    bool IsValid() const;
+    // Returns false if the socket can not be polled.
+    bool Add(TCPSocket* tcpSocket);
+    void Remove(TCPSocket* tcpSocket);
+    // Waits up to the timeout for events. Listen sockets are left out if listeners is false.
+    bool Poll(long usec = 30000, long seconds = 0, bool listeners = true);
+    // Dispatches the events found by the last Poll().
+    void HandleEvents(SocketEvent_TCP* eventHandler);
+    // Copies out the registered sockets
+    void GetSockets(Array< Ptr<TCPSocket> >& sockets);
+
+protected:
+    void handleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler,
+                     bool readable, bool writable, bool error);
+
+    mutable Lock SocketsLock;
+    // Registered sockets, keyed by the socket rather than its handle: a socket closed from
+    // another thread frees its handle for reuse while it is still registered here, and must
+    // stay registered until Poll() has reported the close.
+    Hash< TCPSocket*, Ptr<TCPSocket> > Sockets;
+
+#if defined(OVR_OS_LINUX)
+    enum { MaxReadyEvents = 64 };
+
+    SocketHandle EpollHandle;
+    epoll_event  ReadyEvents[MaxReadyEvents];
+    int          ReadyCount;
+    bool         ListenersArmed; // Are the listen sockets in the epoll set? Follows the Poll() argument.
+#else
+    ArrayPOD<pollfd>        PollFDs;     // Rebuilt by Poll()
+    Array< Ptr<TCPSocket> > PollSockets; // Socket for each entry of PollFDs
+#endif
+
+private:
+    OVR_NON_COPYABLE(TCPSocketPollState);
+};
+
+
+}} // OVR::Net
+
+#endif
@@ -292,6 +292,11 @@ static bool SetSocketOptions(SocketHandle sock)
     sock_opt = 1024 * 16;
     result |= setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char *)& sock_opt, sizeof (sock_opt));
 
+    // Send small messages at once instead of holding them back until the previous one
+    // is acknowledged, which costs a delayed-ACK timeout when a signal follows a call
+    sock_opt = 1;
+    result |= setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char *)& sock_opt, sizeof (sock_opt));
+
     // If all the setsockopt() returned 0 there were no failures, so return true for success, else false
     return result == 0;
 }
@@ -441,6 +446,12 @@ void TCPSocket::OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesR
 
 SocketHandle TCPSocket::Bind(BerkleyBindParameters* pBindParameters)
 {	
+    // Local (AF_UNIX) sockets are not supported here; the caller falls back to TCP
+    if (!pBindParameters->LocalPath.IsEmpty())
+    {
+        return INVALID_SOCKET;
+    }
+
 	SocketHandle s = BindShared(AF_INET6, SOCK_STREAM, pBindParameters);
 	if (s == INVALID_SOCKET)
 		return s;
@@ -499,10 +510,77 @@ int TCPSocket::Send(const void* pData, int bytes)
 	}
 	else
 	{
-		return send(TheSocket, (const char*)pData, bytes, 0);
+		return SendVectored(&pData, &bytes, 1);
 	}
 }
 
+int TCPSocket::SendVectored(const void** pDataArray, const int* dataLengthArray, int arrayCount)
+{
+    static const int MaxBuffers = 16;
+
+    int totalSent = 0;
+
+    // Each group of up to MaxBuffers buffers goes out in one system call, unless the
+    // socket buffer fills up, in which case the rest follows as soon as there is room.
+    for (int first = 0; first < arrayCount; first += MaxBuffers)
+    {
+        WSABUF buffers[MaxBuffers];
+        DWORD  bufferCount = 0;
+
+        for (int i = first; i < arrayCount && bufferCount < MaxBuffers; ++i)
+        {
+            if (dataLengthArray[i] > 0)
+            {
+                buffers[bufferCount].buf = (CHAR*)pDataArray[i];
+                buffers[bufferCount].len = (ULONG)dataLengthArray[i];
+                ++bufferCount;
+            }
+        }
+
+        WSABUF* pBuffers = buffers;
+        while (bufferCount > 0)
+        {
+            DWORD sent = 0;
+            if (WSASend(TheSocket, pBuffers, bufferCount, &sent, 0, NULL, NULL) == SOCKET_ERROR)
+            {
+                if (WSAGetLastError() == WSAEWOULDBLOCK)
+                {
+                    // Wait for room in the socket buffer, up to the blocking timeout
+                    fd_set writeSet;
+                    FD_ZERO(&writeSet);
+                    FD_SET(TheSocket, &writeSet);
+                    timeval tv;
+                    tv.tv_sec = TimeoutSec;
+                    tv.tv_usec = TimeoutUsec;
+
+                    if (select(0, NULL, &writeSet, NULL, &tv) > 0)
+                    {
+                        continue;
+                    }
+                }
+                return totalSent > 0 ? totalSent : -1;
+            }
+
+            totalSent += (int)sent;
+
+            // Skip past what was written
+            while (bufferCount > 0 && sent >= pBuffers->len)
+            {
+                sent -= pBuffers->len;
+                ++pBuffers;
+                --bufferCount;
+            }
+            if (bufferCount > 0)
+            {
+                pBuffers->buf += sent;
+                pBuffers->len -= sent;
+            }
+        }
+    }
+
+    return totalSent;
+}
+
 
 //// TCPSocketPollState
 
@@ -511,63 +589,154 @@ TCPSocketPollState::TCPSocketPollState()
     FD_ZERO(&readFD);
     FD_ZERO(&exceptionFD);
     FD_ZERO(&writeFD);
-    largestDescriptor = INVALID_SOCKET;
+}
+
+TCPSocketPollState::~TCPSocketPollState()
+{
 }
 
 bool TCPSocketPollState::IsValid() const
 {
-    return largestDescriptor != INVALID_SOCKET;
+    Lock::Locker locker(&SocketsLock);
+
+    return Sockets.GetSize() > 0;
 }
 
-void TCPSocketPollState::Add(TCPSocket* tcpSocket)
+bool TCPSocketPollState::Add(TCPSocket* tcpSocket)
 {
-    if (!tcpSocket)
+    if (!tcpSocket || tcpSocket->GetSocketHandle() == INVALID_SOCKET)
     {
-        return;
+        return false;
     }
 
-    SocketHandle handle = tcpSocket->GetSocketHandle();
+    Lock::Locker locker(&SocketsLock);
+
+    for (int i = 0; i < Sockets.GetSizeI(); ++i)
+    {
+        if (Sockets[i] == tcpSocket)
+        {
+            return true;
+        }
+    }
 
-    if (largestDescriptor == INVALID_SOCKET ||
-        largestDescriptor < handle)
+    // A socket past the fd_set capacity would never be polled
+    if (Sockets.GetSizeI() >= FD_SETSIZE)
     {
-        largestDescriptor = handle;
+        OVR::LogError("{ERR-021w} [Socket] Unable to poll more than %d sockets", FD_SETSIZE);
+        return false;
     }
 
-    FD_SET(handle, &readFD);
-    FD_SET(handle, &exceptionFD);
+    Sockets.PushBack(tcpSocket);
+    return true;
+}
+
+void TCPSocketPollState::Remove(TCPSocket* tcpSocket)
+{
+    Lock::Locker locker(&SocketsLock);
 
-    if (tcpSocket->IsConnecting)
+    for (int i = 0; i < Sockets.GetSizeI(); ++i)
     {
-        FD_SET(handle, &writeFD);
+        if (Sockets[i] == tcpSocket)
+        {
+            Sockets.RemoveAtUnordered(i);
+            return;
+        }
     }
 }
 
-bool TCPSocketPollState::Poll(long usec, long seconds)
+void TCPSocketPollState::GetSockets(Array< Ptr<TCPSocket> >& sockets)
 {
+    Lock::Locker locker(&SocketsLock);
+
+    sockets = Sockets;
+}
+
+bool TCPSocketPollState::Poll(long usec, long seconds, bool listeners)
+{
+    FD_ZERO(&readFD);
+    FD_ZERO(&exceptionFD);
+    FD_ZERO(&writeFD);
+    PollSockets.Clear();
+
+    {
+        Lock::Locker locker(&SocketsLock);
+
+        const int count = Sockets.GetSizeI();
+        for (int i = 0; i < count; ++i)
+        {
+            SocketHandle handle = Sockets[i]->GetSocketHandle();
+            if (handle == INVALID_SOCKET || (!listeners && Sockets[i]->IsListenSocket))
+            {
+                continue;
+            }
+
+            FD_SET(handle, &readFD);
+            FD_SET(handle, &exceptionFD);
+
+            if (Sockets[i]->IsConnecting)
+            {
+                FD_SET(handle, &writeFD);
+            }
+
+            PollSockets.PushBack(Sockets[i]);
+        }
+    }
+
+    // Winsock select() fails at once on empty sets; wait out the timeout as poll() would,
+    // so that a caller polling in a loop does not spin
+    if (PollSockets.GetSize() == 0)
+    {
+        Thread::MSleep((unsigned)(seconds * 1000 + (usec + 999) / 1000));
+        return false;
+    }
+
     timeval tv;
     tv.tv_sec = seconds;
     tv.tv_usec = usec;
 
-    return (int)select((int)largestDescriptor + 1, &readFD, &writeFD, &exceptionFD, &tv) > 0;
+    // The first argument is ignored by Winsock
+    return (int)select(0, &readFD, &writeFD, &exceptionFD, &tv) > 0;
 }
 
-void TCPSocketPollState::HandleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler)
+void TCPSocketPollState::HandleEvents(SocketEvent_TCP* eventHandler)
 {
-    if (!tcpSocket || !eventHandler)
+    if (!eventHandler)
     {
         return;
     }
 
+    const int count = PollSockets.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        TCPSocket* tcpSocket = PollSockets[i];
+        SocketHandle handle = tcpSocket->GetSocketHandle();
+
+        if (handle == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        handleEvent(tcpSocket, eventHandler,
+                    FD_ISSET(handle, &readFD) != 0,
+                    FD_ISSET(handle, &writeFD) != 0,
+                    FD_ISSET(handle, &exceptionFD) != 0);
+    }
+
+    PollSockets.Clear();
+}
+
+void TCPSocketPollState::handleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler,
+                                     bool readable, bool writable, bool error)
+{
     SocketHandle handle = tcpSocket->GetSocketHandle();
 
-    if (tcpSocket->IsConnecting && FD_ISSET(handle, &writeFD))
+    if (tcpSocket->IsConnecting && writable)
     {
         tcpSocket->IsConnecting = false;
         eventHandler->TCP_OnConnected(tcpSocket);
     }
 
-    if (FD_ISSET(handle, &readFD))
+    if (readable)
     {
         if (!tcpSocket->IsListenSocket)
         {
@@ -583,6 +752,7 @@ void TCPSocketPollState::HandleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* even
             {
                 tcpSocket->IsConnecting = false;
                 eventHandler->TCP_OnClosed(tcpSocket);
+                return;
             }
         }
         else
@@ -599,7 +769,7 @@ void TCPSocketPollState::HandleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* even
         }
     }
 
-    if (FD_ISSET(handle, &exceptionFD))
+    if (error)
     {
         tcpSocket->IsConnecting = false;
         eventHandler->TCP_OnClosed(tcpSocket);
@@ -30,6 +30,8 @@ limitations under the License.
 
 #include "OVR_Socket.h"
 #include "OVR_BitStream.h"
+#include "../Kernel/OVR_Array.h"
+#include "../Kernel/OVR_Atomic.h"
 
 #include <WinSock2.h>
 #include <WS2tcpip.h>
@@ -118,6 +120,7 @@ public:
 	virtual int          Listen();
 	virtual int          Connect(SockAddr* address);
 	virtual int          Send(const void* pData, int bytes);
+	virtual int          SendVectored(const void** pDataArray, const int* dataLengthArray, int arrayCount);
 
 protected:
 	virtual void         OnRecv(SocketEvent_TCP* eventHandler, uint8_t* pData,
@@ -131,18 +134,39 @@ public:
 //-----------------------------------------------------------------------------
 // TCPSocketPollState
 
-// Polls multiple blocking TCP sockets at once
+// Polls multiple blocking TCP sockets at once.
+// The set is persistent: sockets are added when they start listening, connecting
+// or are accepted, and removed when they close. The select() sets are rebuilt
+// from it on each Poll(), so it holds at most FD_SETSIZE sockets.
 class TCPSocketPollState
 {
-    fd_set readFD, exceptionFD, writeFD;
-    SocketHandle largestDescriptor;
-
 public:
     TCPSocketPollState();
+    ~TCPSocketPollState();
+
     bool IsValid() const;
-    void Add(TCPSocket* tcpSocket);
-    bool Poll(long usec = 30000, long seconds = 0);
-    void HandleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler);
+    // Returns false if the socket can not be polled; the set is full.
+    bool Add(TCPSocket* tcpSocket);
+    void Remove(TCPSocket* tcpSocket);
+    // Waits up to the timeout for events. Listen sockets are left out if listeners is false.
+    bool Poll(long usec = 30000, long seconds = 0, bool listeners = true);
+    // Dispatches the events found by the last Poll().
+    void HandleEvents(SocketEvent_TCP* eventHandler);
+    // Copies out the registered sockets
+    void GetSockets(Array< Ptr<TCPSocket> >& sockets);
+
+protected:
+    void handleEvent(TCPSocket* tcpSocket, SocketEvent_TCP* eventHandler,
+                     bool readable, bool writable, bool error);
+
+    mutable Lock SocketsLock;
+    Array< Ptr<TCPSocket> > Sockets;     // Registered sockets
+
+    fd_set readFD, exceptionFD, writeFD;
+    Array< Ptr<TCPSocket> > PollSockets; // Sockets in the fd_sets of the last Poll()
+
+private:
+    OVR_NON_COPYABLE(TCPSocketPollState);
 };
 
 
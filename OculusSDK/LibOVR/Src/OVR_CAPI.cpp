@@ -533,24 +533,31 @@ OVR_EXPORT void ovrHmd_RecenterPose(ovrHmd hmddesc)
 OVR_EXPORT ovrTrackingState ovrHmd_GetTrackingState(ovrHmd hmddesc, double absTime)
 {
     ovrTrackingState result;
+    ovrHmd_GetTrackingStates(hmddesc, &absTime, 1, &result);
+    return result;
+}
+
+OVR_EXPORT void ovrHmd_GetTrackingStates(ovrHmd hmddesc, const double* absTimes, int count,
+                                         ovrTrackingState* outStates)
+{
+    if (count <= 0)
+        return;
 
     if (hmddesc)
     {
         HMDState* p = (HMDState*)hmddesc->Handle;
-        result = p->PredictedTrackingState(absTime);
+        p->PredictedTrackingStates(absTimes, count, outStates);
 
-        // Instrument data from eye pose
-        p->LagStats.InstrumentEyePose(result);
+        // Instrument data from eye pose; the states share one sensor reading
+        p->LagStats.InstrumentEyePose(outStates[0]);
     }
     else
-        memset(&result, 0, sizeof(result));
+        memset(outStates, 0, sizeof(ovrTrackingState) * count);
 
 #ifdef OVR_OS_WIN32
         // Set up display code for Windows
-        Win32::DisplayShim::GetInstance().Active = (result.StatusFlags & ovrStatus_HmdConnected) != 0;
+        Win32::DisplayShim::GetInstance().Active = (outStates[0].StatusFlags & ovrStatus_HmdConnected) != 0;
 #endif
-
-    return result;
 }
 
 
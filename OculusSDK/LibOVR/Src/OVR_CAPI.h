@@ -559,6 +559,12 @@ OVR_EXPORT void     ovrHmd_RecenterPose(ovrHmd hmd);
 /// This may also be used for more refined timing of FrontBuffer rendering logic, etc.
 OVR_EXPORT ovrTrackingState ovrHmd_GetTrackingState(ovrHmd hmd, double absTime);
 
+/// Same as ovrHmd_GetTrackingState, for count absolute times at once.
+/// All of the states are predicted from the same sensor reading, so they are consistent
+/// with each other; the timewarp start and end poses are read this way.
+OVR_EXPORT void     ovrHmd_GetTrackingStates(ovrHmd hmd, const double* absTimes, int count,
+                                             ovrTrackingState* outStates);
+
 //-------------------------------------------------------------------------------------
 // ***** Graphics Setup
 
@@ -59,85 +59,217 @@ limitations under the License.
 #include "OVR_JSON.h"
 #include "Kernel/OVR_SysFile.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Atomic.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Hash.h"
 
 namespace OVR {
 
 
-//-----------------------------------------------------------------------------
-// Create a new copy of a string
-static char* JSON_strdup(const char* str)
+// Parse the input text into an un-escaped cstring, and populate item.
+static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
+
+// Helper to assign error sting and return 0.
+const char* AssignError(const char** perror, const char *errorMessage)
 {
-    size_t len  = OVR_strlen(str) + 1;
-    char* copy = (char*)OVR_ALLOC(len);
-    if (!copy)
-        return 0;
-    memcpy(copy, str, len);
-    return copy;
+    if (perror)
+        *perror = errorMessage;
+    return 0;
 }
 
-
 //-----------------------------------------------------------------------------
-// Render the number from the given item into a string.
-static char* PrintInt(int valueint)
+// ***** JSONArena
+
+// Every JSON node is preceded by this header. It records the arena the node was
+// carved from, or NULL for nodes allocated individually on the global heap.
+union JSONNodeHeader
+{
+    JSONArena*  pArena;
+    double      Align[2];
+};
+
+// A single block holding all the nodes of a parsed tree. Nodes are allocated
+// with a bump pointer and never reused; the block is freed when the last
+// node allocated from it is deleted.
+class JSONArena
 {
-    char *str;
-    str = (char*)OVR_ALLOC(21);	// 2^64+1 can be represented in 21 chars.
-    if (str)
+public:
+    // When true, parseString decodes into the input text instead of a copy.
+    bool            InSitu;
+
+    static JSONArena* Create(size_t nodeCount, bool inSitu)
     {
-        OVR_sprintf(str, 21, "%d", valueint);
+        size_t headerSize = (sizeof(JSONArena) + 15) & ~size_t(15);
+        uint8_t* block = (uint8_t*)OVR_ALLOC(headerSize + nodeCount * GetNodeStride());
+        if (!block)
+            return NULL;
+
+        JSONArena* arena = ::new(block) JSONArena(inSitu);
+        arena->pNext = block + headerSize;
+        arena->pEnd  = arena->pNext + nodeCount * GetNodeStride();
+        return arena;
     }
-    return str;
-}
 
+    // Returns memory for a node after its header, or NULL if the block is full.
+    void* AllocNode(size_t size)
+    {
+        OVR_ASSERT(size <= sizeof(JSON));
+        OVR_UNUSED(size);
+        if (pNext + GetNodeStride() > pEnd)
+            return NULL;
+
+        JSONNodeHeader* header = (JSONNodeHeader*)pNext;
+        header->pArena = this;
+        pNext += GetNodeStride();
+        LiveNodes.ExchangeAdd_NoSync(1);
+        return header + 1;
+    }
 
-//-----------------------------------------------------------------------------
-// Render the number from the given item into a string.
-static char* PrintNumber(double d)
+    void FreeNode()
+    {
+        if (LiveNodes.ExchangeAdd_Sync(-1) == 1)
+        {
+            this->~JSONArena();
+            OVR_FREE(this);
+        }
+    }
+
+private:
+    AtomicInt<int>  LiveNodes;
+    uint8_t*        pNext;
+    uint8_t*        pEnd;
+
+    JSONArena(bool inSitu) : InSitu(inSitu), LiveNodes(0), pNext(0), pEnd(0) { }
+
+    static size_t GetNodeStride()
+    {
+        return (sizeof(JSONNodeHeader) + sizeof(JSON) + 15) & ~size_t(15);
+    }
+};
+
+// Returns an upper bound on the number of values in JSON text: every value is
+// either the root, the first item of a container or follows a comma.
+static size_t CountJSONValues(const char* buff)
 {
-    char *str;
-    int valueint = (int)d;
-	if (fabs(((double)valueint)-d)<=DBL_EPSILON && d<=INT_MAX && d>=INT_MIN)
-	{
-        return PrintInt(valueint);
-	}
-	else
-	{
-		str=(char*)OVR_ALLOC(64);	// This is a nice tradeoff.
-		if (str)
-		{
-			if (fabs(floor(d)-d)<=DBL_EPSILON && fabs(d)<1.0e60)
-                OVR_sprintf(str, 64, "%.0f", d);
-			else if (fabs(d)<1.0e-6 || fabs(d)>1.0e9)
-                OVR_sprintf(str, 64, "%e", d);
-			else
-                OVR_sprintf(str, 64, "%f", d);
-		}
-	}
-	return str;
+    size_t count = 1;
+    for (; *buff; buff++)
+    {
+        char c = *buff;
+        if (c == ',' || c == '[' || c == '{')
+            count++;
+    }
+    return count;
 }
 
+//-----------------------------------------------------------------------------
+// ***** JSONIndex
 
-// Parse the input text into an un-escaped cstring, and populate item.
-static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
+// Child lists at most this long are searched linearly without an index.
+static const unsigned JSONIndexThreshold = 8;
 
-// Helper to assign error sting and return 0.
-const char* AssignError(const char** perror, const char *errorMessage)
+// Child name that refers to the string data of the child's Name.
+struct JSONNameKey
 {
-    if (perror)
-        *perror = errorMessage;
-    return 0;
-}
+    const char* pStr;
+    size_t      Size;
+
+    JSONNameKey(const char* str, size_t size) : pStr(str), Size(size) { }
+
+    bool operator== (const JSONNameKey& other) const
+    {
+        return Size == other.Size && memcmp(pStr, other.pStr, Size) == 0;
+    }
+
+    struct HashFunctor
+    {
+        size_t operator()(const JSONNameKey& key) const
+        {
+            return String::BernsteinHashFunction(key.pStr, key.Size);
+        }
+    };
+};
+
+// Lookup tables over the children of a JSON node, built on demand and
+// discarded whenever the child list changes.
+struct JSONIndex : public NewOverrideBase
+{
+    bool                    HasItems;
+    bool                    HasNames;
+    Array<JSON*>            Items;  // Children in list order
+    Hash<JSONNameKey, JSON*, JSONNameKey::HashFunctor> Names;  // First child with each name
+
+    JSONIndex() : HasItems(false), HasNames(false) { }
+};
 
 //-----------------------------------------------------------------------------
 // ***** JSON Node class
 
 JSON::JSON(JSONItemType itemType) :
-    Type(itemType), dValue(0.)
+    pIndex(0), Type(itemType), dValue(0.)
+{
+}
+
+void* JSON::operator new(size_t sz)
+{
+    JSONNodeHeader* header = (JSONNodeHeader*)OVR_ALLOC_DEBUG(sizeof(JSONNodeHeader) + sz, __FILE__, __LINE__);
+    if (!header)
+        return NULL;
+    header->pArena = NULL;
+    return header + 1;
+}
+
+void* JSON::operator new(size_t sz, const char* file, int line)
+{
+    JSONNodeHeader* header = (JSONNodeHeader*)OVR_ALLOC_DEBUG(sizeof(JSONNodeHeader) + sz, file, line);
+    OVR_UNUSED2(file, line);
+    if (!header)
+        return NULL;
+    header->pArena = NULL;
+    return header + 1;
+}
+
+void* JSON::operator new(size_t sz, JSONArena* arena)
+{
+    void* p = arena->AllocNode(sz);
+    // Fall back to the heap if the size estimate was exceeded.
+    return p ? p : JSON::operator new(sz);
+}
+
+void JSON::operator delete(void* p)
+{
+    if (!p)
+        return;
+
+#ifdef OVR_BUILD_DEBUG
+    checkInvalidDelete((JSON*)p);
+#endif
+
+    JSONNodeHeader* header = (JSONNodeHeader*)p - 1;
+    if (header->pArena)
+        header->pArena->FreeNode();
+    else
+        OVR_FREE(header);
+}
+
+void JSON::operator delete(void* p, const char*, int)
+{
+    JSON::operator delete(p);
+}
+
+void JSON::operator delete(void* p, JSONArena*)
+{
+    JSON::operator delete(p);
+}
+
+JSON* JSON::createNode(JSONArena* arena)
 {
+    return arena ? new(arena) JSON() : new JSON();
 }
 
 JSON::~JSON()
 {
+    delete pIndex;
+
     JSON* child = Children.GetFirst();
     while (!Children.IsNull(child))
     {
@@ -148,80 +280,63 @@ JSON::~JSON()
 }
 
 //-----------------------------------------------------------------------------
-// Parse the input text to generate a number, and populate the result into item
-// Returns the text position after the parsed number
-const char* JSON::parseNumber(const char *num)
+// Parses a number in the JSON grammar, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+// Returns the text position after the number, or num if the text is not a JSON number.
+// OVR_ParseDouble alone would also take forms JSON doesn't allow, such as "-inf", "nan",
+// "0x10", "01" or "1.", so it is only used for the value of text the grammar accepted.
+static const char* ParseJSONNumber(const char* num, double* value)
 {
-    const char* num_start = num;
-    double      n=0, scale=0;
-    int         subscale     = 0,
-                signsubscale = 1;
-    bool positiveSign = true;
-
-	// Could use sscanf for this?
-    if (*num == '-')
-    {
-        positiveSign = false;
-        num++;	// Has sign?
-    }
-    if (*num == '0')
-    {
-        num++;			// is zero
-    }
+    const char* p = num;
+
+    if (*p == '-')
+        p++;
+    if (*p == '0')
+        p++;
+    else if (*p >= '1' && *p <= '9')
+        while (*p >= '0' && *p <= '9') p++;
+    else
+        return num;
 
-    if (*num>='1' && *num<='9')	
+    if (*p == '.')
     {
-        do
-        {
-            n = (n*10.0) + (*num++ - '0');
-        }
-        while (*num>='0' && *num<='9');	// Number?
+        p++;
+        if (!(*p >= '0' && *p <= '9'))
+            return num;
+        while (*p >= '0' && *p <= '9') p++;
     }
-
-	if (*num=='.' && num[1]>='0' && num[1]<='9')
+    if (*p == 'e' || *p == 'E')
     {
-        num++;
-        do
-        {
-            n=(n*10.0)+(*num++ -'0');
-            scale--;
-        }
-        while (*num>='0' && *num<='9');  // Fractional part?
+        p++;
+        if (*p == '+' || *p == '-')
+            p++;
+        if (!(*p >= '0' && *p <= '9'))
+            return num;
+        while (*p >= '0' && *p <= '9') p++;
     }
 
-	if (*num=='e' || *num=='E')		// Exponent?
-	{
-        num++;
-        if (*num == '+')
-        {
-            num++;
-        }
-        else if (*num=='-')
-        {
-            signsubscale=-1;
-            num++;		// With sign?
-        }
-
-        while (*num >= '0' && *num <= '9')
-        {
-            subscale = (subscale * 10) + (*num++ - '0');	// Number?
-        }
-	}
-
-    // Number = +/- number.fraction * 10^+/- exponent
-    n *= pow(10.0, (scale + subscale*signsubscale));
+    // Locale-independent and correctly rounded. If it stops anywhere else the text
+    // after the number continues it in a way JSON doesn't allow, e.g. "01" or "0x1".
+    const char* end = num;
+    *value = OVR_ParseDouble(num, &end);
+    return (end == p) ? p : num;
+}
 
-    if (!positiveSign)
-    {
-        n = -n;
-    }
+//-----------------------------------------------------------------------------
+// Parse the input text to generate a number, and populate the result into item
+// Returns the text position after the parsed number
+const char* JSON::parseNumber(const char *num, const char** perror)
+{
+    double      number  = 0.;
+    const char* num_end = ParseJSONNumber(num, &number);
+    if (num_end == num)
+        return AssignError(perror, "Syntax Error: Invalid number");
 
     // Assign parsed value.
-    Type = JSON_Number;
-    dValue = n;
-    Value.AssignString(num_start, num - num_start);
+    Type   = JSON_Number;
+    dValue = number;
+    Value.AssignString(num, num_end - num);
 
-	return num;
+	return num_end;
 }
 
 // Parses a hex string up to the specified number of digits.
@@ -250,34 +365,30 @@ const char* ParseHex(unsigned* val, unsigned digits, const char* str)
 }
 
 //-----------------------------------------------------------------------------
-// Parses the input text into a string item and returns the text position after
-// the parsed string
-const char* JSON::parseString(const char* str, const char** perror)
+// Returns an upper bound on the unescaped length of the quoted string at str.
+static size_t MeasureString(const char* str)
 {
 	const char* ptr = str+1;
-    const char* p;
-    char*       ptr2;
-    char*       out;
-    int         len=0;
-    unsigned    uc, uc2;
-	
-    if (*str!='\"')
-    {
-        return AssignError(perror, "Syntax Error: Missing quote");
-    }
-	
+    size_t      len = 0;
+
 	while (*ptr!='\"' && *ptr && ++len)
     {   
-        if (*ptr++ == '\\') ptr++;	// Skip escaped quotes.
+        if (*ptr++ == '\\' && *ptr) ptr++;	// Skip escaped quotes.
     }
-	
-    // This is how long we need for the string, roughly.
-	out=(char*)OVR_ALLOC(len+1);
-	if (!out)
-        return 0;
-	
-	ptr = str+1;
-    ptr2= out;
+    return len;
+}
+
+//-----------------------------------------------------------------------------
+// Unescapes the quoted string at str into out, which must hold MeasureString
+// bytes, and returns the text position after the closing quote.
+// Unescaping never makes the text longer, so out may be str+1.
+static const char* UnescapeString(const char* str, char* out, size_t* outLen)
+{
+	const char* ptr = str+1;
+    const char* p;
+    char*       ptr2 = out;
+    int         len;
+    unsigned    uc, uc2;
 
 	while (*ptr!='\"' && *ptr)
 	{
@@ -288,6 +399,8 @@ const char* JSON::parseString(const char* str, const char** perror)
 		else
 		{
 			ptr++;
+            if (!*ptr)
+                break;	// Unterminated escape at the end of the text.
 			switch (*ptr)
 			{
 				case 'b': *ptr2++ = '\b';	break;
@@ -356,77 +469,56 @@ const char* JSON::parseString(const char* str, const char** perror)
 		}
 	}
 
-	*ptr2 = 0;
+	*outLen = (size_t)(ptr2 - out);
 	if (*ptr=='\"')
         ptr++;
-	
-    // Make a copy of the string 
-    Value=out;
-    OVR_FREE(out);
-	Type=JSON_String;
-
 	return ptr;
 }
 
 //-----------------------------------------------------------------------------
-// Render the string provided to an escaped version that can be printed.
-char* PrintString(const char* str)
+// Parses the input text into a string item and returns the text position after
+// the parsed string. The unescaped text is assigned to dest.
+const char* JSON::parseString(const char* str, const char** perror, String& dest, JSONArena* arena)
 {
-	const char *ptr;
-    char *ptr2,*out;
-    int len=0;
-    unsigned char token;
+    char*       out;
+    size_t      len;
+    char        shortBuffer[256];
 	
-	if (!str)
-        return JSON_strdup("");
-	ptr=str;
-    
-    token=*ptr;
-    while (token && ++len)\
+    if (*str!='\"')
     {
-        if (strchr("\"\\\b\f\n\r\t",token))
-            len++;
-        else if (token<32) 
-            len+=5;
-        ptr++;
-        token=*ptr;
+        return AssignError(perror, "Syntax Error: Missing quote");
     }
 	
-	int buff_size = len+3;
-    out=(char*)OVR_ALLOC(buff_size);
-	if (!out)
-        return 0;
+    // This is how long we need for the string, roughly.
+    // In-situ parsing decodes the text over the input itself; short strings
+    // are otherwise decoded on the stack.
+    len = MeasureString(str);
+    if (arena && arena->InSitu)
+    {
+        out = (char*)str + 1;
+    }
+    else if (len < sizeof(shortBuffer))
+    {
+        out = shortBuffer;
+    }
+    else
+    {
+	    out=(char*)OVR_ALLOC(len+1);
+	    if (!out)
+            return 0;
+    }
 
-	ptr2 = out;
-    ptr  = str;
-	*ptr2++ = '\"';
+    const char* ptr = UnescapeString(str, out, &len);
 
-	while (*ptr)
-	{
-		if ((unsigned char)*ptr>31 && *ptr!='\"' && *ptr!='\\') 
-            *ptr2++=*ptr++;
-		else
-		{
-			*ptr2++='\\';
-			switch (token=*ptr++)
-			{
-				case '\\':	*ptr2++='\\';	break;
-				case '\"':	*ptr2++='\"';	break;
-				case '\b':	*ptr2++='b';	break;
-				case '\f':	*ptr2++='f';	break;
-				case '\n':	*ptr2++='n';	break;
-				case '\r':	*ptr2++='r';	break;
-				case '\t':	*ptr2++='t';	break;
-				default: 
-                    OVR_sprintf(ptr2, buff_size - (ptr2-out), "u%04x",token);
-                    ptr2+=5;
-                    break;	// Escape and print.
-			}
-		}
-	}
-	*ptr2++='\"';
-    *ptr2++=0;
-	return out;
+	// Make a copy of the string. No terminator is written since in-situ
+	// output may have caught up with the closing quote.
+	dest.AssignString(out, len);
+	if (out != shortBuffer && out != str + 1)
+        OVR_FREE(out);
+	
+	Type=JSON_String;
+
+	return ptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -442,9 +534,34 @@ static const char* skip(const char* in)
 // Parses the supplied buffer of JSON text and returns a JSON object tree
 // The returned object must be Released after use
 JSON* JSON::Parse(const char* buff, const char** perror)
+{
+    return parseRoot(buff, perror, NULL);
+}
+
+//-----------------------------------------------------------------------------
+// Parses the supplied buffer with all nodes allocated from one block.
+// The returned object must be Released after use
+JSON* JSON::ParseArena(const char* buff, const char** perror)
+{
+    if (!buff)
+        return NULL;
+    return parseRoot(buff, perror, JSONArena::Create(CountJSONValues(buff), false));
+}
+
+//-----------------------------------------------------------------------------
+// Parses the supplied writable buffer with all nodes allocated from one block,
+// unescaping strings in place. The buffer contents are undefined afterwards.
+JSON* JSON::ParseInSitu(char* buff, const char** perror)
+{
+    if (!buff)
+        return NULL;
+    return parseRoot(buff, perror, JSONArena::Create(CountJSONValues(buff), true));
+}
+
+JSON* JSON::parseRoot(const char* buff, const char** perror, JSONArena* arena)
 {
     const char* end = 0;
-	JSON*       json = new JSON();
+	JSON*       json = createNode(arena);
 	
 	if (!json)
     {
@@ -452,7 +569,7 @@ JSON* JSON::Parse(const char* buff, const char** perror)
         return 0;
     }
  
-	end = json->parseValue(skip(buff), perror);
+	end = json->parseValue(skip(buff), perror, arena);
 	if (!end)
     {
         json->Release();
@@ -472,7 +589,7 @@ JSON* JSON::ParseBuffer(const char *buff, int len, const char** perror)
 	memcpy(termStr, buff, len);
 	termStr[len] = '\0';
 
-	JSON *objJson = Parse(termStr, perror);
+	JSON *objJson = ParseInSitu(termStr, perror);
 
 	delete[]termStr;
 
@@ -481,7 +598,7 @@ JSON* JSON::ParseBuffer(const char *buff, int len, const char** perror)
 
 //-----------------------------------------------------------------------------
 // Parser core - when encountering text, process appropriately.
-const char* JSON::parseValue(const char* buff, const char** perror)
+const char* JSON::parseValue(const char* buff, const char** perror, JSONArena* arena)
 {
     if (perror)
         *perror = 0;
@@ -510,19 +627,19 @@ const char* JSON::parseValue(const char* buff, const char** perror)
     }
 	if (*buff=='\"')
     {
-        return parseString(buff, perror);
+        return parseString(buff, perror, Value, arena);
     }
 	if (*buff=='-' || (*buff>='0' && *buff<='9'))
     { 
-        return parseNumber(buff);
+        return parseNumber(buff, perror);
     }
 	if (*buff=='[')
     { 
-        return parseArray(buff, perror);
+        return parseArray(buff, perror, arena);
     }
 	if (*buff=='{')
     {
-        return parseObject(buff, perror);
+        return parseObject(buff, perror, arena);
     }
 
     return AssignError(perror, "Syntax Error: Invalid syntax");
@@ -530,33 +647,19 @@ const char* JSON::parseValue(const char* buff, const char** perror)
 
 
 //-----------------------------------------------------------------------------
-// Render a value to text. 
+// Render a value to text. The returned text must be freed with OVR_FREE.
 char* JSON::PrintValue(int depth, bool fmt)
 {
-	char *out=0;
-
-    switch (Type)
-	{
-        case JSON_Null:	    out = JSON_strdup("null");	break;
-        case JSON_Bool:
-            if ((int)dValue == 0)
-                out = JSON_strdup("false");
-            else
-                out = JSON_strdup("true");
-            break;
-        case JSON_Number:	out = PrintNumber(dValue); break;
-        case JSON_String:	out = PrintString(Value); break;
-        case JSON_Array:	out = PrintArray(depth, fmt); break;
-        case JSON_Object:	out = PrintObject(depth, fmt); break;
-        case JSON_None: OVR_ASSERT_LOG(false, ("Bad JSON type.")); break;
-	}
-	return out;
+    JSONWriter writer(fmt);
+    writer.SetBaseDepth(depth);
+    writer.WriteValue(this);
+    return writer.DetachText();
 }
 
 //-----------------------------------------------------------------------------
 // Build an array object from input text and returns the text position after
 // the parsed array
-const char* JSON::parseArray(const char* buff, const char** perror)
+const char* JSON::parseArray(const char* buff, const char** perror, JSONArena* arena)
 {
 	JSON *child;
 	if (*buff!='[')
@@ -570,24 +673,24 @@ const char* JSON::parseArray(const char* buff, const char** perror)
     if (*buff==']')
         return buff+1;	// empty array.
 
-    child = new JSON();
+    child = createNode(arena);
 	if (!child)
         return 0;		 // memory fail
     Children.PushBack(child);
 	
-    buff=skip(child->parseValue(skip(buff), perror));	// skip any spacing, get the buff. 
+    buff=skip(child->parseValue(skip(buff), perror, arena));	// skip any spacing, get the buff. 
 	if (!buff)
         return 0;
 
 	while (*buff==',')
 	{
-		JSON *new_item = new JSON();
+		JSON *new_item = createNode(arena);
 		if (!new_item)
             return AssignError(perror, "Error: Failed to allocate memory");
 		
         Children.PushBack(new_item);
 
-		buff=skip(new_item->parseValue(skip(buff+1), perror));
+		buff=skip(new_item->parseValue(skip(buff+1), perror, arena));
 		if (!buff)
             return AssignError(perror, "Error: Failed to allocate memory");
 	}
@@ -598,94 +701,10 @@ const char* JSON::parseArray(const char* buff, const char** perror)
     return AssignError(perror, "Syntax Error: Missing ending bracket");
 }
 
-//-----------------------------------------------------------------------------
-// Render an array to text.  The returned text must be freed
-char* JSON::PrintArray(int depth, bool fmt)
-{
-	char **  entries;
-	char *   out = 0, *ptr,*ret;
-    intptr_t len = 5;
-	
-    bool fail = false;
-	
-	// How many entries in the array? 
-    int numentries = GetItemCount();
-	if (!numentries)
-	{
-		out=(char*)OVR_ALLOC(3);
-		if (out)
-            OVR_strcpy(out, 3, "[]");
-		return out;
-	}
-	// Allocate an array to hold the values for each
-	entries=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	if (!entries)
-        return 0;
-	memset(entries,0,numentries*sizeof(char*));
-
-	//// Retrieve all the results:
-    JSON* child = Children.GetFirst();
-    for (int i=0; i<numentries; i++)
-	{
-		//JSON* child = Children[i];
-        ret=child->PrintValue(depth+1, fmt);
-		entries[i]=ret;
-		if (ret)
-            len+=OVR_strlen(ret)+2+(fmt?1:0);
-        else
-        {
-            fail = true;
-            break;
-        }
-        child = Children.GetNext(child);
-	}
-	
-	// If we didn't fail, try to malloc the output string 
-	if (!fail)
-        out=(char*)OVR_ALLOC(len);
-	// If that fails, we fail. 
-	if (!out)
-        fail = true;
-
-	// Handle failure.
-	if (fail)
-	{
-		for (int i=0; i<numentries; i++) 
-        {
-            if (entries[i])
-                OVR_FREE(entries[i]);
-        }
-		OVR_FREE(entries);
-		return 0;
-	}
-	
-	// Compose the output array.
-	*out='[';
-	ptr=out+1;
-    *ptr=0;
-	for (int i=0; i<numentries; i++)
-	{
-		OVR_strcpy(ptr, len - (ptr-out), entries[i]);
-        ptr+=OVR_strlen(entries[i]);
-		if (i!=numentries-1)
-        {
-            *ptr++=',';
-            if (fmt)
-                *ptr++=' ';
-            *ptr=0;
-        }
-		OVR_FREE(entries[i]);
-	}
-	OVR_FREE(entries);
-	*ptr++=']';
-    *ptr++=0;
-	return out;	
-}
-
 //-----------------------------------------------------------------------------
 // Build an object from the supplied text and returns the text position after
 // the parsed object
-const char* JSON::parseObject(const char* buff, const char** perror)
+const char* JSON::parseObject(const char* buff, const char** perror, JSONArena* arena)
 {
 	if (*buff!='{')
     {
@@ -697,46 +716,43 @@ const char* JSON::parseObject(const char* buff, const char** perror)
 	if (*buff=='}')
         return buff+1;	// empty array.
 	
-    JSON* child = new JSON();
+    JSON* child = createNode(arena);
+	if (!child)
+        return 0;		 // memory fail
     Children.PushBack(child);
 
-	buff=skip(child->parseString(skip(buff), perror));
+	buff=skip(child->parseString(skip(buff), perror, child->Name, arena));
 	if (!buff) 
         return 0;
-	child->Name = child->Value;
-    child->Value.Clear();
 	
     if (*buff!=':')
     {
         return AssignError(perror, "Syntax Error: Missing colon");
     }
 
-	buff=skip(child->parseValue(skip(buff+1), perror));	// skip any spacing, get the value.
+	buff=skip(child->parseValue(skip(buff+1), perror, arena));	// skip any spacing, get the value.
 	if (!buff)
         return 0;
 	
 	while (*buff==',')
 	{
-        child = new JSON();
+        child = createNode(arena);
 		if (!child)
             return 0; // memory fail
 		
         Children.PushBack(child);
 
-		buff=skip(child->parseString(skip(buff+1), perror));
+		buff=skip(child->parseString(skip(buff+1), perror, child->Name, arena));
 		if (!buff)
             return 0;
 		
-        child->Name=child->Value;
-        child->Value.Clear();
-		
         if (*buff!=':')
         {
             return AssignError(perror, "Syntax Error: Missing colon");
         }	// fail!
 		
         // Skip any spacing, get the value.
-        buff=skip(child->parseValue(skip(buff+1), perror));
+        buff=skip(child->parseValue(skip(buff+1), perror, arena));
 		if (!buff)
             return 0;
 	}
@@ -747,224 +763,134 @@ const char* JSON::parseObject(const char* buff, const char** perror)
     return AssignError(perror, "Syntax Error: Missing closing brace");
 }
 
-//-----------------------------------------------------------------------------
-// Render an object to text.  The returned string must be freed
-char* JSON::PrintObject(int depth, bool fmt)
-{
-	char**   entries = 0, **names = 0;
-	char*    out = 0;
-    char*    ptr, *ret, *str;
-    intptr_t len = 7, i = 0, j;
-    bool     fail = false;
-	
-    // Count the number of entries.
-    int numentries = GetItemCount();
-    
-	// Explicitly handle empty object case
-	if (numentries == 0)
-	{
-		out=(char*)OVR_ALLOC(fmt?depth+4:4);
-		if (!out)
-            return 0;
-		ptr=out;
-        *ptr++='{';
-		
-        if (fmt)
-        {
-            *ptr++='\n';
-            for (i=0;i<depth-1;i++)
-                *ptr++='\t';
-        }
-		*ptr++='}';
-        *ptr++=0;
-		return out;
-	}
-	// Allocate space for the names and the objects
-	entries=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	if (!entries)
-        return 0;
-	names=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	
-    if (!names)
+// Returns the number of child items in the object
+// Counts the number of items in the object.
+unsigned JSON::GetItemCount() const
+{
+    if (pIndex && pIndex->HasItems)
     {
-        OVR_FREE(entries);
-        return 0;
+        return (unsigned)pIndex->Items.GetSize();
     }
-	memset(entries,0,sizeof(char*)*numentries);
-	memset(names,0,sizeof(char*)*numentries);
 
-	// Collect all the results into our arrays:
-    depth++;
-    if (fmt)
-        len+=depth;
-
-    JSON* child = Children.GetFirst();
-    while (!Children.IsNull(child))
-	{
-		names[i]     = str = PrintString(child->Name);
-		entries[i++] = ret = child->PrintValue(depth, fmt);
+    unsigned count = 0;
+    for (const JSON* p = Children.GetFirst(); !Children.IsNull(p); p = p->pNext)
+    {
+        count++;
+    }
+    return count;
+}
 
-		if (str && ret)
+JSON* JSON::GetItemByIndex(unsigned index)
+{
+    if (!pIndex || !pIndex->HasItems)
+    {
+        if (index >= JSONIndexThreshold)
         {
-            len += OVR_strlen(ret)+OVR_strlen(str)+2+(fmt?3+depth:0);
+            buildItemIndex();
         }
         else
         {
-            fail = true;
-            break;
-        }
-		
-        child = Children.GetNext(child);
-	}
-	
-	// Try to allocate the output string
-	if (!fail)
-        out=(char*)OVR_ALLOC(len);
-	if (!out)
-        fail=true;
-
-	// Handle failure
-	if (fail)
-	{
-		for (i=0;i<numentries;i++)
-        {
-            if (names[i])
-                OVR_FREE(names[i]);
-            
-            if (entries[i])
-                OVR_FREE(entries[i]);}
-		
-        OVR_FREE(names);
-        OVR_FREE(entries);
-		return 0;
-	}
-	
-	// Compose the output:
-	*out = '{';
-    ptr  = out+1;
-    if (fmt)
-    {
-#ifdef OVR_OS_WIN32
-        *ptr++ = '\r';
-#endif
-        *ptr++ = '\n';
-    }
-    *ptr = 0;
-	
-    for (i=0; i<numentries; i++)
-	{
-		if (fmt)
-        {
-            for (j = 0; j < depth; j++)
+            unsigned i     = 0;
+            JSON*    child = 0;
+
+            if (!Children.IsEmpty())
             {
-                *ptr++ = '\t';
+                child = Children.GetFirst();
+
+                while (i < index)
+                {   
+                    if (Children.IsNull(child->pNext))
+                    {
+                        child = 0;
+                        break;
+                    }
+                    child = child->pNext;
+                    i++;
+                }
             }
-        }
-		OVR_strcpy(ptr, len - (ptr-out), names[i]);
-        ptr   += OVR_strlen(names[i]);
-		*ptr++ =':';
-        
-        if (fmt)
-        {
-            *ptr++ = '\t';
-        }
-		
-        OVR_strcpy(ptr, len - (ptr-out), entries[i]);
-        ptr+=OVR_strlen(entries[i]);
-		
-        if (i != numentries - 1)
-        {
-            *ptr++ = ',';
-        }
-		
-        if (fmt)
-        {
-#ifdef OVR_OS_WIN32
-            *ptr++ = '\r';
-#endif
-            *ptr++ = '\n';
-        }
-        *ptr = 0;
-		
-        OVR_FREE(names[i]);
-        OVR_FREE(entries[i]);
-	}
-	
-	OVR_FREE(names);
-    OVR_FREE(entries);
-	
-    if (fmt)
-    {
-        for (i = 0; i < depth - 1; i++)
-        {
-            *ptr++ = '\t';
+
+            return child;
         }
     }
-	*ptr++='}';
-    *ptr++=0;
-	
-    return out;	
+
+    return (index < pIndex->Items.GetSize()) ? pIndex->Items[index] : 0;
 }
 
+// Returns the child item with the given name or NULL if not found
+JSON* JSON::GetItemByName(const char* name)
+{
+    if (!name)
+    {
+        return 0;
+    }
 
+    if (pIndex && pIndex->HasNames)
+    {
+        JSON** child = pIndex->Names.Get(JSONNameKey(name, OVR_strlen(name)));
+        return child ? *child : 0;
+    }
 
-// Returns the number of child items in the object
-// Counts the number of items in the object.
-unsigned JSON::GetItemCount() const
-{
-    unsigned count = 0;
-    for (const JSON* p = Children.GetFirst(); !Children.IsNull(p); p = p->pNext)
+    JSON*    found   = 0;
+    unsigned visited = 0;
+
+    for (JSON* child = Children.GetFirst(); !Children.IsNull(child); child = child->pNext)
     {
-        count++;
+        visited++;
+        if (OVR_strcmp(child->Name, name) == 0)
+        {
+            found = child;
+            break;
+        }
     }
-    return count;
+
+    // Objects that had to be searched deeply get an index for later lookups.
+    if (visited > JSONIndexThreshold)
+    {
+        buildNameIndex();
+    }
+
+    return found;
 }
 
-JSON* JSON::GetItemByIndex(unsigned index)
+void JSON::invalidateIndex()
 {
-    unsigned i     = 0;
-    JSON*    child = 0;
+    delete pIndex;
+    pIndex = 0;
+}
 
-    if (!Children.IsEmpty())
+void JSON::buildNameIndex()
+{
+    if (!pIndex)
     {
-        child = Children.GetFirst();
+        pIndex = new JSONIndex;
+    }
 
-        while (i < index)
-        {   
-            if (Children.IsNull(child->pNext))
-            {
-                child = 0;
-                break;
-            }
-            child = child->pNext;
-            i++;
+    pIndex->Names.Clear();
+    for (JSON* child = Children.GetFirst(); !Children.IsNull(child); child = child->pNext)
+    {
+        // Keep the first of any duplicate names, matching the linear search.
+        JSONNameKey key(child->Name.ToCStr(), child->Name.GetSize());
+        if (!pIndex->Names.Get(key))
+        {
+            pIndex->Names.Add(key, child);
         }
     }
-  
-    return child;
+    pIndex->HasNames = true;
 }
 
-// Returns the child item with the given name or NULL if not found
-JSON* JSON::GetItemByName(const char* name)
+void JSON::buildItemIndex()
 {
-    JSON* child = 0;
-
-    if (!Children.IsEmpty())
+    if (!pIndex)
     {
-        child = Children.GetFirst();
-
-        while (OVR_strcmp(child->Name, name) != 0)
-        {   
-            if (Children.IsNull(child->pNext))
-            {
-                child = 0;
-                break;
-            }
-            child = child->pNext;
-        }
+        pIndex = new JSONIndex;
     }
 
-    return child;
+    pIndex->Items.Clear();
+    for (JSON* child = Children.GetFirst(); !Children.IsNull(child); child = child->pNext)
+    {
+        pIndex->Items.PushBack(child);
+    }
+    pIndex->HasItems = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -975,6 +901,7 @@ void JSON::AddItem(const char *string, JSON *item)
     {
         item->Name = string;
         Children.PushBack(item);
+        invalidateIndex();
     }
 }
 
@@ -1025,6 +952,18 @@ void JSON::RemoveLast()
     {
         child->RemoveNode();
         child->Release();
+        invalidateIndex();
+    }
+}
+
+// Removes and frees the given child item
+void JSON::RemoveItem(JSON* item)
+{
+    if (item)
+    {
+        item->RemoveNode();
+        item->Release();
+        invalidateIndex();
     }
 }
 
@@ -1131,6 +1070,7 @@ void JSON::AddArrayElement(JSON *item)
     if (item)
     {
         Children.PushBack(item);
+        invalidateIndex();
     }
 }
 
@@ -1142,6 +1082,8 @@ void JSON::InsertArrayElement(int index, JSON *item)
         return;
     }
 
+    invalidateIndex();
+
     if (index == 0)
     {
         Children.PushFront(item);
@@ -1240,7 +1182,8 @@ JSON* JSON::Load(const char* path, const char** perror)
 	// Ensure the result is null-terminated since Parse() expects null-terminated input.
 	buff[len] = '\0';
 
-    JSON* json = JSON::Parse((char*)buff, perror);
+    // The buffer is ours, so strings can be decoded in place.
+    JSON* json = JSON::ParseInSitu((char*)buff, perror);
     OVR_FREE(buff);
     return json;
 }
@@ -1253,21 +1196,1001 @@ bool JSON::Save(const char* path)
     if (!f.Open(path, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_Write))
         return false;
 
-    char* text = PrintValue(0, true);
-    if (text)
+    // Text is written out in fixed-size chunks as it is produced.
+    JSONWriter writer(&f, true);
+    writer.WriteValue(this);
+    bool result = writer.Flush();
+    f.Close();
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Builds a JSON tree from the reader's current value.
+// The returned object must be Released after use.
+JSON* JSON::Read(JSONReader& reader, const char** perror)
+{
+    if (!reader.Started)
+        reader.Next();
+
+    JSON* node = createNode(NULL);
+    if (!node)
+    {
+        AssignError(perror, "Error: Failed to allocate memory");
+        return NULL;
+    }
+    if (reader.GetNameLength())
+        node->Name.AssignString(reader.GetName(), reader.GetNameLength());
+
+    JSONReader::EventType endEvent = JSONReader::Event_Error;
+
+    switch (reader.GetEvent())
     {
-        intptr_t len   = OVR_strlen(text);
-        OVR_ASSERT(len <= (intptr_t)(int)len);
+    case JSONReader::Event_Null:
+        node->Type = JSON_Null;
+        return node;
+
+    case JSONReader::Event_Bool:
+        node->Type   = JSON_Bool;
+        node->dValue = reader.GetNumber();
+        node->Value  = reader.GetBool() ? "true" : "false";
+        return node;
+
+    case JSONReader::Event_Number:
+        node->Type   = JSON_Number;
+        node->dValue = reader.GetNumber();
+        node->Value.AssignString(reader.GetString(), reader.GetStringLength());
+        return node;
+
+    case JSONReader::Event_String:
+        node->Type = JSON_String;
+        node->Value.AssignString(reader.GetString(), reader.GetStringLength());
+        return node;
+
+    case JSONReader::Event_BeginArray:
+        node->Type = JSON_Array;
+        endEvent   = JSONReader::Event_EndArray;
+        break;
+
+    case JSONReader::Event_BeginObject:
+        node->Type = JSON_Object;
+        endEvent   = JSONReader::Event_EndObject;
+        break;
+
+    case JSONReader::Event_Error:
+        node->Release();
+        AssignError(perror, reader.GetError());
+        return NULL;
+
+    default:
+        node->Release();
+        AssignError(perror, "Syntax Error: No value to read");
+        return NULL;
+    }
 
-        int   bytes = f.Write((uint8_t*)text, (int)len);
-        f.Close();
-        OVR_FREE(text);
-        return (bytes == len);
+    while (reader.Next() != endEvent)
+    {
+        JSON* child = Read(reader, perror);
+        if (!child)
+        {
+            node->Release();
+            return NULL;
+        }
+        node->Children.PushBack(child);
     }
+    return node;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** Binary Encoding
+
+// Infinity and NaN have no JSON representation; their exponent bits are all set.
+static bool IsFiniteNumber(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return ((bits >> 52) & 0x7FF) != 0x7FF;
+}
+
+// Formats a number the way the text writer does: integral values without a
+// fraction, anything else as the shortest text that reads back exactly.
+// Non-finite values are written as null, so the output always parses.
+static void FormatNumber(char* buffer, size_t size, double d)
+{
+    if (!IsFiniteNumber(d))
+        OVR_strcpy(buffer, size, "null");
+    else if (d <= INT_MAX && d >= INT_MIN && (double)(int)d == d)
+        OVR_sprintf(buffer, size, "%d", (int)d);
     else
+        OVR_FormatDouble(buffer, size, d);
+}
+
+// Appends tag followed by the low 'bytes' bytes of value, big-endian.
+static void PutBinary(ArrayPOD<uint8_t>& dest, uint8_t tag, uint64_t value, int bytes)
+{
+    size_t pos = dest.GetSize();
+    dest.Resize(pos + 1 + bytes);
+
+    uint8_t* p = &dest[pos];
+    *p++ = tag;
+    for (int i = bytes - 1; i >= 0; i--)
     {
+        p[i]    = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+// Appends a str, array or map header. Arrays and maps have no 8-bit form.
+static void PutBinaryHeader(ArrayPOD<uint8_t>& dest, uint8_t fixTag, size_t fixLimit,
+                            uint8_t tag8, uint8_t tag16, uint8_t tag32, size_t count)
+{
+    if (count < fixLimit)
+        dest.PushBack((uint8_t)(fixTag | count));
+    else if (tag8 && count <= 0xFF)
+        PutBinary(dest, tag8, count, 1);
+    else if (count <= 0xFFFF)
+        PutBinary(dest, tag16, count, 2);
+    else
+        PutBinary(dest, tag32, count, 4);
+}
+
+static void PutBinaryString(ArrayPOD<uint8_t>& dest, const String& str)
+{
+    size_t len = str.GetSize();
+    PutBinaryHeader(dest, 0xA0, 32, 0xD9, 0xDA, 0xDB, len);
+
+    size_t pos = dest.GetSize();
+    dest.Resize(pos + len);
+    if (len)
+        memcpy(&dest[pos], str.ToCStr(), len);
+}
+
+// -0.0 compares equal to 0, so the integer test alone would drop its sign.
+static bool IsNegativeZero(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits == ((uint64_t)1 << 63);
+}
+
+static void PutBinaryNumber(ArrayPOD<uint8_t>& dest, double d)
+{
+    if (d <= INT_MAX && d >= INT_MIN && (double)(int)d == d && !IsNegativeZero(d))
+    {
+        int i = (int)d;
+        if (i >= 0 && i <= 0x7F)
+            dest.PushBack((uint8_t)i);
+        else if (i < 0 && i >= -32)
+            dest.PushBack((uint8_t)(int8_t)i);
+        else if (i >= 0)
+            PutBinary(dest, (i <= 0xFF) ? 0xCC : (i <= 0xFFFF) ? 0xCD : 0xCE, (uint32_t)i,
+                      (i <= 0xFF) ? 1 : (i <= 0xFFFF) ? 2 : 4);
+        else
+            PutBinary(dest, (i >= -128) ? 0xD0 : (i >= -32768) ? 0xD1 : 0xD2, (uint32_t)i,
+                      (i >= -128) ? 1 : (i >= -32768) ? 2 : 4);
+    }
+    else if ((double)(float)d == d)
+    {
+        float    f = (float)d;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        PutBinary(dest, 0xCA, bits, 4);
+    }
+    else
+    {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        PutBinary(dest, 0xCB, bits, 8);
+    }
+}
+
+static uint64_t GetBinary(const uint8_t* p, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+// Reads a str header and payload into dest; returns the position after it.
+static const uint8_t* GetBinaryString(const uint8_t* p, const uint8_t* end, String& dest, const char** perror)
+{
+    size_t len;
+    int    lenBytes = 0;
+
+    if (p >= end)
+    {
+        AssignError(perror, "Binary Error: Unexpected end of data");
+        return NULL;
+    }
+
+    uint8_t tag = *p++;
+    if ((tag & 0xE0) == 0xA0)
+        len = tag & 0x1F;
+    else if (tag == 0xD9)
+        lenBytes = 1;
+    else if (tag == 0xDA)
+        lenBytes = 2;
+    else if (tag == 0xDB)
+        lenBytes = 4;
+    else
+    {
+        AssignError(perror, "Binary Error: Expected string");
+        return NULL;
+    }
+
+    if (lenBytes)
+    {
+        if (end - p < lenBytes)
+        {
+            AssignError(perror, "Binary Error: Unexpected end of data");
+            return NULL;
+        }
+        len = (size_t)GetBinary(p, lenBytes);
+        p  += lenBytes;
+    }
+
+    if ((size_t)(end - p) < len)
+    {
+        AssignError(perror, "Binary Error: Unexpected end of data");
+        return NULL;
+    }
+    dest.AssignString((const char*)p, len);
+    return p + len;
+}
+
+void JSON::WriteBinary(ArrayPOD<uint8_t>& dest)
+{
+    switch (Type)
+    {
+    case JSON_Null:   dest.PushBack(0xC0); break;
+    case JSON_Bool:   dest.PushBack(((int)dValue != 0) ? 0xC3 : 0xC2); break;
+    case JSON_Number: PutBinaryNumber(dest, dValue); break;
+    case JSON_String: PutBinaryString(dest, Value); break;
+
+    case JSON_Array:
+    case JSON_Object:
+        {
+            bool isObject = (Type == JSON_Object);
+            if (isObject)
+                PutBinaryHeader(dest, 0x80, 16, 0, 0xDE, 0xDF, GetItemCount());
+            else
+                PutBinaryHeader(dest, 0x90, 16, 0, 0xDC, 0xDD, GetItemCount());
+
+            for (JSON* child = Children.GetFirst(); !Children.IsNull(child);
+                 child = Children.GetNext(child))
+            {
+                if (isObject)
+                    PutBinaryString(dest, child->Name);
+                child->WriteBinary(dest);
+            }
+        }
+        break;
+
+    case JSON_None: OVR_ASSERT_LOG(false, ("Bad JSON type.")); break;
+    }
+}
+
+// Decodes one value into this node and returns the position after it.
+const uint8_t* JSON::parseBinary(const uint8_t* p, const uint8_t* end, const char** perror)
+{
+    if (p >= end)
+    {
+        AssignError(perror, "Binary Error: Unexpected end of data");
+        return NULL;
+    }
+
+    uint8_t tag   = *p;
+    size_t  count = 0;
+    int     bytes = 0;
+
+    // Strings share their header decoding with member names.
+    if ((tag & 0xE0) == 0xA0 || tag == 0xD9 || tag == 0xDA || tag == 0xDB)
+    {
+        Type = JSON_String;
+        return GetBinaryString(p, end, Value, perror);
+    }
+    p++;
+
+    if (tag <= 0x7F || tag >= 0xE0)
+    {
+        Type   = JSON_Number;
+        dValue = (tag <= 0x7F) ? (double)tag : (double)(int8_t)tag;
+    }
+    else if ((tag & 0xE0) == 0x80)
+    {
+        // fixmap 0x80-0x8F and fixarray 0x90-0x9F
+        Type  = (tag & 0x10) ? JSON_Array : JSON_Object;
+        count = tag & 0x0F;
+    }
+    else
+    {
+        switch (tag)
+        {
+        case 0xC0: Type = JSON_Null; return p;
+        case 0xC2:
+        case 0xC3:
+            Type   = JSON_Bool;
+            dValue = (tag == 0xC3) ? 1. : 0.;
+            Value  = (tag == 0xC3) ? "true" : "false";
+            return p;
+
+        case 0xCA: case 0xCB:
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+            Type  = JSON_Number;
+            bytes = (tag == 0xCA) ? 4 : (tag == 0xCB) ? 8 : 1 << ((tag - 0xCC) & 3);
+            break;
+
+        case 0xDC: case 0xDE: Type = (tag == 0xDC) ? JSON_Array : JSON_Object; bytes = 2; break;
+        case 0xDD: case 0xDF: Type = (tag == 0xDD) ? JSON_Array : JSON_Object; bytes = 4; break;
+
+        default:
+            AssignError(perror, "Binary Error: Unsupported type");
+            return NULL;
+        }
+
+        if (end - p < bytes)
+        {
+            AssignError(perror, "Binary Error: Unexpected end of data");
+            return NULL;
+        }
+        uint64_t raw = GetBinary(p, bytes);
+        p += bytes;
+
+        if (Type != JSON_Number)
+        {
+            count = (size_t)raw;
+        }
+        else if (tag == 0xCA)
+        {
+            uint32_t bits = (uint32_t)raw;
+            float    f;
+            memcpy(&f, &bits, sizeof(f));
+            dValue = f;
+        }
+        else if (tag == 0xCB)
+        {
+            memcpy(&dValue, &raw, sizeof(dValue));
+        }
+        else if (tag >= 0xD0)
+        {
+            // Sign-extend from the encoded width.
+            int shift = 64 - bytes * 8;
+            dValue = (double)((int64_t)(raw << shift) >> shift);
+        }
+        else
+        {
+            dValue = (double)raw;
+        }
+    }
+
+    if (Type == JSON_Number)
+    {
+        char buffer[OVR_FormatDoubleBufferSize];
+        FormatNumber(buffer, sizeof(buffer), dValue);
+        Value = buffer;
+        return p;
+    }
+
+    // Every element takes at least one byte, which bounds hostile counts.
+    if (count > (size_t)(end - p))
+    {
+        AssignError(perror, "Binary Error: Unexpected end of data");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        JSON* child = createNode(NULL);
+        if (!child)
+        {
+            AssignError(perror, "Error: Failed to allocate memory");
+            return NULL;
+        }
+        Children.PushBack(child);
+
+        if (Type == JSON_Object)
+        {
+            p = GetBinaryString(p, end, child->Name, perror);
+            if (!p)
+                return NULL;
+        }
+        p = child->parseBinary(p, end, perror);
+        if (!p)
+            return NULL;
+    }
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// Decodes a binary encoded tree. The returned object must be Released after use.
+JSON* JSON::ParseBinary(const uint8_t* data, size_t len, const char** perror, size_t* pused)
+{
+    if (perror)
+        *perror = 0;
+    if (!data)
+        return NULL;
+
+    JSON* json = createNode(NULL);
+    if (!json)
+    {
+        AssignError(perror, "Error: Failed to allocate memory");
+        return NULL;
+    }
+
+    const uint8_t* end = json->parseBinary(data, data + len, perror);
+    if (end && !pused && end != data + len)
+        end = (const uint8_t*)AssignError(perror, "Binary Error: Unexpected data after value");
+    if (!end)
+    {
+        json->Release();
+        return NULL;
+    }
+
+    if (pused)
+        *pused = (size_t)(end - data);
+    return json;
+}
+
+bool JSON::WriteBinary(File* file)
+{
+    ArrayPOD<uint8_t> buffer;
+    WriteBinary(buffer);
+
+    int len = (int)buffer.GetSize();
+    return file->Write(buffer.GetDataPtr(), len) == len;
+}
+
+JSON* JSON::ReadBinary(File* file, const char** perror)
+{
+    int pos = file->Tell();
+    int len = file->GetLength() - pos;
+    if (len <= 0)
+    {
+        AssignError(perror, "Binary Error: Unexpected end of data");
+        return NULL;
+    }
+
+    uint8_t* buff = (uint8_t*)OVR_ALLOC(len);
+    if (!buff)
+    {
+        AssignError(perror, "Error: Failed to allocate memory");
+        return NULL;
+    }
+
+    size_t used = 0;
+    JSON*  json = NULL;
+    if (file->Read(buff, len) == len)
+        json = ParseBinary(buff, len, perror, &used);
+    else
+        AssignError(perror, "Failed to read file");
+    OVR_FREE(buff);
+
+    // Leave the file positioned after the value, so values can be sequenced.
+    file->Seek(pos + (int)used);
+    return json;
+}
+
+JSON* JSON::LoadBinary(const char* path, const char** perror)
+{
+    SysFile f;
+    if (!f.Open(path, File::Open_Read, File::Mode_Read))
+    {
+        AssignError(perror, "Failed to open file");
+        return NULL;
+    }
+
+    JSON* json = ReadBinary(&f, perror);
+    f.Close();
+    return json;
+}
+
+bool JSON::SaveBinary(const char* path)
+{
+    SysFile f;
+    if (!f.Open(path, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_Write))
+        return false;
+
+    bool result = WriteBinary(&f);
+    f.Close();
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONWriter
+
+// Chunk size used when streaming to a file.
+static const size_t JSONWriterFileChunk = 4096;
+
+JSONWriter::JSONWriter(bool fmt)
+  : pFile(NULL), Format(fmt), Failed(false), BaseDepth(0),
+    pBuffer(NULL), Size(0), Capacity(0)
+{
+}
+
+JSONWriter::JSONWriter(File* file, bool fmt)
+  : pFile(file), Format(fmt), Failed(false), BaseDepth(0),
+    pBuffer(NULL), Size(0), Capacity(0)
+{
+    pBuffer = (char*)OVR_ALLOC(JSONWriterFileChunk);
+    if (pBuffer)
+        Capacity = JSONWriterFileChunk;
+    else
+        Failed = true;
+}
+
+JSONWriter::~JSONWriter()
+{
+    if (pFile)
+        flushBuffer();
+    if (pBuffer)
+        OVR_FREE(pBuffer);
+}
+
+bool JSONWriter::flushBuffer()
+{
+    if (pFile && Size && !Failed)
+    {
+        if (pFile->Write((uint8_t*)pBuffer, (int)Size) != (int)Size)
+            Failed = true;
+    }
+    Size = 0;
+    return !Failed;
+}
+
+bool JSONWriter::Flush()
+{
+    OVR_ASSERT(pFile);
+    return flushBuffer();
+}
+
+void JSONWriter::write(const char* data, size_t len)
+{
+    if (Failed)
+        return;
+
+    if (Size + len > Capacity)
+    {
+        if (pFile)
+        {
+            // Large runs bypass the chunk buffer entirely.
+            if (!flushBuffer())
+                return;
+            if (len > Capacity)
+            {
+                if (pFile->Write((const uint8_t*)data, (int)len) != (int)len)
+                    Failed = true;
+                return;
+            }
+        }
+        else
+        {
+            // One byte is always kept spare for the terminator.
+            size_t newCapacity = Capacity ? Capacity * 2 : 256;
+            while (Size + len > newCapacity)
+                newCapacity *= 2;
+
+            char* newBuffer = (char*)OVR_REALLOC(pBuffer, newCapacity + 1);
+            if (!newBuffer)
+            {
+                Failed = true;
+                return;
+            }
+            pBuffer  = newBuffer;
+            Capacity = newCapacity;
+        }
+    }
+
+    memcpy(pBuffer + Size, data, len);
+    Size += len;
+}
+
+void JSONWriter::writeNewLine()
+{
+#ifdef OVR_OS_WIN32
+    write("\r\n", 2);
+#else
+    write('\n');
+#endif
+}
+
+void JSONWriter::writeTabs(int count)
+{
+    for (int i = 0; i < count; i++)
+        write('\t');
+}
+
+void JSONWriter::writeEscaped(const char* s)
+{
+    write('\"');
+
+    // Unescaped runs are copied in one go.
+    const char* run = s;
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c > 31 && c != '\"' && c != '\\')
+            continue;
+
+        write(run, s - run);
+        run = s + 1;
+
+        char escape[8];
+        switch (c)
+        {
+            case '\\': write("\\\\", 2); break;
+            case '\"':  write("\\\"", 2); break;
+            case '\b':  write("\\b", 2);  break;
+            case '\f':  write("\\f", 2);  break;
+            case '\n':  write("\\n", 2);  break;
+            case '\r':  write("\\r", 2);  break;
+            case '\t':  write("\\t", 2);  break;
+            default:
+                OVR_sprintf(escape, sizeof(escape), "\\u%04x", c);
+                write(escape, 6);
+                break;
+        }
+    }
+    write(run, s - run);
+
+    write('\"');
+}
+
+// Emits the separator that precedes a value in the enclosing array.
+// Values inside objects are separated by WriteKey.
+void JSONWriter::beginValue()
+{
+    if (Scopes.GetSize() == 0)
+        return;
+
+    Scope& scope = Scopes.Back();
+    OVR_ASSERT(!scope.IsObject || scope.Count > 0);
+    if (!scope.IsObject)
+    {
+        if (scope.Count++ > 0)
+        {
+            write(',');
+            if (Format)
+                write(' ');
+        }
+    }
+}
+
+void JSONWriter::BeginObject()
+{
+    beginValue();
+    write('{');
+    Scope scope = { true, 0 };
+    Scopes.PushBack(scope);
+}
+
+void JSONWriter::EndObject()
+{
+    OVR_ASSERT(Scopes.GetSize() && Scopes.Back().IsObject);
+    unsigned count = Scopes.Back().Count;
+    Scopes.PopBack();
+
+    if (Format)
+    {
+        int depth = BaseDepth + (int)Scopes.GetSize();
+        if (count)
+        {
+            writeNewLine();
+            writeTabs(depth);
+        }
+        else
+        {
+            write('\n');
+            writeTabs(depth - 1);
+        }
+    }
+    write('}');
+}
+
+void JSONWriter::BeginArray()
+{
+    beginValue();
+    write('[');
+    Scope scope = { false, 0 };
+    Scopes.PushBack(scope);
+}
+
+void JSONWriter::EndArray()
+{
+    OVR_ASSERT(Scopes.GetSize() && !Scopes.Back().IsObject);
+    Scopes.PopBack();
+    write(']');
+}
+
+void JSONWriter::WriteKey(const char* name)
+{
+    OVR_ASSERT(Scopes.GetSize() && Scopes.Back().IsObject);
+    Scope& scope = Scopes.Back();
+    if (scope.Count++ > 0)
+        write(',');
+
+    if (Format)
+    {
+        writeNewLine();
+        writeTabs(BaseDepth + (int)Scopes.GetSize());
+    }
+    writeEscaped(name);
+    write(':');
+    if (Format)
+        write('\t');
+}
+
+void JSONWriter::WriteNull()
+{
+    beginValue();
+    write("null", 4);
+}
+
+void JSONWriter::WriteBool(bool b)
+{
+    beginValue();
+    if (b)
+        write("true", 4);
+    else
+        write("false", 5);
+}
+
+void JSONWriter::WriteNumber(double d)
+{
+    char buffer[OVR_FormatDoubleBufferSize];
+
+    beginValue();
+    FormatNumber(buffer, sizeof(buffer), d);
+    write(buffer, OVR_strlen(buffer));
+}
+
+void JSONWriter::WriteString(const char* s)
+{
+    beginValue();
+    writeEscaped(s);
+}
+
+void JSONWriter::WriteValue(JSON* item)
+{
+    switch (item->Type)
+    {
+    case JSON_Null:   WriteNull(); break;
+    case JSON_Bool:   WriteBool((int)item->dValue != 0); break;
+    case JSON_Number: WriteNumber(item->dValue); break;
+    case JSON_String: WriteString(item->Value); break;
+
+    case JSON_Array:
+        {
+            BeginArray();
+            for (JSON* child = item->Children.GetFirst(); !item->Children.IsNull(child);
+                 child = item->Children.GetNext(child))
+            {
+                WriteValue(child);
+            }
+            EndArray();
+        }
+        break;
+
+    case JSON_Object:
+        {
+            BeginObject();
+            for (JSON* child = item->Children.GetFirst(); !item->Children.IsNull(child);
+                 child = item->Children.GetNext(child))
+            {
+                WriteKey(child->Name);
+                WriteValue(child);
+            }
+            EndObject();
+        }
+        break;
+
+    case JSON_None: OVR_ASSERT_LOG(false, ("Bad JSON type.")); break;
+    }
+}
+
+const char* JSONWriter::GetText()
+{
+    OVR_ASSERT(!pFile);
+    if (!pBuffer)
+        return "";
+    pBuffer[Size] = 0;
+    return pBuffer;
+}
+
+char* JSONWriter::DetachText()
+{
+    OVR_ASSERT(!pFile);
+    if (Failed)
+        return NULL;
+
+    char* text = pBuffer;
+    if (!text)
+    {
+        text = (char*)OVR_ALLOC(1);
+        if (!text)
+            return NULL;
+    }
+    text[Size] = 0;
+
+    pBuffer  = NULL;
+    Size     = 0;
+    Capacity = 0;
+    return text;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONReader
+
+JSONReader::JSONReader(const char* text)
+  : pText(text), pError(NULL), Event(Event_End), Number(0.),
+    Started(false), RootDone(false)
+{
+    NameBuffer.PushBack(0);
+    ValueBuffer.PushBack(0);
+}
+
+JSONReader::EventType JSONReader::fail(const char* error)
+{
+    pError = error;
+    Event  = Event_Error;
+    return Event;
+}
+
+// Decodes the quoted string at pText into dest and advances past it.
+bool JSONReader::readString(ArrayPOD<char>& dest)
+{
+    if (*pText != '\"')
+    {
+        fail("Syntax Error: Missing quote");
+        return false;
+    }
+
+    // Reject unterminated strings rather than reading to the end of the text.
+    const char* end = pText + 1;
+    while (*end && *end != '\"')
+    {
+        if (*end++ == '\\' && *end)
+            end++;
+    }
+    if (*end != '\"')
+    {
+        fail("Syntax Error: Missing closing quote");
+        return false;
+    }
+
+    size_t len = MeasureString(pText);
+    dest.Resize(len + 1);
+    pText = UnescapeString(pText, dest.GetDataPtr(), &len);
+    dest.Resize(len + 1);
+    dest[len] = 0;
+    return true;
+}
+
+JSONReader::EventType JSONReader::readValue()
+{
+    const char* p = pText;
+    Event = Event_Error;
+
+    if (!strncmp(p, "null", 4))
+    {
+        pText = p + 4;
+        Event = Event_Null;
+    }
+    else if (!strncmp(p, "false", 5))
+    {
+        pText  = p + 5;
+        Number = 0.;
+        Event  = Event_Bool;
+    }
+    else if (!strncmp(p, "true", 4))
+    {
+        pText  = p + 4;
+        Number = 1.;
+        Event  = Event_Bool;
+    }
+    else if (*p == '\"')
+    {
+        if (!readString(ValueBuffer))
+            return Event;
+        Event = Event_String;
+    }
+    else if (*p == '-' || (*p >= '0' && *p <= '9'))
+    {
+        const char* end = ParseJSONNumber(p, &Number);
+        if (end == p)
+            return fail("Syntax Error: Invalid number");
+
+        ValueBuffer.Resize(end - p + 1);
+        memcpy(ValueBuffer.GetDataPtr(), p, end - p);
+        ValueBuffer[end - p] = 0;
+        pText = end;
+        Event = Event_Number;
+    }
+    else if (*p == '[' || *p == '{')
+    {
+        Scope scope = { *p == '{', 0 };
+        Scopes.PushBack(scope);
+        pText = p + 1;
+        return Event = scope.IsObject ? Event_BeginObject : Event_BeginArray;
+    }
+    else
+    {
+        return fail("Syntax Error: Invalid syntax");
+    }
+
+    if (Scopes.GetSize() == 0)
+        RootDone = true;
+    return Event;
+}
+
+JSONReader::EventType JSONReader::Next()
+{
+    if (Event == Event_Error)
+        return Event;
+    if (RootDone)
+        return Event = Event_End;
+
+    Started = true;
+    pText   = skip(pText);
+    NameBuffer.Resize(1);
+    NameBuffer[0] = 0;
+
+    if (Scopes.GetSize() == 0)
+    {
+        if (!*pText)
+            return fail("Syntax Error: No value");
+        return readValue();
+    }
+
+    Scope& scope = Scopes.Back();
+    if (*pText == (scope.IsObject ? '}' : ']'))
+    {
+        bool isObject = scope.IsObject;
+        pText++;
+        Scopes.PopBack();
+        if (Scopes.GetSize() == 0)
+            RootDone = true;
+        return Event = isObject ? Event_EndObject : Event_EndArray;
+    }
+
+    if (scope.Count++ > 0 || !*pText)
+    {
+        if (*pText != ',')
+            return fail(scope.IsObject ? "Syntax Error: Missing closing brace"
+                                       : "Syntax Error: Missing ending bracket");
+        pText = skip(pText + 1);
+    }
+
+    if (scope.IsObject)
+    {
+        if (!readString(NameBuffer))
+            return Event;
+        pText = skip(pText);
+        if (*pText != ':')
+            return fail("Syntax Error: Missing colon");
+        pText = skip(pText + 1);
+    }
+
+    return readValue();
+}
+
+bool JSONReader::SkipContainer()
+{
+    if (Event != Event_BeginObject && Event != Event_BeginArray)
         return false;
+
+    // Step through the contents so malformed text fails here, not when the
+    // container is read later; no nodes are built.
+    size_t depth = Scopes.GetSize();
+    while (Next() != Event_Error)
+    {
+        if (Scopes.GetSize() < depth)
+            return true;
     }
+    return false;
 }
 
 
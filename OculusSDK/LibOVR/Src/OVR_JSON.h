@@ -32,6 +32,7 @@ limitations under the License.
 #include "Kernel/OVR_RefCount.h"
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_List.h"
+#include "Kernel/OVR_Array.h"
 
 namespace OVR {  
 
@@ -48,17 +49,27 @@ enum JSONItemType
     JSON_Object    = 6
 };
 
+class JSONArena;
+struct JSONIndex;
+class JSONReader;
+class File;
+
 //-----------------------------------------------------------------------------
 // ***** JSON
 
 // JSON object represents a JSON node that can be either a root of the JSON tree
 // or a child item. Every node has a type that describes what is is.
 // New JSON trees are typically loaded JSON::Load or created with JSON::Parse.
+//
+// Parsed trees may have their nodes allocated from a single arena block
+// (see ParseArena).  Such nodes are still reference counted individually;
+// the block is freed when the last of its nodes is released.
 
 class JSON : public RefCountBase<JSON>, public ListNode<JSON>
 {
 protected:
     List<JSON>      Children;
+    JSONIndex*      pIndex;     // Lazily built child lookup tables, or NULL.
 
 public:
     JSONItemType    Type;       // Type of this JSON node.
@@ -86,13 +97,45 @@ public:
 	// This version works for buffers that are not null terminated strings.
 	static JSON*	ParseBuffer(const char *buff, int len, const char** perror = 0);
 
+    // Parses like Parse, but allocates all nodes of the tree from one block.
+    static JSON*    ParseArena(const char* buff, const char** perror = 0);
+
+    // Arena parse that also decodes strings in place, overwriting buff.
+    // Use when the caller owns a writable copy of the text.
+    static JSON*    ParseInSitu(char* buff, const char** perror = 0);
+
+    // Builds a tree from the value at the reader's current event, consuming it
+    // through its end event; a fresh reader is advanced to its first value.
+    // Useful for materializing only part of a document being streamed.
+    static JSON*    Read(JSONReader& reader, const char** perror = 0);
+
     // Loads and parses a JSON object from a file.
     // Returns 0 and assigns perror with error message on fail.
     static JSON*    Load(const char* path, const char** perror = 0);
 
-    // Saves a JSON object to a file.
+    // Saves a JSON object to a file, streaming it through a JSONWriter.
     bool            Save(const char* path);
 
+    // *** Binary Encoding
+
+    // Trees can also be stored in a compact binary form that is a subset of
+    // MessagePack: nil, bool, int, float32/64, str, array and map with string
+    // keys. Numbers round-trip exactly; their Value text is regenerated.
+
+    // Appends the binary encoding of this tree to dest.
+    void            WriteBinary(ArrayPOD<uint8_t>& dest);
+    // Writes the binary encoding at the current file position.
+    bool            WriteBinary(File* file);
+    // Decodes one tree from data. If pused is given it receives the number of
+    // bytes consumed, otherwise trailing bytes are an error.
+    static JSON*    ParseBinary(const uint8_t* data, size_t len, const char** perror = 0, size_t* pused = 0);
+    // Decodes one tree from the current file position and leaves the file
+    // positioned after it.
+    static JSON*    ReadBinary(File* file, const char** perror = 0);
+
+    static JSON*    LoadBinary(const char* path, const char** perror = 0);
+    bool            SaveBinary(const char* path);
+
     // *** Object Member Access
 
     // These provide access to child items of the list.
@@ -101,7 +144,11 @@ public:
     JSON*           GetFirstItem()           { return (!Children.IsEmpty()) ? Children.GetFirst() : 0; }
     JSON*           GetLastItem()            { return (!Children.IsEmpty()) ? Children.GetLast() : 0; }
 
-    // Counts the number of items in the object; these methods are inefficient.
+    // Counts the number of items in the object.
+    // Objects and arrays with more than a few children build an index on
+    // first use, so repeated lookups by index or name are constant time.
+    // The index is dropped by the Add/Insert/Remove functions below; children
+    // must not be unlinked or renamed directly while they are in the list.
     unsigned        GetItemCount() const;
     JSON*           GetItemByIndex(unsigned i);
     JSON*           GetItemByName(const char* name);
@@ -127,6 +174,8 @@ public:
 //    void            ReplaceItem(unsigned index, JSON* new_item);
 //    void            DeleteItem(unsigned index);
     void            RemoveLast();
+    // Removes and releases the given child item.
+    void            RemoveItem(JSON* item);
 
     // *** Array Element Access
 
@@ -144,19 +193,187 @@ public:
 
     JSON*           Copy();  // Create a copy of this object
 
+    // Nodes are prefixed with a header naming the arena they came from, if any,
+    // so that operator delete can return them to the right place.
+    void*           operator new(size_t sz);
+    void*           operator new(size_t sz, const char* file, int line);
+    void*           operator new(size_t sz, JSONArena* arena);
+    void            operator delete(void* p);
+    void            operator delete(void* p, const char* file, int line);
+    void            operator delete(void* p, JSONArena* arena);
+
 protected:
     JSON(JSONItemType itemType = JSON_Object);
 
+    static JSON*    createNode(JSONArena* arena);
+
+    void            invalidateIndex();
+    void            buildNameIndex();
+    void            buildItemIndex();
+    static JSON*    parseRoot(const char* buff, const char** perror, JSONArena* arena);
+
     // JSON Parsing helper functions.
-    const char*     parseValue(const char *buff, const char** perror);
-    const char*     parseNumber(const char *num);
-    const char*     parseArray(const char* value, const char** perror);
-    const char*     parseObject(const char* value, const char** perror);
-    const char*     parseString(const char* str, const char** perror);
+    const char*     parseValue(const char *buff, const char** perror, JSONArena* arena);
+    const char*     parseNumber(const char *num, const char** perror);
+    const char*     parseArray(const char* value, const char** perror, JSONArena* arena);
+    const char*     parseObject(const char* value, const char** perror, JSONArena* arena);
+    const char*     parseString(const char* str, const char** perror, String& dest, JSONArena* arena);
+    const uint8_t*  parseBinary(const uint8_t* data, const uint8_t* end, const char** perror);
 
     char*           PrintValue(int depth, bool fmt);
-    char*           PrintObject(int depth, bool fmt);
-    char*           PrintArray(int depth, bool fmt);
+
+    friend class JSONWriter;
+};
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONWriter
+
+// Streams JSON text to a growable memory buffer or to a File, without building
+// intermediate strings. Values are written in document order; inside an object
+// each value must be preceded by WriteKey. Formatted output matches JSON::Save.
+
+class JSONWriter
+{
+public:
+    // Writes to an internal buffer; see GetText and DetachText.
+    JSONWriter(bool fmt = true);
+    // Writes to an open file in chunks; call Flush when done.
+    JSONWriter(File* file, bool fmt = true);
+    ~JSONWriter();
+
+    void            BeginObject();
+    void            EndObject();
+    void            BeginArray();
+    void            EndArray();
+    void            WriteKey(const char* name);
+    void            WriteNull();
+    void            WriteBool(bool b);
+    void            WriteNumber(double d);
+    void            WriteString(const char* s);
+    // Writes a whole tree.
+    void            WriteValue(JSON* item);
+
+    // Writes buffered text to the file. Returns false if any write failed.
+    bool            Flush();
+
+    // Memory mode only: the text written so far, null-terminated.
+    const char*     GetText();
+    size_t          GetLength() const       { return Size; }
+    // Memory mode only: returns the text, to be freed with OVR_FREE.
+    char*           DetachText();
+
+    // Indentation level of the first value, for text embedded in a document.
+    void            SetBaseDepth(int depth) { BaseDepth = depth; }
+
+private:
+    struct Scope
+    {
+        bool        IsObject;
+        unsigned    Count;
+    };
+
+    File*           pFile;
+    bool            Format;
+    bool            Failed;
+    int             BaseDepth;
+    char*           pBuffer;
+    size_t          Size;
+    size_t          Capacity;
+    ArrayPOD<Scope> Scopes;
+
+    void            beginValue();
+    void            writeNewLine();
+    void            writeTabs(int count);
+    void            writeEscaped(const char* s);
+    void            write(const char* data, size_t len);
+    void            write(char c)           { if (Size < Capacity) pBuffer[Size++] = c; else write(&c, 1); }
+    bool            flushBuffer();
+
+    OVR_NON_COPYABLE(JSONWriter);
+};
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONReader
+
+// Pull parser that reports JSON text as a sequence of events without building
+// JSON nodes. The text must be null-terminated and remain valid while reading.
+//
+//     JSONReader reader(text);
+//     while (reader.Next() > JSONReader::Event_End)
+//     {
+//         if (reader.GetEvent() == JSONReader::Event_Number && !strcmp(reader.GetName(), "IPD"))
+//             ipd = reader.GetNumber();
+//     }
+
+class JSONReader
+{
+public:
+    enum EventType
+    {
+        Event_Error,
+        Event_End,          // The root value is complete
+        Event_BeginObject,
+        Event_EndObject,
+        Event_BeginArray,
+        Event_EndArray,
+        Event_Null,
+        Event_Bool,
+        Event_Number,
+        Event_String
+    };
+
+    JSONReader(const char* text);
+
+    // Advances to the next event and returns it.
+    EventType       Next();
+    // After Event_BeginObject or Event_BeginArray, skips to the matching end event.
+    // Returns false if the contents are not valid JSON.
+    bool            SkipContainer();
+
+    EventType       GetEvent() const        { return Event; }
+    // Number of containers enclosing the current event.
+    int             GetDepth() const        { return (int)Scopes.GetSize(); }
+    // Text position just past the current event.
+    const char*     GetPosition() const     { return pText; }
+
+    // Member name of the current event when inside an object, otherwise "".
+    const char*     GetName() const         { return NameBuffer.GetDataPtr(); }
+    size_t          GetNameLength() const   { return NameBuffer.GetSize() - 1; }
+    // Unescaped text for Event_String; the number as written for Event_Number.
+    const char*     GetString() const       { return ValueBuffer.GetDataPtr(); }
+    size_t          GetStringLength() const { return ValueBuffer.GetSize() - 1; }
+    // Value for Event_Number, or 0/1 for Event_Bool.
+    double          GetNumber() const       { return Number; }
+    bool            GetBool() const         { return Number != 0.; }
+
+    // Description of the failure after Event_Error.
+    const char*     GetError() const        { return pError; }
+
+private:
+    struct Scope
+    {
+        bool        IsObject;
+        unsigned    Count;
+    };
+
+    const char*     pText;
+    const char*     pError;
+    EventType       Event;
+    double          Number;
+    bool            Started;
+    bool            RootDone;
+    ArrayPOD<Scope> Scopes;
+    ArrayPOD<char>  NameBuffer;
+    ArrayPOD<char>  ValueBuffer;
+
+    EventType       readValue();
+    bool            readString(ArrayPOD<char>& dest);
+    EventType       fail(const char* error);
+
+    friend class JSON;
+    OVR_NON_COPYABLE(JSONReader);
 };
 
 
@@ -286,7 +286,9 @@ template<> ProfileManager* OVR::SystemSingletonBase<ProfileManager>::SlowGetInst
 }
 
 ProfileManager::ProfileManager(bool sys_register) :
-    Changed(false)
+    Changed(false),
+    LazyLoad(false),
+    ProfileText(NULL)
 {
     // Attempt to get the base path automatically, but this may fail
     BasePath = GetBaseOVRPath(false);
@@ -321,6 +323,13 @@ void ProfileManager::ClearProfileData()
     Lock::Locker lockScope(&ProfileLock);
 
     ProfileCache.Clear();
+    ProfileTables.Clear();
+    PendingSections.Clear();
+    if (ProfileText)
+    {
+        OVR_FREE(ProfileText);
+        ProfileText = NULL;
+    }
     Changed = false;
 }
 
@@ -332,8 +341,11 @@ void ProfileManager::Save()
     if (ProfileCache == NULL)
         return;
 
+    LoadAllSections();
+
     // Save the profile to disk
     BasePath = GetBaseOVRPath(true);  // create the base directory if it doesn't exist
+    ProfileTables.Clear();            // device files are found relative to BasePath
     String path = GetProfilePath();
     ProfileCache->Save(path);
     Changed = false;
@@ -393,6 +405,12 @@ void ProfileManager::Read()
     LoadCache(false);
 }
 
+void ProfileManager::SetLazyLoad(bool lazy)
+{
+    Lock::Locker lockScope(&ProfileLock);
+    LazyLoad = lazy;
+}
+
 // Populates the local profile cache.  This occurs on the first access of the profile
 // data.  All profile operations are performed against the local cache until the
 // ProfileManager is released or goes out of scope at which time the cache is serialized
@@ -405,7 +423,7 @@ void ProfileManager::LoadCache(bool create)
 
     String path = GetProfilePath();
 
-    Ptr<JSON> root = *JSON::Load(path);
+    Ptr<JSON> root = *(LazyLoad ? LoadLazyCache(path) : JSON::Load(path));
     if (root == NULL)
     {   
         path = BasePath + "/Profiles.json";  // look for legacy profile
@@ -460,6 +478,154 @@ void ProfileManager::LoadCache(bool create)
     }
 }
 
+// Reads the profile database without parsing the values of the TaggedData
+// entries. Their text is kept in ProfileText and indexed in PendingSections.
+JSON* ProfileManager::LoadLazyCache(const String& path)
+{
+    SysFile f;
+    if (!f.Open(path, File::Open_Read, File::Mode_Read))
+        return NULL;
+
+    int   len  = f.GetLength();
+    char* text = (char*)OVR_ALLOC(len + 1);
+    if (!text)
+        return NULL;
+
+    int bytes = f.Read((uint8_t*)text, len);
+    f.Close();
+    if (bytes != len)
+    {
+        OVR_FREE(text);
+        return NULL;
+    }
+    text[len] = 0;
+
+    JSONReader reader(text);
+    JSON*      root = NULL;
+    bool       ok   = (reader.Next() == JSONReader::Event_BeginObject);
+
+    if (ok)
+        root = JSON::CreateObject();
+
+    while (ok && reader.Next() != JSONReader::Event_EndObject)
+    {
+        String name = reader.GetName();
+
+        if (reader.GetEvent() == JSONReader::Event_BeginArray && name == "TaggedData")
+        {
+            JSON* data = JSON::CreateArray();
+            root->AddItem(name, data);
+
+            while (ok && reader.Next() == JSONReader::Event_BeginObject)
+            {
+                JSON* entry = JSON::CreateObject();
+                data->AddArrayElement(entry);
+
+                while (ok && reader.Next() != JSONReader::Event_EndObject)
+                {
+                    String entry_name = reader.GetName();
+
+                    if (reader.GetEvent() == JSONReader::Event_BeginObject && entry_name == "vals")
+                    {   // Remember where the values are, from the opening brace
+                        PendingSection section;
+                        section.Entry  = entry;
+                        section.Offset = (reader.GetPosition() - 1) - text;
+                        ok             = reader.SkipContainer();
+                        PendingSections.PushBack(section);
+                    }
+                    else
+                    {
+                        JSON* item = JSON::Read(reader);
+                        if (item)
+                            entry->AddItem(entry_name, item);
+                        ok = (item != NULL);
+                    }
+                }
+            }
+
+            ok = ok && (reader.GetEvent() == JSONReader::Event_EndArray);
+        }
+        else
+        {
+            JSON* item = JSON::Read(reader);
+            if (item)
+                root->AddItem(name, item);
+            ok = (item != NULL);
+        }
+    }
+
+    if (!ok)
+    {   // Leave anything unexpected to the regular parser
+        if (root)
+            root->Release();
+        PendingSections.Clear();
+        OVR_FREE(text);
+        return JSON::Load(path);
+    }
+
+    if (PendingSections.GetSize() == 0)
+        OVR_FREE(text);
+    else
+        ProfileText = text;
+
+    return root;
+}
+
+// Parses the pending values of TaggedData entries whose tags are all among
+// the given tag name/value pairs, which covers every entry a lookup with
+// those tags could match.
+void ProfileManager::LoadSections(const char** tag_names, const char** tags, int num_tags)
+{
+    for (unsigned i = 0; i < PendingSections.GetSize(); )
+    {
+        JSON* entry_tags = PendingSections[i].Entry->GetItemByName("tags");
+        bool  match = (entry_tags != NULL);
+
+        for (JSON* tag = entry_tags ? entry_tags->GetFirstItem() : NULL; tag && match;
+             tag = entry_tags->GetNextItem(tag))
+        {
+            JSON* tagval = tag->GetFirstItem();
+            match = false;
+            for (int k = 0; tagval && k < num_tags && !match; k++)
+            {
+                match = (tag_names[k] && tags[k] &&
+                         tagval->Name == tag_names[k] && tagval->Value == tags[k]);
+            }
+        }
+
+        if (match)
+            LoadSection(i);     // removes entry i
+        else
+            i++;
+    }
+}
+
+void ProfileManager::LoadAllSections()
+{
+    while (PendingSections.GetSize())
+        LoadSection(PendingSections.GetSize() - 1);
+}
+
+void ProfileManager::LoadSection(unsigned index)
+{
+    PendingSection section = PendingSections[index];
+    PendingSections.RemoveAtUnordered(index);
+
+    // Read with the same reader that checked the section in LoadLazyCache, so
+    // only running out of memory can fail here
+    JSONReader reader(ProfileText + section.Offset);
+    JSON*      vals = JSON::Read(reader);
+    OVR_ASSERT(vals);
+    if (vals)
+        section.Entry->AddItem("vals", vals);
+
+    if (PendingSections.GetSize() == 0)
+    {
+        OVR_FREE(ProfileText);
+        ProfileText = NULL;
+    }
+}
+
 void ProfileManager::LoadV1Profiles(JSON* v1)
 {
     JSON* item0 = v1->GetFirstItem();
@@ -625,6 +791,9 @@ bool ProfileManager::CreateUser(const char* user, const char* name)
             return false;
     }
 
+    // Resolved profiles may depend on what is about to change
+    ProfileTables.Clear();
+
     JSON* users = ProfileCache->GetItemByName("Users");
     if (users == NULL)
     {   // Generate the User section
@@ -751,6 +920,12 @@ bool ProfileManager::RemoveUser(const char* user)
             return true;
     }
 
+    // Resolved profiles may depend on what is about to change
+    ProfileTables.Clear();
+
+    // Entries are removed below, so none may be left pending
+    LoadAllSections();
+
     JSON* users = ProfileCache->GetItemByName("Users");
     if (users == NULL)
         return true;
@@ -762,8 +937,7 @@ bool ProfileManager::RemoveUser(const char* user)
         JSON* userid = user_item->GetItemByName("User");
         if (OVR_strcmp(user, userid->Value) == 0)
         {   // Delete the user entry
-            user_item->RemoveNode();
-            user_item->Release();
+            users->RemoveItem(user_item);
             Changed = true;
             break;
         }
@@ -777,8 +951,7 @@ bool ProfileManager::RemoveUser(const char* user)
     FilterTaggedData(tagged_data, "User", user, user_items);
     for (unsigned int i=0; i<user_items.GetSize(); i++)
     {
-        user_items[i]->RemoveNode();
-        user_items[i]->Release();
+        tagged_data->RemoveItem(user_items[i]);
         Changed = true;
     }
  
@@ -868,6 +1041,8 @@ Profile* ProfileManager::GetTaggedProfile(const char** tag_names, const char** t
     OVR_ASSERT(tagged_data);
     if (tagged_data == NULL)
         return NULL;
+
+    LoadSections(tag_names, tags, num_tags);
     
     Profile* profile = new Profile(BasePath);
     
@@ -904,11 +1079,16 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
             return false;  // TODO: Generate a new profile DB
     }
 
+    // Resolved profiles may depend on what is about to change
+    ProfileTables.Clear();
+
     JSON* tagged_data = ProfileCache->GetItemByName("TaggedData");
     OVR_ASSERT(tagged_data);
     if (tagged_data == NULL)
         return false;
 
+    LoadSections(tag_names, tags, num_tags);
+
     // Get the cached tagged data section
     JSON* vals = FindTaggedData(tagged_data, tag_names, tags, num_tags);
     if (vals == NULL)
@@ -930,9 +1110,10 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
     }
 
     // Now add or update each profile setting in cache
-    for (unsigned int i=0; i<profile->Values.GetSize(); i++)
+    const Array<JSON*>& values = profile->Table->Values;
+    for (unsigned int i=0; i<values.GetSize(); i++)
     {
-        JSON* value = profile->Values[i];
+        JSON* value = values[i];
         
         bool found = false;
         JSON* item = vals->GetFirstItem();
@@ -1055,6 +1236,35 @@ Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const cha
         if (ProfileCache == NULL)
             return NULL;
     }
+
+    // Merging the device file and the tagged user data is only done once per
+    // combination; later requests share the resolved table.
+    String key;
+    if (deviceKey.Valid)
+    {
+        char product_id[16];
+        OVR_sprintf(product_id, sizeof(product_id), "%u:", deviceKey.ProductId);
+        key = product_id;
+        key += deviceKey.PrintedSerial;
+    }
+    key += "|";
+    key += deviceKey.ProductName;
+    if (user)
+    {
+        key += "|";
+        key += user;
+    }
+
+    Ptr<ProfileValueTable>* cached = ProfileTables.Get(key);
+    if (cached)
+    {
+        if (!*cached)
+            return NULL;
+
+        Profile* profile = new Profile(BasePath);
+        profile->Table = *cached;
+        return profile;
+    }
     
     Profile* profile = new Profile(BasePath);
 
@@ -1063,6 +1273,7 @@ Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const cha
         if (!profile->LoadDeviceProfile(deviceKey) && (user == NULL))
         {
             profile->Release();
+            ProfileTables.Set(key, NULL);
             return NULL;
         }
     }
@@ -1072,21 +1283,27 @@ Profile* ProfileManager::GetProfile(const ProfileDeviceKey& deviceKey, const cha
         const char* product_str = deviceKey.ProductName.IsEmpty() ? NULL : deviceKey.ProductName.ToCStr();
         const char* serial_str = deviceKey.PrintedSerial.IsEmpty() ? NULL : deviceKey.PrintedSerial.ToCStr();
 
+        const char* tag_names[3] = { "User", "Product", "Serial" };
+        const char* tags[3]      = { user, product_str, serial_str };
+        LoadSections(tag_names, tags, 3);
+
         if (!profile->LoadProfile(ProfileCache.GetPtr(), user, product_str, serial_str))
         {
             profile->Release();
+            ProfileTables.Set(key, NULL);
             return NULL;
         }
     }
 
+    ProfileTables.Set(key, profile->Table);
     return profile;
 }
 
 
 //-----------------------------------------------------------------------------
-// ***** Profile
+// ***** ProfileValueTable
 
-Profile::~Profile()
+ProfileValueTable::~ProfileValueTable()
 {
     ValMap.Clear();
     for (unsigned int i=0; i<Values.GetSize(); i++)
@@ -1095,6 +1312,68 @@ Profile::~Profile()
     Values.Clear();
 }
 
+JSON* ProfileValueTable::Find(const char* key) const
+{
+    JSON* value = NULL;
+    ValMap.GetAlt(key, &value);
+    return value;
+}
+
+void ProfileValueTable::Set(JSON* value)
+{
+    JSON* old_value = NULL;
+    if (ValMap.Get(value->Name, &old_value))
+    {
+        for (unsigned int i=0; i<Values.GetSize(); i++)
+        {
+            if (Values[i] == old_value)
+            {
+                Values[i] = value;
+                break;
+            }
+        }
+        old_value->Release();
+    }
+    else
+    {
+        Values.PushBack(value);
+    }
+
+    ValMap.Set(value->Name, value);
+}
+
+ProfileValueTable* ProfileValueTable::Clone() const
+{
+    ProfileValueTable* table = new ProfileValueTable;
+    table->Values.Reserve(Values.GetSize());
+
+    for (unsigned int i=0; i<Values.GetSize(); i++)
+    {
+        JSON* value = Values[i]->Copy();
+        table->Values.PushBack(value);
+        table->ValMap.Set(value->Name, value);
+    }
+    return table;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** Profile
+
+Profile::Profile(String basePath) :
+    Table(*new ProfileValueTable),
+    BasePath(basePath)
+{
+}
+
+ProfileValueTable* Profile::GetWritableTable()
+{
+    // Tables handed out by the ProfileManager cache are shared; copy on first write
+    if (Table->GetRefCount() > 1)
+        Table = *Table->Clone();
+    return Table;
+}
+
 bool Profile::Close()
 {
     // TODO:
@@ -1302,8 +1581,8 @@ bool Profile::LoadProfile(JSON* root,
 //-----------------------------------------------------------------------------
 char* Profile::GetValue(const char* key, char* val, int val_length) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    JSON* value = Table->Find(key);
+    if (value)
     {
         OVR_strcpy(val, val_length, value->Value.ToCStr());
         return val;
@@ -1320,8 +1599,8 @@ const char* Profile::GetValue(const char* key)
 {
     // Non-reentrant query.  The returned buffer can only be used until the next call
     // to GetValue()
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    JSON* value = Table->Find(key);
+    if (value)
     {
         TempVal = value->Value;
         return TempVal.ToCStr();
@@ -1335,8 +1614,8 @@ const char* Profile::GetValue(const char* key)
 //-----------------------------------------------------------------------------
 int Profile::GetNumValues(const char* key) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    JSON* value = Table->Find(key);
+    if (value)
     {  
         if (value->Type == JSON_Array)
             return value->GetArraySize();
@@ -1350,8 +1629,8 @@ int Profile::GetNumValues(const char* key) const
 //-----------------------------------------------------------------------------
 bool Profile::GetBoolValue(const char* key, bool default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Bool)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Bool)
         return (value->dValue != 0);
     else
         return default_val;
@@ -1360,8 +1639,8 @@ bool Profile::GetBoolValue(const char* key, bool default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetIntValue(const char* key, int default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Number)
         return (int)(value->dValue);
     else
         return default_val;
@@ -1370,8 +1649,8 @@ int Profile::GetIntValue(const char* key, int default_val) const
 //-----------------------------------------------------------------------------
 float Profile::GetFloatValue(const char* key, float default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Number)
         return (float)(value->dValue);
     else
         return default_val;
@@ -1380,8 +1659,8 @@ float Profile::GetFloatValue(const char* key, float default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
         JSON* item = value->GetFirstItem();
@@ -1408,8 +1687,8 @@ int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 //-----------------------------------------------------------------------------
 double Profile::GetDoubleValue(const char* key, double default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Number)
         return value->dValue;
     else
         return default_val;
@@ -1418,8 +1697,8 @@ double Profile::GetDoubleValue(const char* key, double default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetDoubleValues(const char* key, double* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    JSON* value = Table->Find(key);
+    if (value && value->Type == JSON_Array)
     {
         int val_count = Alg::Min(value->GetArraySize(), num_vals);
         JSON* item = value->GetFirstItem();
@@ -1455,9 +1734,7 @@ void Profile::SetValue(JSON* val)
     else if (val->Type == JSON_Array)
     {
         // Create a copy of the array
-        JSON* value = val->Copy();
-        Values.PushBack(value);
-        ValMap.Set(value->Name, value);
+        GetWritableTable()->Set(val->Copy());
     }
 }
 
@@ -1467,8 +1744,9 @@ void Profile::SetValue(const char* key, const char* val)
     if (key == NULL || val == NULL)
         return;
 
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValueTable* table = GetWritableTable();
+    JSON* value = table->Find(key);
+    if (value)
     {
         value->Value = val;
     }
@@ -1477,8 +1755,7 @@ void Profile::SetValue(const char* key, const char* val)
         value = JSON::CreateString(val);
         value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        table->Set(value);
     }
 }
 
@@ -1488,8 +1765,9 @@ void Profile::SetBoolValue(const char* key, bool val)
     if (key == NULL)
         return;
 
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValueTable* table = GetWritableTable();
+    JSON* value = table->Find(key);
+    if (value)
     {
         value->dValue = val;
     }
@@ -1498,8 +1776,7 @@ void Profile::SetBoolValue(const char* key, bool val)
         value = JSON::CreateBool(val);
         value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        table->Set(value);
     }
 }
 
@@ -1518,9 +1795,10 @@ void Profile::SetFloatValue(const char* key, float val)
 //-----------------------------------------------------------------------------
 void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
 {
-    JSON* value = NULL;
+    ProfileValueTable* table = GetWritableTable();
+    JSON* value = table->Find(key);
     int val_count = 0;
-    if (ValMap.Get(key, &value))
+    if (value)
     {
         if (value->Type == JSON_Array)
         {
@@ -1549,8 +1827,7 @@ void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
         value = JSON::CreateArray();
         value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        table->Set(value);
     }
 
     for (; val_count < num_vals; val_count++)
@@ -1560,8 +1837,9 @@ void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
 //-----------------------------------------------------------------------------
 void Profile::SetDoubleValue(const char* key, double val)
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValueTable* table = GetWritableTable();
+    JSON* value = table->Find(key);
+    if (value)
     {
         value->dValue = val;
     }
@@ -1570,17 +1848,17 @@ void Profile::SetDoubleValue(const char* key, double val)
         value = JSON::CreateNumber(val);
         value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        table->Set(value);
     }
 }
 
 //-----------------------------------------------------------------------------
 void Profile::SetDoubleValues(const char* key, const double* vals, int num_vals)
 {
-    JSON* value = NULL;
+    ProfileValueTable* table = GetWritableTable();
+    JSON* value = table->Find(key);
     int val_count = 0;
-    if (ValMap.Get(key, &value))
+    if (value)
     {
         if (value->Type == JSON_Array)
         {
@@ -1609,8 +1887,7 @@ void Profile::SetDoubleValues(const char* key, const double* vals, int num_vals)
         value = JSON::CreateArray();
         value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        table->Set(value);
     }
 
     for (; val_count < num_vals; val_count++)
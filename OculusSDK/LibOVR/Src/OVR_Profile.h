@@ -45,6 +45,7 @@ namespace OVR {
 
 class HMDInfo; // Opaque forward declaration
 class Profile;
+class ProfileValueTable;
 class JSON;
 
 
@@ -109,6 +110,22 @@ protected:
     bool                Changed;
     String              TempBuff;
     String              BasePath;
+
+    // Resolved values per (device, user) combination, built on first request.
+    // Null entries record combinations that have no profile.
+    // Cleared whenever the profile data changes.
+    Hash<String, Ptr<ProfileValueTable>, String::HashFunctor> ProfileTables;
+
+    // Lazy loading keeps the "vals" object of each TaggedData entry as text
+    // until a lookup with matching tags needs it.
+    struct PendingSection
+    {
+        JSON*           Entry;      // TaggedData entry the values belong to
+        size_t          Offset;     // Position of the "vals" text
+    };
+    bool                LazyLoad;
+    char*               ProfileText;
+    ArrayPOD<PendingSection> PendingSections;
     
 public:
     // In the service process it is important to set the base path because this cannot be detected automatically
@@ -132,6 +149,11 @@ public:
     // Force re-reading the settings
     void                Read();
 
+    // Defers parsing of per-user and per-device values until they are first
+    // requested, which keeps start-up cheap for databases with many users.
+    // Takes effect on the next load.
+    void                SetLazyLoad(bool lazy);
+
 protected:
     // Force writing the settings
     void                ClearProfileData();
@@ -139,11 +161,52 @@ protected:
 
     String              GetProfilePath();
     void                LoadCache(bool create);
+    JSON*               LoadLazyCache(const String& path);
+    void                LoadSections(const char** tag_names, const char** tags, int num_tags);
+    void                LoadAllSections();
+    void                LoadSection(unsigned index);
     void                LoadV1Profiles(JSON* v1);
     const char*         GetDefaultUser(const char* product, const char* serial);
 };
 
 
+//-------------------------------------------------------------------
+// ***** ProfileValueTable
+
+// The flattened key/value set behind a Profile. Values are typed JSON leaf
+// nodes or arrays, keyed by name. A table is shared by the ProfileManager cache
+// and the Profiles handed out from it, so it is treated as immutable once shared;
+// Profile copies it before its first modification.
+class ProfileValueTable : public RefCountBase<ProfileValueTable>
+{
+public:
+    // Hashes String keys and plain C strings alike, so lookups by a const char*
+    // key do not need to construct a String.
+    struct KeyHashFunctor
+    {
+        size_t operator()(const String& key) const
+        {
+            return String::BernsteinHashFunction(key.ToCStr(), key.GetSize());
+        }
+        size_t operator()(const char* key) const
+        {
+            return String::BernsteinHashFunction(key, OVR_strlen(key));
+        }
+    };
+
+    ~ProfileValueTable();
+
+    JSON*               Find(const char* key) const;
+    // Adds a value under its Name, releasing any value it replaces.
+    void                Set(JSON* value);
+    // Deep copy for a Profile that is about to be modified.
+    ProfileValueTable*  Clone() const;
+
+    OVR::Hash<String, JSON*, KeyHashFunctor>   ValMap;
+    OVR::Array<JSON*>   Values;  
+};
+
+
 //-------------------------------------------------------------------
 // ***** Profile
 
@@ -153,13 +216,11 @@ protected:
 class Profile : public RefCountBase<Profile>
 {
 protected:
-    OVR::Hash<String, JSON*, String::HashFunctor>   ValMap;
-    OVR::Array<JSON*>   Values;  
+    Ptr<ProfileValueTable> Table;
     OVR::String         TempVal;
     String              BasePath;
 
 public:
-    ~Profile();
 
     int                 GetNumValues(const char* key) const;
     const char*         GetValue(const char* key);
@@ -184,11 +245,10 @@ public:
     bool Close();
 
 protected:
-	Profile(String basePath) :
-		BasePath(basePath)
-	{
-	}
-    
+	Profile(String basePath);
+
+    // Returns the table for modification, copying it first if it is shared.
+    ProfileValueTable*  GetWritableTable();
     void                SetValue(JSON* val);
 
 	static bool         LoadProfile(const ProfileDeviceKey& deviceKey,
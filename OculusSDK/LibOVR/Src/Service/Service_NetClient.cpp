@@ -42,13 +42,22 @@ using namespace OVR::Net;
 NetClient::NetClient() :
     LatencyTesterAvailable(false),
     HMDCount(0),
-    EdgeTriggeredHMDCount(false)
+    EdgeTriggeredHMDCount(false),
+    PropertyCacheEpoch(0)
 {
     GetSession()->AddSessionListener(this);
 
     // Register RPC functions
     registerRPC();
 
+    // The service is always local; skip the socket stack if it supports shared memory
+    GetSession()->SetSharedMemoryTransport(true);
+
+    // Sockets are read on the session's I/O thread; received messages are
+    // delivered to the RPC layer from this object's thread (see Run)
+    GetSession()->SetReceiveQueueing(true);
+    GetSession()->StartIOThread(false);
+
     Start();
 
 	// Must be at end of function
@@ -77,12 +86,8 @@ int NetClient::Run()
     {
         // Note: There is no watchdog here because the watchdog is part of the private code
 
-        GetSession()->Poll(false);
-
-        if (GetSession()->GetActiveSocketsCount() == 0)
-        {
-            Thread::MSleep(10);
-        }
+        // Waits up to 10 ms for the I/O thread to queue something
+        GetSession()->ProcessReceiveQueue(0, 10);
     }
 
     return 0;
@@ -101,6 +106,9 @@ void NetClient::OnDisconnected(Connection* conn)
     OVR_DEBUG_LOG(("[NetClient] Disconnected"));
 
     EdgeTriggeredHMDCount = false;
+
+    // Nothing invalidates the cache while disconnected
+    cacheClear();
 }
 
 void NetClient::OnConnected(Connection* conn)
@@ -187,246 +195,463 @@ bool NetClient::GetRemoteProtocolVersion(int& major, int& minor, int& patch)
 
 const char* NetClient::GetStringValue(VirtualHmdId hmd, const char* key, const char* default_val)
 {
-    if (!IsConnected(true, true))
+    PropertyValue value(PropertyValue::Type_String);
+    value.StringValue = default_val;
+    if (!GetValues(hmd, &key, &value, 1))
     {
         return "";
     }
 
-    ProfileGetValue1_Str = default_val;
-
-    OVR::Net::BitStream bsOut, returnData;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
-    bsOut.Write(default_val);
-    if (!GetRPC1()->CallBlocking("GetStringValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
-    {
-		return "";
-    }
-    if (!returnData.Read(ProfileGetValue1_Str))
-    {
-        OVR_ASSERT(false);
-    }
+    ProfileGetValue1_Str = value.StringValue;
     return ProfileGetValue1_Str.ToCStr();
 }
 bool NetClient::GetBoolValue(VirtualHmdId hmd, const char* key, bool default_val)
 {
-    if (!IsConnected(true, true))
-    {
-        return default_val;
-    }
-
-    OVR::Net::BitStream bsOut, returnData;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
-    bsOut.Write(default_val);
-    if (!GetRPC1()->CallBlocking("GetBoolValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
-    {
-		return default_val;
-    }
-    uint8_t out = 0;
-    if (!returnData.Read(out))
-    {
-        OVR_ASSERT(false);
-    }
-    return out != 0;
+    PropertyValue value(PropertyValue::Type_Bool);
+    value.BoolValue = default_val;
+    GetValues(hmd, &key, &value, 1);
+    return value.BoolValue;
 }
 int NetClient::GetIntValue(VirtualHmdId hmd, const char* key, int default_val)
 {
-    if (!IsConnected(true, true))
+    PropertyValue value(PropertyValue::Type_Int);
+    value.IntValue = (int32_t)default_val;
+    GetValues(hmd, &key, &value, 1);
+    return value.IntValue;
+}
+double NetClient::GetNumberValue(VirtualHmdId hmd, const char* key, double default_val)
+{
+    PropertyValue value(PropertyValue::Type_Number);
+    value.NumberValue = default_val;
+    GetValues(hmd, &key, &value, 1);
+    return value.NumberValue;
+}
+int NetClient::GetNumberValues(VirtualHmdId hmd, const char* key, double* values, int num_vals)
+{
+    // Only the count is sent for this getter, so that is all the request holds
+    PropertyValue value(PropertyValue::Type_Numbers);
+    value.NumberValues.Resize(num_vals > 0 ? num_vals : 0);
+    if (!GetValues(hmd, &key, &value, 1))
     {
-        return default_val;
+        return 0;
     }
 
-    OVR::Net::BitStream bsOut, returnData;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
-    bsOut.Write(default_val);
-    if (!GetRPC1()->CallBlocking("GetIntValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
+    for (int i = 0; i < value.NumberValues.GetSizeI(); i++)
     {
-		return default_val;
+        values[i] = value.NumberValues[i];
     }
-    int32_t out = (int32_t)default_val;
-    if (!returnData.Read(out))
-    {
-        OVR_ASSERT(false);
-    }
-    return out;
+    return value.NumberValues.GetSizeI();
 }
-double NetClient::GetNumberValue(VirtualHmdId hmd, const char* key, double default_val)
+
+bool NetClient::SetStringValue(VirtualHmdId hmd, const char* key, const char* val)
 {
-    if (!IsConnected(true, true))
-    {
-        return default_val;
-    }
+    PropertyValue value(PropertyValue::Type_String);
+    value.StringValue = val;
+    return SetValues(hmd, &key, &value, 1);
+}
 
-    OVR::Net::BitStream bsOut, returnData;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
-    bsOut.Write(default_val);
-    if (!GetRPC1()->CallBlocking("GetNumberValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
+bool NetClient::SetBoolValue(VirtualHmdId hmd, const char* key, bool val)
+{
+    PropertyValue value(PropertyValue::Type_Bool);
+    value.BoolValue = val;
+    return SetValues(hmd, &key, &value, 1);
+}
+
+bool NetClient::SetIntValue(VirtualHmdId hmd, const char* key, int val)
+{
+    PropertyValue value(PropertyValue::Type_Int);
+    value.IntValue = (int32_t)val;
+    return SetValues(hmd, &key, &value, 1);
+}
+
+bool NetClient::SetNumberValue(VirtualHmdId hmd, const char* key, double val)
+{
+    PropertyValue value(PropertyValue::Type_Number);
+    value.NumberValue = val;
+    return SetValues(hmd, &key, &value, 1);
+}
+
+bool NetClient::SetNumberValues(VirtualHmdId hmd, const char* key, const double* vals, int num_vals)
+{
+    PropertyValue value(PropertyValue::Type_Numbers);
+    value.NumberValues.Resize(num_vals > 0 ? num_vals : 0);
+    for (int i = 0; i < value.NumberValues.GetSizeI(); i++)
     {
-		return default_val;
+        value.NumberValues[i] = vals[i];
     }
-    double out = 0.;
-    returnData.Read(out);
-    return out;
+    return SetValues(hmd, &key, &value, 1);
 }
-int NetClient::GetNumberValues(VirtualHmdId hmd, const char* key, double* values, int num_vals)
+
+bool NetClient::GetValues(VirtualHmdId hmd, const char* keys[], PropertyValue outValues[], int count)
 {
     if (!IsConnected(true, true))
     {
-        return 0;
+        return false;
     }
 
-    OVR::Net::BitStream bsOut, returnData;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
-
-    int32_t w = (int32_t)num_vals;
-    bsOut.Write(w);
+    // Filled in here and copied out only once every value is known,
+    // so a failed call or a malformed reply leaves outValues untouched
+    Array<PropertyValue> results;
+    results.Resize(count);
 
-    if (!GetRPC1()->CallBlocking("GetNumberValues_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
+    // Answer what we can from the cache and only send the misses
+    ArrayPOD<int>      misses;
+    ArrayPOD<uint32_t> versions;
+    for (int i = 0; i < count; ++i)
     {
-		return 0;
+        uint32_t version = 0;
+        if (!cacheLookup(hmd, keys[i], outValues[i], results[i], version))
+        {
+            misses.PushBack(i);
+            versions.PushBack(version);
+        }
     }
 
-    int32_t out = 0;
-    if (!returnData.Read(out))
+    const int32_t w = (int32_t)misses.GetSize();
+    if (w > 0 && serverVersionAtLeast(1, 4))
     {
-        OVR_ASSERT(false);
+        OVR::Net::BitStream bsOut, returnData;
+        bsOut.Write(hmd);
+        bsOut.Write(w);
+
+        for (int32_t j = 0; j < w; ++j)
+        {
+            bsOut.Write(keys[misses[j]]);
+            outValues[misses[j]].Serialize(&bsOut);
+        }
+
+        if (!GetRPC1()->CallBlocking("GetValues_1", &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
+        {
+            return false;
+        }
+
+        int32_t out = 0;
+        if (!returnData.Read(out) || out != w)
+        {
+            OVR_ASSERT(false);
+            return false;
+        }
+
+        for (int32_t j = 0; j < w; ++j)
+        {
+            const PropertyValue& request = outValues[misses[j]];
+            PropertyValue&       value   = results[misses[j]];
+
+            if (!value.Deserialize(&returnData) || value.Type != request.Type)
+            {
+                OVR_ASSERT(false);
+                return false;
+            }
+
+            if (value.Type == PropertyValue::Type_Numbers &&
+                value.NumberValues.GetSize() > request.NumberValues.GetSize())
+            {
+                value.NumberValues.Resize(request.NumberValues.GetSize());
+            }
+        }
     }
-    OVR_ASSERT(out >= 0 && out <= num_vals);
-    if (out < 0)
+    else
     {
-        out = 0;
+        // Servers before protocol 1.4 are asked one key at a time
+        for (int32_t j = 0; j < w; ++j)
+        {
+            if (!getValueLegacy(hmd, keys[misses[j]], outValues[misses[j]], results[misses[j]]))
+            {
+                return false;
+            }
+        }
     }
-    else if (out > num_vals)
+
+    // Every value is good, so they can be cached
+    for (int32_t j = 0; j < w; ++j)
     {
-        out = num_vals;
+        cacheStore(hmd, keys[misses[j]], outValues[misses[j]], results[misses[j]], versions[j]);
     }
 
-    for (int i = 0; i < out && i < num_vals; i++)
+    for (int i = 0; i < count; ++i)
     {
-        if (!returnData.Read(values[i]))
-        {
-            return i;
-        }
+        outValues[i] = results[i];
     }
 
-    return out;
+    return true;
 }
 
-bool NetClient::SetStringValue(VirtualHmdId hmd, const char* key, const char* val)
+bool NetClient::SetValues(VirtualHmdId hmd, const char* keys[], const PropertyValue values[], int count)
 {
     if (!IsConnected(true, true))
     {
         return false;
     }
 
-    OVR::Net::BitStream bsOut;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
+    if (serverVersionAtLeast(1, 4))
+    {
+        OVR::Net::BitStream bsOut;
+        bsOut.Write(hmd);
 
-    bsOut.Write(val);
+        int32_t w = (int32_t)count;
+        bsOut.Write(w);
 
-    if (!GetRPC1()->Signal("SetStringValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+        for (int i = 0; i < count; ++i)
+        {
+            bsOut.Write(keys[i]);
+            values[i].Serialize(&bsOut);
+        }
+
+        if (!GetRPC1()->Signal("SetValues_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+        {
+            return false;
+        }
+    }
+    else
     {
-        return false;
+        for (int i = 0; i < count; ++i)
+        {
+            if (!setValueLegacy(hmd, keys[i], values[i]))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Requests on the connection are handled in order, so the next read sees the new values
+    for (int i = 0; i < count; ++i)
+    {
+        cacheInvalidate(hmd, keys[i]);
     }
 
     return true;
 }
 
-bool NetClient::SetBoolValue(VirtualHmdId hmd, const char* key, bool val)
+bool NetClient::serverVersionAtLeast(int major, int minor)
 {
-    if (!IsConnected(true, true))
-    {
-        return false;
-    }
+    Ptr<Connection> conn = GetSession()->GetConnectionAtIndex(0);
 
-    OVR::Net::BitStream bsOut;
+    return conn &&
+           conn->RemoteMajorVersion == major &&
+           conn->RemoteMinorVersion >= minor;
+}
+
+// One-key RPCs, indexed by PropertyValue::EType
+static const char* const LegacyGetters[PropertyValue::Type_Count] =
+{
+    "GetStringValue_1", "GetBoolValue_1", "GetIntValue_1", "GetNumberValue_1", "GetNumberValues_1"
+};
+static const char* const LegacySetters[PropertyValue::Type_Count] =
+{
+    "SetStringValue_1", "SetBoolValue_1", "SetIntValue_1", "SetNumberValue_1", "SetNumberValues_1"
+};
+
+bool NetClient::getValueLegacy(VirtualHmdId hmd, const char* key, const PropertyValue& request, PropertyValue& value)
+{
+    OVR::Net::BitStream bsOut, returnData;
     bsOut.Write(hmd);
     bsOut.Write(key);
 
-    uint8_t b = val ? 1 : 0;
-    bsOut.Write(b);
+    switch (request.Type)
+    {
+    case PropertyValue::Type_String:  bsOut.Write(request.StringValue.ToCStr()); break;
+    case PropertyValue::Type_Bool:    bsOut.Write(request.BoolValue); break;
+    case PropertyValue::Type_Int:     bsOut.Write(request.IntValue); break;
+    case PropertyValue::Type_Number:  bsOut.Write(request.NumberValue); break;
+    case PropertyValue::Type_Numbers: bsOut.Write((int32_t)request.NumberValues.GetSize()); break;
+    default:
+        OVR_ASSERT(false);
+        return false;
+    }
 
-    if (!GetRPC1()->Signal("SetBoolValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+    if (!GetRPC1()->CallBlocking(LegacyGetters[request.Type], &bsOut, GetSession()->GetConnectionAtIndex(0), &returnData))
     {
         return false;
     }
 
-    return true;
-}
+    value = request;
 
-bool NetClient::SetIntValue(VirtualHmdId hmd, const char* key, int val)
-{
-    if (!IsConnected(true, true))
+    bool ok = false;
+    switch (request.Type)
     {
-        return false;
+    case PropertyValue::Type_String:
+        ok = returnData.Read(value.StringValue);
+        break;
+    case PropertyValue::Type_Bool:
+        {
+            uint8_t out = 0;
+            ok = returnData.Read(out);
+            value.BoolValue = (out != 0);
+        }
+        break;
+    case PropertyValue::Type_Int:
+        ok = returnData.Read(value.IntValue);
+        break;
+    case PropertyValue::Type_Number:
+        ok = returnData.Read(value.NumberValue);
+        break;
+    case PropertyValue::Type_Numbers:
+        {
+            int32_t out = 0;
+            ok = returnData.Read(out);
+            OVR_ASSERT(out >= 0 && out <= request.NumberValues.GetSizeI());
+            if (out < 0)
+            {
+                out = 0;
+            }
+            else if (out > request.NumberValues.GetSizeI())
+            {
+                out = request.NumberValues.GetSizeI();
+            }
+
+            value.NumberValues.Resize(out);
+            for (int i = 0; ok && i < out; i++)
+            {
+                ok = returnData.Read(value.NumberValues[i]);
+            }
+        }
+        break;
+    default:
+        break;
     }
 
+    OVR_ASSERT(ok);
+    return ok;
+}
+
+bool NetClient::setValueLegacy(VirtualHmdId hmd, const char* key, const PropertyValue& value)
+{
     OVR::Net::BitStream bsOut;
     bsOut.Write(hmd);
     bsOut.Write(key);
 
-    int32_t w = (int32_t)val;
-    bsOut.Write(w);
-
-    if (!GetRPC1()->Signal("SetIntValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+    switch (value.Type)
     {
+    case PropertyValue::Type_String:
+        bsOut.Write(value.StringValue.ToCStr());
+        break;
+    case PropertyValue::Type_Bool:
+        {
+            uint8_t b = value.BoolValue ? 1 : 0;
+            bsOut.Write(b);
+        }
+        break;
+    case PropertyValue::Type_Int:
+        bsOut.Write(value.IntValue);
+        break;
+    case PropertyValue::Type_Number:
+        bsOut.Write(value.NumberValue);
+        break;
+    case PropertyValue::Type_Numbers:
+        {
+            int32_t w_count = (int32_t)value.NumberValues.GetSize();
+            bsOut.Write(w_count);
+            for (int32_t i = 0; i < w_count; i++)
+            {
+                bsOut.Write(value.NumberValues[i]);
+            }
+        }
+        break;
+    default:
+        OVR_ASSERT(false);
         return false;
     }
 
-    return true;
+    return GetRPC1()->Signal(LegacySetters[value.Type], &bsOut, GetSession()->GetConnectionAtIndex(0));
 }
 
-bool NetClient::SetNumberValue(VirtualHmdId hmd, const char* key, double val)
+// The server answers unset keys with the default it was sent, so a cached value
+// only stands for requests that carry the same default
+static bool SamePropertyRequest(const PropertyValue& a, const PropertyValue& b)
 {
-    if (!IsConnected(true, true))
+    if (a.Type != b.Type)
     {
         return false;
     }
 
-    OVR::Net::BitStream bsOut;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
+    switch (a.Type)
+    {
+    case PropertyValue::Type_String:  return a.StringValue == b.StringValue;
+    case PropertyValue::Type_Bool:    return a.BoolValue == b.BoolValue;
+    case PropertyValue::Type_Int:     return a.IntValue == b.IntValue;
+    case PropertyValue::Type_Number:  return a.NumberValue == b.NumberValue;
+    case PropertyValue::Type_Numbers: return a.NumberValues.GetSize() == b.NumberValues.GetSize();
+    default:                          return false;
+    }
+}
 
-    bsOut.Write(val);
+bool NetClient::cacheLookup(VirtualHmdId hmd, const char* key, const PropertyValue& request,
+                            PropertyValue& value, uint32_t& epochOut)
+{
+    Lock::Locker locker(&PropertyCacheLock);
+
+    epochOut = PropertyCacheEpoch;
 
-    if (!GetRPC1()->Signal("SetNumberValue_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+    if (!serverVersionAtLeast(1, 5))
     {
         return false;
     }
 
-    return true;
+    const PropertyCacheEntry* entry = PropertyCache.Get(PropertyCacheKey(hmd, key));
+    if (entry && SamePropertyRequest(entry->Request, request))
+    {
+        value = entry->Value;
+        return true;
+    }
+
+    return false;
 }
 
-bool NetClient::SetNumberValues(VirtualHmdId hmd, const char* key, const double* vals, int num_vals)
+void NetClient::cacheStore(VirtualHmdId hmd, const char* key, const PropertyValue& request,
+                           const PropertyValue& value, uint32_t epoch)
 {
-    if (!IsConnected(true, true))
+    Lock::Locker locker(&PropertyCacheLock);
+
+    // A newer epoch means something changed while the value was being fetched,
+    // so it may already be stale
+    if (epoch != PropertyCacheEpoch || !serverVersionAtLeast(1, 5))
     {
-        return false;
+        return;
     }
 
-    OVR::Net::BitStream bsOut;
-    bsOut.Write(hmd);
-    bsOut.Write(key);
+    PropertyCacheEntry entry;
+    entry.Request = request;
+    entry.Value   = value;
+    PropertyCache.Set(PropertyCacheKey(hmd, key), entry);
+}
+
+void NetClient::cacheInvalidate(VirtualHmdId hmd, const char* key)
+{
+    Lock::Locker locker(&PropertyCacheLock);
+
+    PropertyCacheEpoch++;
 
-    int32_t w_count = (int32_t)num_vals;
-    bsOut.Write(w_count);
+    const bool anyKey = (key[0] == '\0');
 
-    for (int i = 0; i < num_vals; i++)
+    if (!anyKey && hmd != InvalidVirtualHmdId)
     {
-        bsOut.Write(vals[i]);
+        PropertyCache.Remove(PropertyCacheKey(hmd, key));
+        return;
     }
 
-    if (!GetRPC1()->Signal("SetNumberValues_1", &bsOut, GetSession()->GetConnectionAtIndex(0)))
+    Array<PropertyCacheKey> matches;
+    for (PropertyCacheHash::Iterator it = PropertyCache.Begin(); it != PropertyCache.End(); ++it)
     {
-        return false;
+        if ((anyKey || it->First.Name == key) &&
+            (hmd == InvalidVirtualHmdId || it->First.Hmd == hmd))
+        {
+            matches.PushBack(it->First);
+        }
     }
 
-    return true;
+    const int count = matches.GetSizeI();
+    for (int i = 0; i < count; ++i)
+    {
+        PropertyCache.Remove(matches[i]);
+    }
+}
+
+void NetClient::cacheClear()
+{
+    Lock::Locker locker(&PropertyCacheLock);
+
+    PropertyCacheEpoch++;
+    PropertyCache.Clear();
 }
 
 int NetClient::Hmd_Detect()
@@ -818,6 +1043,7 @@ void NetClient::registerRPC()
     RPC_REGISTER_SLOT(LatencyTesterAvailableScope, LatencyTesterAvailable_1);
     RPC_REGISTER_SLOT(DefaultLogOutputScope, DefaultLogOutput_1);
     RPC_REGISTER_SLOT(HMDCountUpdateScope, HMDCountUpdate_1);
+    RPC_REGISTER_SLOT(PropertyChangedScope, PropertyChanged_1);
 }
 
 void NetClient::InitialServerState_1(BitStream* userData, ReceivePayload* pPayload)
@@ -872,5 +1098,20 @@ void NetClient::HMDCountUpdate_1(BitStream* userData, ReceivePayload* pPayload)
     EdgeTriggeredHMDCount = true;
 }
 
+void NetClient::PropertyChanged_1(BitStream* userData, ReceivePayload* pPayload)
+{
+    OVR_UNUSED(pPayload);
+
+    VirtualHmdId hmd = InvalidVirtualHmdId;
+    String key;
+    if (!userData->Read(hmd) || !userData->Read(key))
+    {
+        OVR_ASSERT(false);
+        return;
+    }
+
+    cacheInvalidate(hmd, key.ToCStr());
+}
+
 
 }} // namespace OVR::Service
@@ -84,6 +84,13 @@ public:
     bool         SetNumberValue(VirtualHmdId hmd, const char* key, double val);
     bool         SetNumberValues(VirtualHmdId hmd, const char* key, const double* vals, int num_vals);
 
+    // Batched key-value access, costing one round trip for the whole set of keys
+    // (one per key against servers older than protocol 1.4). The single-key calls above go through these.
+    // outValues[i].Type selects how keys[i] is read, and its value is the default on input.
+    // Returns false if not connected or the reply was malformed; the defaults are then left in place
+    bool         GetValues(VirtualHmdId hmd, const char* keys[], PropertyValue outValues[], int count);
+    bool         SetValues(VirtualHmdId hmd, const char* keys[], const PropertyValue values[], int count);
+
     bool         GetDriverMode(bool& driverInstalled, bool& compatMode, bool& hideDK1Mode);
     bool         SetDriverMode(bool compatMode, bool hideDK1Mode);
 
@@ -125,6 +132,64 @@ protected:
     String       LatencyUtil_GetResultsString_Str;
     String       ProfileGetValue1_Str, ProfileGetValue3_Str;
 
+protected:
+    // True if the connected server speaks at least this protocol version
+    bool         serverVersionAtLeast(int major, int minor);
+
+    // Single-key RPCs used in place of GetValues_1 / SetValues_1 for servers before protocol 1.4
+    bool         getValueLegacy(VirtualHmdId hmd, const char* key, const PropertyValue& request, PropertyValue& value);
+    bool         setValueLegacy(VirtualHmdId hmd, const char* key, const PropertyValue& value);
+
+protected:
+    //// Property cache:
+
+    // Service property reads are answered from here once fetched, until the server
+    // signals PropertyChanged_1 for the key. Only servers at protocol 1.5 or later
+    // send that signal, so the cache is bypassed for older ones.
+
+    struct PropertyCacheKey
+    {
+        VirtualHmdId Hmd;
+        String       Name;
+
+        PropertyCacheKey(VirtualHmdId hmd, const char* name) : Hmd(hmd), Name(name) { }
+
+        bool operator== (const PropertyCacheKey& other) const
+        {
+            return Hmd == other.Hmd && Name == other.Name;
+        }
+
+        struct HashFunctor
+        {
+            size_t operator()(const PropertyCacheKey& key) const
+            {
+                return String::BernsteinHashFunction(key.Name.ToCStr(), key.Name.GetSize(), 5381 + key.Hmd);
+            }
+        };
+    };
+
+    struct PropertyCacheEntry
+    {
+        PropertyValue Request; // Type and default the value was fetched with
+        PropertyValue Value;
+    };
+
+    typedef Hash<PropertyCacheKey, PropertyCacheEntry, PropertyCacheKey::HashFunctor> PropertyCacheHash;
+
+    Lock              PropertyCacheLock;
+    PropertyCacheHash PropertyCache;       // Only holds values that were fetched successfully
+    uint32_t          PropertyCacheEpoch;  // Bumped by every invalidation, so a fetch that raced one is not stored
+
+    // Returns true and fills in value on a hit. On a miss, epochOut is the
+    // epoch to hand back to cacheStore() once the value has been fetched
+    bool         cacheLookup(VirtualHmdId hmd, const char* key, const PropertyValue& request,
+                             PropertyValue& value, uint32_t& epochOut);
+    void         cacheStore(VirtualHmdId hmd, const char* key, const PropertyValue& request,
+                            const PropertyValue& value, uint32_t epoch);
+    // An empty key matches every key; InvalidVirtualHmdId matches every HMD
+    void         cacheInvalidate(VirtualHmdId hmd, const char* key);
+    void         cacheClear();
+
 protected:
     //// Push Notifications:
 
@@ -141,6 +206,9 @@ protected:
 
     ObserverScope<Net::Plugins::RPCSlot> HMDCountUpdateScope;
     void HMDCountUpdate_1(BitStream* userData, ReceivePayload* pPayload);
+
+    ObserverScope<Net::Plugins::RPCSlot> PropertyChangedScope;
+    void PropertyChanged_1(BitStream* userData, ReceivePayload* pPayload);
 };
 
 
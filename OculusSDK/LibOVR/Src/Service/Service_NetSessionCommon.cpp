@@ -68,6 +68,12 @@ void NetSessionCommon::onSystemDestroy()
 
     Join();
 
+    // No more session callbacks once the derived object starts destructing
+    if (pSession)
+    {
+        pSession->StopIOThread();
+    }
+
     Release();
 }
 
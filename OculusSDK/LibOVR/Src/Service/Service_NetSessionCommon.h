@@ -32,6 +32,7 @@ limitations under the License.
 #include "../Kernel/OVR_Threads.h"
 #include "../Net/OVR_BitStream.h"
 #include "../Kernel/OVR_System.h"
+#include "../Kernel/OVR_Array.h"
 
 namespace OVR {
 
@@ -112,6 +113,7 @@ public:
     {
         // Note: If this enumeration changes, then the Servce_NetSessionCommon.cpp
         // IsServiceProperty() function should be updated.
+        // PropertyValue::EType follows the order of the getters and of the setters.
 
         EGetStringValue,
         EGetBoolValue,
@@ -137,6 +139,144 @@ protected:
 };
 
 
+//-------------------------------------------------------------------------------------
+// ***** PropertyValue
+
+// Typed value of one key in a batched GetValues_1 / SetValues_1 call.
+// For gets, the value sent is the default returned when the key is not set,
+// and for Type_Numbers the size of NumberValues is the most values wanted.
+
+struct PropertyValue
+{
+    enum EType
+    {
+        Type_String,
+        Type_Bool,
+        Type_Int,
+        Type_Number,
+        Type_Numbers,
+
+        Type_Count
+    };
+
+    // Upper bound on Type_Numbers counts accepted from the network
+    static const int MaxNumberValues = 1024;
+
+    PropertyValue(EType type = Type_Number) :
+        Type(type),
+        BoolValue(false),
+        IntValue(0),
+        NumberValue(0.)
+    {
+        OVR_COMPILER_ASSERT(NetSessionCommon::EGetNumberValues - NetSessionCommon::EGetStringValue == Type_Numbers);
+        OVR_COMPILER_ASSERT(NetSessionCommon::ESetNumberValues - NetSessionCommon::ESetStringValue == Type_Numbers);
+    }
+
+    EType            Type;
+    String           StringValue;
+    bool             BoolValue;
+    int32_t          IntValue;
+    double           NumberValue;
+    ArrayPOD<double> NumberValues;
+
+    // Getter and setter that access this type one key at a time
+    NetSessionCommon::EGetterSetters GetGetter() const
+    {
+        return (NetSessionCommon::EGetterSetters)(NetSessionCommon::EGetStringValue + Type);
+    }
+    NetSessionCommon::EGetterSetters GetSetter() const
+    {
+        return (NetSessionCommon::EGetterSetters)(NetSessionCommon::ESetStringValue + Type);
+    }
+
+    void Serialize(Net::BitStream* bs) const
+    {
+        uint8_t t = (uint8_t)Type;
+        bs->Write(t);
+
+        switch (Type)
+        {
+        case Type_String:
+            bs->Write(StringValue);
+            break;
+        case Type_Bool:
+            {
+                uint8_t b = BoolValue ? 1 : 0;
+                bs->Write(b);
+            }
+            break;
+        case Type_Int:
+            bs->Write(IntValue);
+            break;
+        case Type_Number:
+            bs->Write(NumberValue);
+            break;
+        case Type_Numbers:
+            {
+                int32_t count = (int32_t)NumberValues.GetSize();
+                bs->Write(count);
+                for (int32_t i = 0; i < count; ++i)
+                {
+                    bs->Write(NumberValues[i]);
+                }
+            }
+            break;
+        default:
+            OVR_ASSERT(false);
+            break;
+        }
+    }
+    bool Deserialize(Net::BitStream* bs)
+    {
+        uint8_t t = 0;
+        if (!bs->Read(t) || t >= Type_Count)
+        {
+            return false;
+        }
+        Type = (EType)t;
+
+        switch (Type)
+        {
+        case Type_String:
+            return bs->Read(StringValue);
+        case Type_Bool:
+            {
+                uint8_t b = 0;
+                if (!bs->Read(b))
+                {
+                    return false;
+                }
+                BoolValue = (b != 0);
+            }
+            return true;
+        case Type_Int:
+            return bs->Read(IntValue);
+        case Type_Number:
+            return bs->Read(NumberValue);
+        case Type_Numbers:
+            {
+                int32_t count = 0;
+                if (!bs->Read(count) || count < 0 || count > MaxNumberValues)
+                {
+                    return false;
+                }
+                NumberValues.Resize(count);
+                for (int32_t i = 0; i < count; ++i)
+                {
+                    if (!bs->Read(NumberValues[i]))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+
 }} // namespace OVR::Service
 
 #endif // OVR_Service_NetSessionCommon_h
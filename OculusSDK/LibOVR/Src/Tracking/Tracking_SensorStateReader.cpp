@@ -108,14 +108,30 @@ void SensorStateReader::RecenterPose()
 
 bool SensorStateReader::GetSensorStateAtTime(double absoluteTime, TrackingState& ss) const
 {
-	if (!Updater)
+	LocklessSensorState lstate;
+	if (!GetSensorSample(lstate))
 	{
         ss.StatusFlags = 0;
         return false;
 	}
 
-	const LocklessSensorState lstate = Updater->SharedSensorState.GetState();
+	return GetSensorStateAtTime(lstate, absoluteTime, ss);
+}
+
+bool SensorStateReader::GetSensorSample(LocklessSensorState& sample) const
+{
+	if (!Updater)
+	{
+		return false;
+	}
 
+	sample = Updater->SharedSensorState.GetState();
+
+	return true;
+}
+
+bool SensorStateReader::GetSensorStateAtTime(const LocklessSensorState& lstate, double absoluteTime, TrackingState& ss) const
+{
     // Update time
 	ss.HeadPose.TimeInSeconds = absoluteTime;
 
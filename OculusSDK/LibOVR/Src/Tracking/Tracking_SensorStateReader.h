@@ -64,6 +64,13 @@ public:
 	// predicted at a specified absolute point in time.
 	bool		 GetSensorStateAtTime(double absoluteTime, Tracking::TrackingState& state) const;
 
+	// Copy out the latest sensor sample. Returns false if there is no updater.
+	bool		 GetSensorSample(LocklessSensorState& sample) const;
+
+	// Same as above, but predicts from a sample copied out earlier by GetSensorSample().
+	// States predicted from one sample are consistent with each other.
+	bool		 GetSensorStateAtTime(const LocklessSensorState& sample, double absoluteTime, Tracking::TrackingState& state) const;
+
 	// Get the predicted pose (orientation, position) of the center pupil frame (CPF) at a specific point in time.
 	bool		 GetPoseAtTime(double absoluteTime, Posef& transform) const;
 
@@ -376,27 +376,27 @@ void XmlHandler::ParseVectorString(const char* str, OVR::Array<OVR::Vector3f> *a
 	                               bool is2element)
 {
     size_t stride = is2element ? 2 : 3;
-    size_t stringLength = strlen(str);
     size_t element = 0;
     float v[3];
 
-    for(size_t j = 0; j < stringLength;)
+    for(const char* p = str; *p != '\0';)
     {
-        size_t k = j + 1;
-        for(; k < stringLength; ++k)
+        if(isspace((unsigned char)*p))
         {
-            if(str[k] == ' ')
-            {
-                break;
-            }
+            ++p;
+            continue;
         }
-        char text[20];
-        for(size_t l = 0; l < k - j; ++l)
+
+        // Parse in place rather than copying each token for atof, which is also locale dependent.
+        const char* end;
+        v[element] = OVR_ParseFloat(p, &end);
+
+        // Skip the rest of a malformed token, which reads as 0 like it did with atof.
+        while(*end != '\0' && !isspace((unsigned char)*end))
         {
-            text[l] = str[j + l];
+            ++end;
         }
-        text[k - j] = '\0';
-        v[element] = (float)atof(text);
+        p = end;
 
         if(element == (stride - 1))
         {
@@ -408,7 +408,6 @@ void XmlHandler::ParseVectorString(const char* str, OVR::Array<OVR::Vector3f> *a
             array->PushBack(vect);
         }
 
-        j = k + 1;
         element = (element + 1) % stride;
     }
 }
@@ -30,17 +30,20 @@ RenderProfiler::RenderProfiler()
     memset(SampleHistory, 0, sizeof(SampleHistory));
     memset(SampleAverage, 0, sizeof(SampleAverage));
     SampleCurrentFrame = 0;
+    FrameStartTicks = Timer::GetTicks();
 }
 
 void RenderProfiler::RecordSample(SampleType sampleType)
 {
+    // Raw ticks are cheaper than ovr_GetTimeInSeconds, but only differences between
+    // them are meaningful, so samples are converted relative to the frame start.
+    uint64_t ticks = Timer::GetTicks();
+
     if (sampleType == Sample_FrameStart)
     {
-        // Recompute averages and subtract off frame start time.
+        // Recompute averages.
         for (int sample = 1; sample < Sample_LAST; sample++)
         {
-            SampleHistory[SampleCurrentFrame][sample] -= SampleHistory[SampleCurrentFrame][0];
-
             // Recompute the average for the current sample type.
             SampleAverage[sample] = 0.0;
             for (int frame = 0; frame < NumFramesOfTimerHistory; frame++)
@@ -51,9 +54,10 @@ void RenderProfiler::RecordSample(SampleType sampleType)
         }
 
         SampleCurrentFrame = ((SampleCurrentFrame + 1) % NumFramesOfTimerHistory);
+        FrameStartTicks = ticks;
     }
 
-    SampleHistory[SampleCurrentFrame][sampleType] = ovr_GetTimeInSeconds();
+    SampleHistory[SampleCurrentFrame][sampleType] = Timer::TicksToSeconds(ticks - FrameStartTicks);
 }
 
 const double* RenderProfiler::GetLastSampleSet() const
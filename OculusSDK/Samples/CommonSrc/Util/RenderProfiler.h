@@ -66,6 +66,7 @@ private:
     double      SampleHistory[NumFramesOfTimerHistory][Sample_LAST];
     double      SampleAverage[Sample_LAST];
     int         SampleCurrentFrame;
+    uint64_t    FrameStartTicks;
 };
 
 #endif // INC_RenderProfiler_h
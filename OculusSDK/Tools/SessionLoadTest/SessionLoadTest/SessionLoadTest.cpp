@@ -0,0 +1,1182 @@
+/************************************************************************************
+
+Filename    :   SessionLoadTest.cpp
+Content     :   Load generator and mock service for the LibOVR Session/RPC1 stack
+Created     :   October 19, 2026
+Authors     :
+
+Copyright   :   Copyright 2014 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.2 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.2
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+// Runs a mock service and a number of clients in one process, over the same Session and
+// RPC1 code the runtime uses. Each client loops CallBlocking("echo") followed by a
+// Signal("sig"). At the end it prints throughput, call latency percentiles and OVR
+// allocations per message, then fuzzes the service with malformed messages and checks
+// that it still answers.
+//
+// The exit code is non-zero if -maxp99 or -maxallocs is exceeded, or if the service
+// stops answering, so the tool can be run as a regression gate:
+//
+//   SessionLoadTest -clients 8 -size 64 -rate 1000 -seconds 5 -maxp99 2000 -maxallocs 1.5
+//
+// Comparing runs with -coalesce 0 and 1 measures the service's send coalescing; -clients 500
+// gives the poll set hundreds of connected sockets.
+//
+// -bench picks a narrower measurement instead of the load test:
+//
+//   -bench reassembly  Feeds a stream of framed messages of random sizes (1 to 2x -size bytes)
+//                      to the PacketizedTCPSocket receive path in -chunk byte reads, and checks
+//                      every message size. No socket is involved, so this is the framing cost alone.
+//   -bench transports  Runs the load test over loopback TCP, AF_UNIX (not on Windows) and shared
+//                      memory, each with a fresh service. With -clients 1 it compares the RPC round trip.
+//   -bench receive     Opens -clients connections from one client session and sends -messages raw
+//                      messages round-robin over them. Reports the CPU time of the service's poll
+//                      thread per message. TCP and AF_UNIX only. Thousands of connections need a
+//                      raised open file limit.
+
+#include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Allocator.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Atomic.h"
+#include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_Timer.h"
+#include "Net/OVR_Session.h"
+#include "Net/OVR_PacketizedTCPSocket.h"
+#include "Net/OVR_RPC1.h"
+#include "Net/OVR_MessageIDTypes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OVR_OS_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace OVR;
+using namespace OVR::Net;
+using namespace OVR::Net::Plugins;
+
+
+//-----------------------------------------------------------------------------
+// Options
+
+enum LoadTransport
+{
+    LoadTransport_TCP,
+    LoadTransport_Unix,
+    LoadTransport_SharedMemory
+};
+
+enum LoadBench
+{
+    LoadBench_Load,       // Load test, then fuzzing
+    LoadBench_Reassembly, // PacketizedTCPSocket message framing
+    LoadBench_Transports, // Load test over each local transport
+    LoadBench_Receive     // Service receive path over many connections
+};
+
+struct LoadOptions
+{
+    LoadBench      Bench;
+    int            Clients;
+    int            PayloadBytes;
+    int            CallsPerSecond;      // Per client; 0 runs as fast as possible
+    double         Seconds;
+    LoadTransport  Transport;
+    int            Port;
+    const char*    Path;                // AF_UNIX socket path
+    bool           SendCoalescing;      // Service replies through Session::SetSendCoalescing()
+    int            FuzzConnections;
+    int            FuzzMessages;        // Per fuzz connection
+    unsigned       Seed;
+    double         MaxP99Usec;          // 0 disables the check
+    double         MaxAllocsPerMessage; // Negative disables the check
+    int            ChunkBytes;          // Bytes per read for -bench reassembly
+    int            Messages;            // Messages sent by -bench receive
+
+    LoadOptions() :
+        Bench(LoadBench_Load),
+        Clients(4),
+        PayloadBytes(64),
+        CallsPerSecond(0),
+        Seconds(5.0),
+        Transport(LoadTransport_TCP),
+        Port(30400),
+        Path("/tmp/ovr_session_load_test.sock"),
+        SendCoalescing(false),
+        FuzzConnections(16),
+        FuzzMessages(200),
+        Seed(1),
+        MaxP99Usec(0.0),
+        MaxAllocsPerMessage(-1.0),
+        ChunkBytes(1460),
+        Messages(40000)
+    {
+    }
+};
+
+static void printUsage()
+{
+    printf("Usage: SessionLoadTest [options]\n"
+           "  -clients N          Client connections (default 4)\n"
+           "  -size BYTES         Payload of each call and signal (default 64)\n"
+           "  -rate N             Calls per second per client, 0 = unpaced (default 0)\n"
+           "  -seconds S          Length of the load phase (default 5)\n"
+           "  -transport T        tcp, unix or shm (default tcp)\n"
+           "  -port N             TCP port of the mock service (default 30400)\n"
+           "  -path FILE          Socket path for -transport unix\n"
+           "  -coalesce 0|1       Coalesce the service's replies per Poll() (default 0)\n"
+           "  -fuzz N             Connections sending malformed messages, 0 = skip (default 16)\n"
+           "  -fuzzmessages N     Messages sent by each fuzz connection (default 200)\n"
+           "  -seed N             Fuzzer random seed (default 1)\n"
+           "  -maxp99 USEC        Fail if the p99 call latency is higher\n"
+           "  -maxallocs N        Fail if there are more allocations per message\n"
+           "  -bench B            load, reassembly, transports or receive (default load)\n"
+           "  -chunk BYTES        Bytes per read for -bench reassembly (default 1460)\n"
+           "  -messages N         Messages sent by -bench receive (default 40000)\n");
+}
+
+static bool parseOptions(int argc, char** argv, LoadOptions& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* name  = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if      (!strcmp(name, "-clients"))      opts.Clients             = atoi(value);
+        else if (!strcmp(name, "-size"))         opts.PayloadBytes        = atoi(value);
+        else if (!strcmp(name, "-rate"))         opts.CallsPerSecond      = atoi(value);
+        else if (!strcmp(name, "-seconds"))      opts.Seconds             = atof(value);
+        else if (!strcmp(name, "-port"))         opts.Port                = atoi(value);
+        else if (!strcmp(name, "-path"))         opts.Path                = value;
+        else if (!strcmp(name, "-coalesce"))     opts.SendCoalescing      = atoi(value) != 0;
+        else if (!strcmp(name, "-fuzz"))         opts.FuzzConnections     = atoi(value);
+        else if (!strcmp(name, "-fuzzmessages")) opts.FuzzMessages        = atoi(value);
+        else if (!strcmp(name, "-seed"))         opts.Seed                = (unsigned)strtoul(value, NULL, 10);
+        else if (!strcmp(name, "-maxp99"))       opts.MaxP99Usec          = atof(value);
+        else if (!strcmp(name, "-maxallocs"))    opts.MaxAllocsPerMessage = atof(value);
+        else if (!strcmp(name, "-chunk"))        opts.ChunkBytes          = atoi(value);
+        else if (!strcmp(name, "-messages"))     opts.Messages            = atoi(value);
+        else if (!strcmp(name, "-bench"))
+        {
+            if      (!strcmp(value, "load"))       opts.Bench = LoadBench_Load;
+            else if (!strcmp(value, "reassembly")) opts.Bench = LoadBench_Reassembly;
+            else if (!strcmp(value, "transports")) opts.Bench = LoadBench_Transports;
+            else if (!strcmp(value, "receive"))    opts.Bench = LoadBench_Receive;
+            else return false;
+        }
+        else if (!strcmp(name, "-transport"))
+        {
+            if      (!strcmp(value, "tcp"))  opts.Transport = LoadTransport_TCP;
+            else if (!strcmp(value, "unix")) opts.Transport = LoadTransport_Unix;
+            else if (!strcmp(value, "shm"))  opts.Transport = LoadTransport_SharedMemory;
+            else return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+#ifdef OVR_OS_WIN32
+    if (opts.Transport == LoadTransport_Unix)
+    {
+        printf("The unix transport is not available on Windows.\n");
+        return false;
+    }
+#endif
+
+    return opts.Clients > 0 && opts.PayloadBytes >= 0 && opts.CallsPerSecond >= 0 &&
+           opts.Seconds > 0.0 && opts.Port > 0 && opts.Port < 65536 &&
+           opts.FuzzConnections >= 0 && opts.FuzzMessages >= 0 && opts.ChunkBytes > 0 &&
+           opts.Messages > 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// CountingAllocator
+
+// Counts every allocation made through the OVR allocator, so the per-message
+// cost of the network stack can be reported.
+class CountingAllocator : public DefaultAllocator
+{
+public:
+    virtual void* Alloc(size_t size)
+    {
+        Allocations.ExchangeAdd_NoSync(1);
+        return DefaultAllocator::Alloc(size);
+    }
+    virtual void* AllocDebug(size_t size, const char* file, unsigned line)
+    {
+        Allocations.ExchangeAdd_NoSync(1);
+        return DefaultAllocator::AllocDebug(size, file, line);
+    }
+    virtual void* Realloc(void* p, size_t newSize)
+    {
+        Allocations.ExchangeAdd_NoSync(1);
+        return DefaultAllocator::Realloc(p, newSize);
+    }
+
+    int GetAllocations() const { return Allocations.Load_Acquire(); }
+
+protected:
+    AtomicInt<int> Allocations;
+};
+
+static CountingAllocator TheAllocator;
+
+
+//-----------------------------------------------------------------------------
+// LatencyHistogram
+
+// Call latencies in 1 microsecond buckets. The storage is allocated up front so
+// recording a sample does not show up in the allocation count.
+class LatencyHistogram
+{
+public:
+    enum { BucketCount = 100000 }; // Samples of 100 ms or more share the last bucket
+
+    LatencyHistogram() : Samples(0)
+    {
+        Buckets.Resize(BucketCount);
+        memset(&Buckets[0], 0, BucketCount * sizeof(uint32_t));
+    }
+
+    void Add(double seconds)
+    {
+        int usec = (int)(seconds * 1000000.0);
+        if (usec < 0)
+        {
+            usec = 0;
+        }
+        Buckets[usec < BucketCount ? usec : BucketCount - 1]++;
+        Samples++;
+    }
+
+    void Merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < BucketCount; ++i)
+        {
+            Buckets[i] += other.Buckets[i];
+        }
+        Samples += other.Samples;
+    }
+
+    // Returns the latency in microseconds that the given fraction of samples did not exceed
+    int GetPercentile(double fraction) const
+    {
+        uint64_t rank = (uint64_t)(fraction * (double)Samples);
+        uint64_t seen = 0;
+
+        for (int i = 0; i < BucketCount; ++i)
+        {
+            seen += Buckets[i];
+            if (seen > rank)
+            {
+                return i;
+            }
+        }
+        return BucketCount - 1;
+    }
+
+    uint64_t GetSamples() const { return Samples; }
+
+protected:
+    ArrayPOD<uint32_t> Buckets;
+    uint64_t           Samples;
+};
+
+
+//-----------------------------------------------------------------------------
+// Mock service
+
+class MockService : public NewOverrideBase
+{
+public:
+    MockService()
+    {
+        ServiceSession.AddSessionListener(&Rpc);
+
+        Rpc.RegisterBlockingFunction("echo", RPCDelegate::FromMember<MockService, &MockService::echo>(this));
+
+        SignalScope.SetHandler(RPCSlot::FromMember<MockService, &MockService::sig>(this));
+        Rpc.RegisterSlot("sig", SignalScope.GetPtr());
+    }
+
+    bool Start(const LoadOptions& opts)
+    {
+        ServiceSession.SetSharedMemoryTransport(opts.Transport == LoadTransport_SharedMemory);
+        ServiceSession.SetSendCoalescing(opts.SendCoalescing);
+
+        BerkleyBindParameters bbp;
+        bbp.Address         = "::1";
+        bbp.Port            = (uint16_t)opts.Port;
+        bbp.blockingTimeout = 100;
+        if (opts.Transport == LoadTransport_Unix)
+        {
+            bbp.LocalPath = opts.Path;
+        }
+
+        if (ServiceSession.ListenPTCP(&bbp) != SessionResult_OK)
+        {
+            return false;
+        }
+
+        return ServiceSession.StartIOThread(true);
+    }
+
+    void Stop()
+    {
+        ServiceSession.Shutdown();
+        ServiceSession.StopIOThread();
+    }
+
+    int GetSignalCount() const { return Signals.Load_Acquire(); }
+
+protected:
+    void echo(BitStream* userData, BitStream* returnData, ReceivePayload* pPayload)
+    {
+        OVR_UNUSED(pPayload);
+        returnData->Write(userData);
+    }
+
+    void sig(BitStream* userData, ReceivePayload* pPayload)
+    {
+        OVR_UNUSED2(userData, pPayload);
+        Signals.ExchangeAdd_NoSync(1);
+    }
+
+    RPC1                   Rpc;            // Declared before the session, which refers to it
+    Session                ServiceSession;
+    ObserverScope<RPCSlot> SignalScope;
+    AtomicInt<int>         Signals;
+};
+
+
+//-----------------------------------------------------------------------------
+// Load client
+
+// Opens a client session to the mock service and returns its connection, or NULL.
+static Ptr<Connection> connectToService(Session& session, const LoadOptions& opts)
+{
+    session.SetSharedMemoryTransport(opts.Transport == LoadTransport_SharedMemory);
+    if (!session.StartIOThread(true))
+    {
+        return NULL;
+    }
+
+    // Many clients connecting at once can overflow the listen backlog, so retry
+    for (int attempt = 0; attempt < 50; ++attempt)
+    {
+        BerkleyBindParameters bbp;
+        bbp.Address         = "::1";
+        bbp.blockingTimeout = 1000;
+        if (opts.Transport == LoadTransport_Unix)
+        {
+            bbp.LocalPath = opts.Path;
+        }
+
+        SockAddr sa;
+        sa.Set("::1", (uint16_t)opts.Port, SOCK_STREAM);
+
+        SessionResult result = session.ConnectPTCP(&bbp, &sa, true);
+        if (result == SessionResult_OK || result == SessionResult_AlreadyConnected ||
+            result == SessionResult_ConnectInProgress)
+        {
+            // Wait for the handshake to finish
+            for (int wait = 0; wait < 1000; ++wait)
+            {
+                if (session.GetConnectionCount() > 0)
+                {
+                    return session.GetConnectionAtIndex(0);
+                }
+                Thread::MSleep(1);
+            }
+        }
+
+        Thread::MSleep(20);
+    }
+
+    return NULL;
+}
+
+class LoadClient : public NewOverrideBase
+{
+public:
+    LoadClient(const LoadOptions& opts, const uint8_t* payload) :
+        Options(opts),
+        pPayload(payload),
+        StartSeconds(0.0),
+        Calls(0),
+        Failures(0)
+    {
+        ClientSession.AddSessionListener(&Rpc);
+    }
+
+    bool Connect()
+    {
+        pConnection = connectToService(ClientSession, Options);
+        return pConnection != NULL;
+    }
+
+    // Makes one echo call and checks the reply
+    bool Probe()
+    {
+        BitStream in, out;
+        in.WriteAlignedBytes(pPayload, Options.PayloadBytes);
+
+        if (!Rpc.CallBlocking("echo", &in, pConnection, &out))
+        {
+            return false;
+        }
+        return (int)out.GetNumberOfBytesUsed() == Options.PayloadBytes &&
+               (Options.PayloadBytes == 0 || !memcmp(out.GetData(), pPayload, Options.PayloadBytes));
+    }
+
+    bool Start(double startSeconds)
+    {
+        StartSeconds = startSeconds;
+        pThread = *new Thread(threadFunction, this);
+        return pThread && pThread->Start();
+    }
+
+    void Join()
+    {
+        if (pThread)
+        {
+            pThread->Join();
+        }
+    }
+
+    // Closes the connection. The I/O thread notices at the end of its current wait, so
+    // shutting down every client before stopping any keeps many clients from waiting in turn.
+    void Shutdown()
+    {
+        ClientSession.Shutdown();
+    }
+
+    void Stop()
+    {
+        ClientSession.Shutdown();
+        ClientSession.StopIOThread();
+    }
+
+    const LatencyHistogram& GetLatencies() const { return Latencies; }
+    int                     GetCalls() const     { return Calls; }
+    int                     GetFailures() const  { return Failures; }
+
+protected:
+    static int threadFunction(Thread* pthread, void* h)
+    {
+        OVR_UNUSED(pthread);
+        ((LoadClient*)h)->run();
+        return 0;
+    }
+
+    void run()
+    {
+        const double interval = Options.CallsPerSecond ? 1.0 / Options.CallsPerSecond : 0.0;
+        const double end      = StartSeconds + Options.Seconds;
+        double       next     = StartSeconds;
+
+        BitStream in, out, signal;
+
+        for (double now = Timer::GetSeconds(); now < end; now = Timer::GetSeconds())
+        {
+            if (interval > 0.0)
+            {
+                if (now < next)
+                {
+                    // Sleep while far from the next call, then spin
+                    if (next - now > 0.002)
+                    {
+                        Thread::MSleep(1);
+                    }
+                    continue;
+                }
+                next += interval;
+            }
+
+            in.Reset();
+            out.Reset();
+            in.WriteAlignedBytes(pPayload, Options.PayloadBytes);
+
+            double callStart = Timer::GetSeconds();
+            bool   succeeded = Rpc.CallBlocking("echo", &in, pConnection, &out);
+            Latencies.Add(Timer::GetSeconds() - callStart);
+
+            signal.Reset();
+            signal.WriteAlignedBytes(pPayload, Options.PayloadBytes);
+            succeeded &= Rpc.Signal("sig", &signal, pConnection);
+
+            Calls++;
+            if (!succeeded)
+            {
+                Failures++;
+            }
+        }
+    }
+
+    const LoadOptions& Options;
+    const uint8_t*     pPayload;
+    RPC1               Rpc;            // Declared before the session, which refers to it
+    Session            ClientSession;
+    Ptr<Connection>    pConnection;
+    Ptr<Thread>        pThread;
+    double             StartSeconds;
+    LatencyHistogram   Latencies;
+    int                Calls;
+    int                Failures;
+};
+
+
+//-----------------------------------------------------------------------------
+// Fuzzer
+
+// Small deterministic generator, so a failing seed can be replayed
+class FuzzRandom
+{
+public:
+    FuzzRandom(unsigned seed) : State(seed ? seed : 1) { }
+
+    uint32_t Next()
+    {
+        State ^= State << 13;
+        State ^= State >> 17;
+        State ^= State << 5;
+        return State;
+    }
+
+    int NextInt(int limit) { return (int)(Next() % (uint32_t)limit); }
+
+    void Fill(uint8_t* p, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+        {
+            p[i] = (uint8_t)Next();
+        }
+    }
+
+protected:
+    uint32_t State;
+};
+
+// Sends malformed messages on a fresh connection, then drops it.
+// Returns the number of messages sent.
+static int fuzzConnection(const LoadOptions& opts, FuzzRandom& random)
+{
+    Session         session;
+    Ptr<Connection> pConnection = connectToService(session, opts);
+    if (!pConnection)
+    {
+        return 0;
+    }
+
+    uint8_t buffer[1024];
+    int     sent = 0;
+
+    for (int i = 0; i < opts.FuzzMessages; ++i)
+    {
+        int bytes = 0;
+
+        switch (random.NextInt(3))
+        {
+        case 0: // Random message
+            bytes = 1 + random.NextInt(sizeof(buffer) - 1);
+            random.Fill(buffer, bytes);
+            break;
+
+        case 1: // RPC1 message with a valid or unknown sub-ID and a truncated or random body
+            bytes = 1 + random.NextInt(24);
+            random.Fill(buffer, bytes);
+            buffer[0] = OVRID_RPC1;
+            if (bytes > 1)
+            {
+                buffer[1] = (uint8_t)random.NextInt(12);
+            }
+            break;
+
+        default: // RPC1 call with a garbage body
+            bytes = 2 + random.NextInt(32);
+            random.Fill(buffer, bytes);
+            buffer[0] = OVRID_RPC1;
+            buffer[1] = 1; // CALL_BLOCKING
+            break;
+        }
+
+        SendParameters sp(pConnection, buffer, bytes);
+        if (session.Send(&sp) > 0)
+        {
+            sent++;
+        }
+    }
+
+    // Half the connections end with bytes under the framing layer: a bogus length
+    // header or a torn message. The service should drop just this connection.
+    TCPConnection* tcp = (TCPConnection*)pConnection.GetPtr();
+    if (random.NextInt(2) && tcp->pSocket)
+    {
+        int bytes = 4 + random.NextInt(64);
+        random.Fill(buffer, bytes);
+
+        // Call the plain TCP send, skipping the length prefix of the packetized socket
+        if (tcp->pSocket->TCPSocket::Send(buffer, bytes) > 0)
+        {
+            sent++;
+        }
+    }
+
+    Thread::MSleep(10);
+    session.Shutdown();
+    session.StopIOThread();
+    return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reassembly benchmark
+
+// Exposes the receive path, so a stream can be fed to it without a socket
+class ReassemblySocket : public PacketizedTCPSocket
+{
+public:
+    void Feed(SocketEvent_TCP* eventHandler, uint8_t* pData, int bytesRead)
+    {
+        OnRecv(eventHandler, pData, bytesRead);
+    }
+};
+
+// Checks each framed message against the sizes that were sent
+class ReassemblyCounter : public SocketEvent_TCP
+{
+public:
+    ReassemblyCounter(const ArrayPOD<int>& sizes) :
+        Sizes(sizes),
+        Messages(0),
+        Mismatches(0),
+        Closed(false)
+    {
+    }
+
+    virtual void TCP_OnRecv(Socket* pSocket, uint8_t* pData, int bytesRead)
+    {
+        OVR_UNUSED2(pSocket, pData);
+
+        if (bytesRead != Sizes[(int)(Messages % Sizes.GetSize())])
+        {
+            Mismatches++;
+        }
+        Messages++;
+    }
+
+    virtual void TCP_OnClosed(TCPSocket* pSocket)
+    {
+        OVR_UNUSED(pSocket);
+        Closed = true;
+    }
+
+    const ArrayPOD<int>& Sizes;
+    uint64_t             Messages;
+    int                  Mismatches;
+    bool                 Closed;
+};
+
+static int runReassemblyBench(const LoadOptions& opts)
+{
+    const int maxBytes = opts.PayloadBytes > 0 ? opts.PayloadBytes * 2 : 1;
+
+    // About 4 MB of framed messages, in the length-prefixed format PacketizedTCPSocket sends
+    FuzzRandom        random(opts.Seed);
+    ArrayPOD<int>     sizes;
+    ArrayPOD<uint8_t> stream;
+    while (stream.GetSize() < 4 * 1024 * 1024)
+    {
+        const int bytes  = 1 + random.NextInt(maxBytes);
+        const size_t at  = stream.GetSize();
+        sizes.PushBack(bytes);
+        stream.Resize(at + 4 + bytes);
+        stream[at + 0] = (uint8_t)bytes;
+        stream[at + 1] = (uint8_t)(bytes >> 8);
+        stream[at + 2] = (uint8_t)(bytes >> 16);
+        stream[at + 3] = (uint8_t)(bytes >> 24);
+        random.Fill(&stream[at + 4], bytes);
+    }
+
+    Ptr<ReassemblySocket> socket = *new ReassemblySocket;
+    ReassemblyCounter     counter(sizes);
+    ArrayPOD<uint8_t>     chunk; // Reads land in a fresh buffer, as they do from recv()
+    chunk.Resize(opts.ChunkBytes);
+
+    uint64_t bytesFed = 0;
+    double   start    = Timer::GetSeconds();
+    double   elapsed  = 0.0;
+
+    while (elapsed < opts.Seconds && !counter.Closed)
+    {
+        for (size_t offset = 0; offset < stream.GetSize(); offset += opts.ChunkBytes)
+        {
+            size_t bytes = stream.GetSize() - offset;
+            if (bytes > (size_t)opts.ChunkBytes)
+            {
+                bytes = (size_t)opts.ChunkBytes;
+            }
+
+            memcpy(&chunk[0], &stream[offset], bytes);
+            socket->Feed(&counter, &chunk[0], (int)bytes);
+        }
+
+        bytesFed += stream.GetSize();
+        elapsed   = Timer::GetSeconds() - start;
+    }
+
+    const uint64_t expected = (bytesFed / stream.GetSize()) * sizes.GetSize();
+
+    printf("bench=reassembly size=%d chunk=%d messages=%llu throughput=%.2f GB/s %.0f msgs/s mismatches=%d\n",
+           opts.PayloadBytes, opts.ChunkBytes, (unsigned long long)counter.Messages,
+           bytesFed / elapsed / 1e9, counter.Messages / elapsed, counter.Mismatches);
+
+    if (counter.Closed || counter.Mismatches || counter.Messages != expected)
+    {
+        printf("FAIL: %llu of %llu messages framed, %d with the wrong size\n",
+               (unsigned long long)counter.Messages, (unsigned long long)expected, counter.Mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Receive benchmark
+
+// CPU time used so far by the calling thread
+static double getThreadCpuSeconds()
+{
+#if defined(OVR_OS_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    {
+        return 0.0;
+    }
+
+    ULARGE_INTEGER kernelTicks, userTicks;
+    kernelTicks.LowPart  = kernel.dwLowDateTime;
+    kernelTicks.HighPart = kernel.dwHighDateTime;
+    userTicks.LowPart    = user.dwLowDateTime;
+    userTicks.HighPart   = user.dwHighDateTime;
+    return (double)(kernelTicks.QuadPart + userTicks.QuadPart) * 1e-7;
+#else
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+// Counts messages on the service's poll thread, and reads that thread's CPU time at the
+// first and the last one
+class ReceiveCounter : public SessionListener
+{
+public:
+    ReceiveCounter(int expected) :
+        Expected(expected),
+        Received(0),
+        FirstCpuSeconds(0.0),
+        LastCpuSeconds(0.0)
+    {
+    }
+
+    virtual void OnReceive(ReceivePayload* pPayload, ListenerReceiveResult* lrrOut)
+    {
+        OVR_UNUSED2(pPayload, lrrOut);
+
+        const int received = Received.Load_Acquire() + 1;
+        if (received == 1)
+        {
+            FirstCpuSeconds = getThreadCpuSeconds();
+        }
+        else if (received == Expected)
+        {
+            LastCpuSeconds = getThreadCpuSeconds();
+        }
+        Received.Store_Release(received);
+    }
+
+    virtual void OnDisconnected(Connection* conn) { OVR_UNUSED(conn); }
+    virtual void OnConnected(Connection* conn)    { OVR_UNUSED(conn); }
+
+    int GetReceived() const { return Received.Load_Acquire(); }
+
+    // Per message, over all but the first
+    double GetCpuSecondsPerMessage() const
+    {
+        return (LastCpuSeconds - FirstCpuSeconds) / (Expected - 1);
+    }
+
+protected:
+    int            Expected;
+    AtomicInt<int> Received;         // Written by the poll thread only
+    double         FirstCpuSeconds;
+    double         LastCpuSeconds;
+};
+
+static int runReceiveBench(const LoadOptions& opts)
+{
+    const char* transportNames[] = { "tcp", "unix", "shm" };
+
+    // Channel messages arrive on one reader thread per connection instead
+    if (opts.Transport == LoadTransport_SharedMemory)
+    {
+        printf("-bench receive times the poll thread, so it needs -transport tcp or unix.\n");
+        return 2;
+    }
+
+    ReceiveCounter counter(opts.Messages);
+    Session        service;
+    service.AddSessionListener(&counter);
+    service.SetSharedMemoryTransport(opts.Transport == LoadTransport_SharedMemory);
+
+    BerkleyBindParameters bbp;
+    bbp.Address         = "::1";
+    bbp.Port            = (uint16_t)opts.Port;
+    bbp.blockingTimeout = 100;
+    if (opts.Transport == LoadTransport_Unix)
+    {
+        bbp.LocalPath = opts.Path;
+    }
+
+    if (service.ListenPTCP(&bbp) != SessionResult_OK || !service.StartIOThread(true))
+    {
+        printf("Unable to start the service session.\n");
+        return 1;
+    }
+
+    Session client;
+    client.SetSharedMemoryTransport(opts.Transport == LoadTransport_SharedMemory);
+    client.StartIOThread(true);
+
+    // Many connections at once can overflow the listen backlog, so retry
+    for (int i = 0; i < opts.Clients; ++i)
+    {
+        for (int attempt = 0; attempt < 50 && client.GetConnectionCount() <= i; ++attempt)
+        {
+            BerkleyBindParameters cbp;
+            cbp.Address         = "::1";
+            cbp.blockingTimeout = 100;
+            if (opts.Transport == LoadTransport_Unix)
+            {
+                cbp.LocalPath = opts.Path;
+            }
+
+            SockAddr sa;
+            sa.Set("::1", (uint16_t)opts.Port, SOCK_STREAM);
+            client.ConnectPTCP(&cbp, &sa, true);
+
+            for (int wait = 0; wait < 1000 && client.GetConnectionCount() <= i; ++wait)
+            {
+                Thread::MSleep(1);
+            }
+        }
+    }
+
+    for (int wait = 0; wait < 5000 && service.GetConnectionCount() < opts.Clients; ++wait)
+    {
+        Thread::MSleep(1);
+    }
+
+    int exitCode = 0;
+
+    if (client.GetConnectionCount() < opts.Clients || service.GetConnectionCount() < opts.Clients)
+    {
+        printf("Only %d of %d connections were made.\n", client.GetConnectionCount(), opts.Clients);
+        exitCode = 1;
+    }
+    else
+    {
+        Array< Ptr<Connection> > connections;
+        for (int i = 0; i < opts.Clients; ++i)
+        {
+            connections.PushBack(client.GetConnectionAtIndex(i));
+        }
+
+        ArrayPOD<uint8_t> payload;
+        payload.Resize(opts.PayloadBytes > 0 ? opts.PayloadBytes : 1);
+        memset(&payload[0], 0, payload.GetSize());
+
+        const double start = Timer::GetSeconds();
+
+        // Round-robin, so every connection's socket turns up in the poll set.
+        // At most 256 messages in flight, so no socket buffer fills up.
+        for (int i = 0; i < opts.Messages; ++i)
+        {
+            while (i - counter.GetReceived() > 256)
+            {
+                Thread::MSleep(0);
+            }
+
+            SendParameters sp(connections[i % opts.Clients], &payload[0], payload.GetSizeI());
+            client.Send(&sp);
+        }
+
+        while (counter.GetReceived() < opts.Messages && Timer::GetSeconds() - start < 30.0)
+        {
+            Thread::MSleep(1);
+        }
+
+        const double elapsed = Timer::GetSeconds() - start;
+
+        if (counter.GetReceived() < opts.Messages)
+        {
+            printf("FAIL: %d of %d messages arrived\n", counter.GetReceived(), opts.Messages);
+            exitCode = 1;
+        }
+        else
+        {
+            printf("bench=receive transport=%s connections=%d size=%d messages=%d "
+                   "service cpu/msg=%.2fus wall/msg=%.2fus\n",
+                   transportNames[opts.Transport], opts.Clients, payload.GetSizeI(), opts.Messages,
+                   counter.GetCpuSecondsPerMessage() * 1e6, elapsed / opts.Messages * 1e6);
+        }
+    }
+
+    client.Shutdown();
+    service.Shutdown();
+    client.StopIOThread();
+    service.StopIOThread();
+    return exitCode;
+}
+
+
+//-----------------------------------------------------------------------------
+// Load test
+
+// Runs the load test, then fuzzes the same mock service. Returns the exit code.
+static int runLoadTest(const LoadOptions& opts)
+{
+    int  exitCode = 0;
+    bool serviceAlive = true;
+
+    ArrayPOD<uint8_t> payload;
+    payload.Resize(opts.PayloadBytes + 1);
+    for (int i = 0; i < opts.PayloadBytes; ++i)
+    {
+        payload[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    MockService service;
+    if (!service.Start(opts))
+    {
+        printf("Unable to start the mock service.\n");
+        return 1;
+    }
+
+    Array<LoadClient*> clients;
+    for (int i = 0; i < opts.Clients; ++i)
+    {
+        LoadClient* client = new LoadClient(opts, &payload[0]);
+        clients.PushBack(client);
+
+        if (!client->Connect())
+        {
+            printf("Client %d was unable to connect.\n", i);
+            exitCode = 1;
+        }
+    }
+
+    if (exitCode == 0)
+    {
+        // Warm up caches, pools and the RPC ID tables before counting allocations
+        for (int i = 0; i < opts.Clients; ++i)
+        {
+            clients[i]->Probe();
+        }
+        Thread::MSleep(100);
+
+        int    signalsBefore = service.GetSignalCount();
+        int    allocsBefore  = TheAllocator.GetAllocations();
+        double start         = Timer::GetSeconds() + 0.01;
+
+        for (int i = 0; i < opts.Clients; ++i)
+        {
+            clients[i]->Start(start);
+        }
+        for (int i = 0; i < opts.Clients; ++i)
+        {
+            clients[i]->Join();
+        }
+
+        double elapsed = Timer::GetSeconds() - start;
+
+        // Let the last signals arrive
+        Thread::MSleep(100);
+
+        int allocs  = TheAllocator.GetAllocations() - allocsBefore;
+        int signals = service.GetSignalCount() - signalsBefore;
+
+        LatencyHistogram latencies;
+        int              calls = 0, failures = 0;
+        for (int i = 0; i < opts.Clients; ++i)
+        {
+            latencies.Merge(clients[i]->GetLatencies());
+            calls    += clients[i]->GetCalls();
+            failures += clients[i]->GetFailures();
+        }
+
+        // Each iteration is a call, its reply and a signal
+        const int    messages       = calls * 3;
+        const double allocsPerMsg   = messages ? (double)allocs / messages : 0.0;
+        const int    p99            = latencies.GetPercentile(0.99);
+        const char*  transportNames[] = { "tcp", "unix", "shm" };
+
+        printf("transport=%s clients=%d size=%d rate=%d coalesce=%d calls=%d failures=%d signals=%d "
+               "throughput=%.0f calls/s %.0f msgs/s p50=%dus p99=%dus p999=%dus allocs/msg=%.2f\n",
+               transportNames[opts.Transport], opts.Clients, opts.PayloadBytes, opts.CallsPerSecond,
+               (int)opts.SendCoalescing, calls, failures, signals, calls / elapsed, messages / elapsed,
+               latencies.GetPercentile(0.5), p99, latencies.GetPercentile(0.999), allocsPerMsg);
+
+        if (failures)
+        {
+            printf("FAIL: %d calls failed\n", failures);
+            exitCode = 1;
+        }
+        if (opts.MaxP99Usec > 0.0 && p99 > opts.MaxP99Usec)
+        {
+            printf("FAIL: p99 latency %dus is over the %.0fus limit\n", p99, opts.MaxP99Usec);
+            exitCode = 1;
+        }
+        if (opts.MaxAllocsPerMessage >= 0.0 && allocsPerMsg > opts.MaxAllocsPerMessage)
+        {
+            printf("FAIL: %.2f allocations per message is over the %.2f limit\n",
+                   allocsPerMsg, opts.MaxAllocsPerMessage);
+            exitCode = 1;
+        }
+    }
+
+    for (int i = 0; i < opts.Clients; ++i)
+    {
+        clients[i]->Shutdown();
+    }
+    for (int i = 0; i < opts.Clients; ++i)
+    {
+        clients[i]->Stop();
+    }
+
+    if (opts.FuzzConnections > 0)
+    {
+        FuzzRandom random(opts.Seed);
+        int        sent = 0;
+
+        for (int i = 0; i < opts.FuzzConnections; ++i)
+        {
+            sent += fuzzConnection(opts, random);
+        }
+
+        // The service must still answer a well-formed client
+        LoadClient probe(opts, &payload[0]);
+        serviceAlive = probe.Connect() && probe.Probe();
+        probe.Stop();
+
+        printf("fuzz: connections=%d messages=%d seed=%u service %s\n",
+               opts.FuzzConnections, sent, opts.Seed, serviceAlive ? "ok" : "NOT RESPONDING");
+        if (!serviceAlive)
+        {
+            exitCode = 1;
+        }
+    }
+
+    for (int i = 0; i < opts.Clients; ++i)
+    {
+        delete clients[i];
+    }
+
+    service.Stop();
+    return exitCode;
+}
+
+// Runs the load test over each local transport in turn, without fuzzing
+static int runTransportBench(const LoadOptions& opts)
+{
+    static const LoadTransport transports[] =
+    {
+        LoadTransport_TCP,
+#ifndef OVR_OS_WIN32
+        LoadTransport_Unix,
+#endif
+        LoadTransport_SharedMemory
+    };
+
+    int exitCode = 0;
+    for (int i = 0; i < (int)(sizeof(transports) / sizeof(transports[0])); ++i)
+    {
+        LoadOptions transportOpts = opts;
+        transportOpts.Transport       = transports[i];
+        transportOpts.Port            = opts.Port + i; // Clear of the last run's closing sockets
+        transportOpts.FuzzConnections = 0;
+
+        if (runLoadTest(transportOpts) != 0)
+        {
+            exitCode = 1;
+        }
+    }
+
+    return exitCode;
+}
+
+
+//-----------------------------------------------------------------------------
+// main
+
+int main(int argc, char** argv)
+{
+    LoadOptions opts;
+    if (!parseOptions(argc, argv, opts))
+    {
+        printUsage();
+        return 2;
+    }
+
+    System::Init(Log::ConfigureDefaultLog(LogMask_All), &TheAllocator);
+
+    int exitCode;
+    switch (opts.Bench)
+    {
+    case LoadBench_Reassembly:
+        exitCode = runReassemblyBench(opts);
+        break;
+    case LoadBench_Transports:
+        exitCode = runTransportBench(opts);
+        break;
+    case LoadBench_Receive:
+        exitCode = runReceiveBench(opts);
+        break;
+    default:
+        exitCode = runLoadTest(opts);
+        break;
+    }
+
+    System::Destroy();
+    return exitCode;
+}